@@ -0,0 +1,70 @@
+#include "bench.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace {
+
+constexpr auto ops = std::size_t{100'000'000};
+
+class callee {
+public:
+    callee() = default;
+    callee(callee const&) = delete;
+    callee(callee&&) = delete;
+    virtual ~callee() = default;
+    auto operator=(callee const&) -> callee& = delete;
+    auto operator=(callee&&) -> callee& = delete;
+
+    virtual auto call(int x) noexcept -> int = 0;
+};
+
+class callee_impl final : public callee {
+public:
+    auto call(int x) noexcept -> int override { return x + 1; }
+};
+
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+auto plain(int x) noexcept -> int {
+    return x + 1;
+}
+
+auto function_call(std::size_t n) -> void {
+    auto x = 0;
+    for (auto i = std::size_t{}; i < n; ++i) {
+        x = plain(x);
+        bench::do_not_optimize(x);
+    }
+}
+
+auto virtual_call(std::size_t n) -> void {
+    auto c = std::unique_ptr<callee>{std::make_unique<callee_impl>()};
+    auto* p = c.get();
+    bench::do_not_optimize(p);
+    auto x = 0;
+    for (auto i = std::size_t{}; i < n; ++i) {
+        x = p->call(x);
+        bench::do_not_optimize(x);
+    }
+}
+
+auto std_function_call(std::size_t n) -> void {
+    auto f = std::function<int(int)>{[](int x) { return x + 1; }};
+    bench::do_not_optimize(f);
+    auto x = 0;
+    for (auto i = std::size_t{}; i < n; ++i) {
+        x = f(x);
+        bench::do_not_optimize(x);
+    }
+}
+
+auto const registered = bench::add({
+    {"baseline/function", ops, function_call},
+    {"baseline/virtual", ops, virtual_call},
+    {"baseline/std_function", ops, std_function_call},
+});
+
+} // namespace
@@ -0,0 +1,80 @@
+#include "bench.hpp"
+#include "corofx/batch.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace corofx;
+
+// Outside of the anonymous namespace, since frames of the handler coroutine have a field of this
+// type.
+struct fetch {
+    using return_type = std::uint64_t;
+
+    std::uint64_t key{};
+};
+
+namespace {
+
+constexpr auto requests = std::size_t{100};
+constexpr auto fan_out = std::size_t{64};
+constexpr auto round_trip = std::chrono::microseconds{20};
+
+// Stands in for one call to a remote service, which costs a round trip however many keys it
+// looks up.
+auto backend(std::span<fetch const> effects) -> std::vector<std::uint64_t> {
+    auto until = std::chrono::steady_clock::now() + round_trip;
+    while (std::chrono::steady_clock::now() < until) {}
+    auto results = std::vector<std::uint64_t>{};
+    results.reserve(effects.size());
+    for (auto const& e : effects) results.push_back(e.key * 6364136223846793005 + 1);
+    return results;
+}
+
+auto lookup(std::uint64_t key) -> task<std::uint64_t, fetch> { co_return co_await fetch{key}; }
+
+template<typename H>
+auto worker(H h, std::uint64_t key, std::uint64_t* out) -> task<void, yield_thread, suspend> {
+    *out = co_await lookup(key).with(h);
+    co_return {};
+}
+
+// Each request spawns one task per key and waits for all of them.
+template<typename H>
+auto requests_loop(H h, std::size_t n) -> task<std::uint64_t, spawn, yield_thread, join> {
+    auto x = std::uint64_t{};
+    auto out = std::vector<std::uint64_t>(fan_out);
+    auto handles = std::vector<job_handle>(fan_out);
+    for (auto i = std::uint64_t{}; i < n; ++i) {
+        for (auto k = std::size_t{}; k < fan_out; ++k) {
+            handles[k] = co_await spawn{worker(h, i * fan_out + k, &out[k])};
+        }
+        for (auto& j : handles) co_await join{j};
+        for (auto r : out) x ^= r;
+    }
+    co_return x;
+}
+
+auto unbatched(std::size_t n) -> void {
+    auto sched = scheduler{1};
+    auto h = tail_handler_of<fetch>([](fetch&& e) { return backend({&e, 1})[0]; });
+    bench::do_not_optimize(sched.run(requests_loop(h, n)));
+}
+
+auto batched(std::size_t n) -> void {
+    auto sched = scheduler{1};
+    auto h = batch_handler_of<fetch>(&backend);
+    bench::do_not_optimize(sched.run(requests_loop(h, n)));
+}
+
+auto const registered = bench::add({
+    {"batch/fan_out:64/unbatched", requests, unbatched},
+    {"batch/fan_out:64/batched", requests, batched},
+});
+
+} // namespace
@@ -0,0 +1,102 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <iostream>
+#include <new>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr auto repetitions = 5;
+
+std::atomic<bool> counting{};
+std::atomic<std::size_t> allocations{};
+std::atomic<std::size_t> allocated_bytes{};
+
+auto registry() -> std::vector<bench::benchmark>& {
+    static auto benchmarks = std::vector<bench::benchmark>{};
+    return benchmarks;
+}
+
+auto allocate(std::size_t size) -> void* {
+    if (counting.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (auto p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc{};
+}
+
+struct result {
+    double ns_per_op;
+    double allocs_per_op;
+    double heap_bytes_per_op;
+};
+
+auto measure(bench::benchmark const& b) -> result {
+    b.fn(std::max<std::size_t>(b.ops / 10, 1)); // Warm up.
+    auto samples = std::vector<double>{};
+    for (auto i = 0; i < repetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        b.fn(b.ops);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        samples.push_back(std::chrono::duration<double, std::nano>{elapsed}.count());
+    }
+    std::ranges::sort(samples);
+
+    // Allocations are counted in a separate pass to keep them out of the timings.
+    allocations = 0;
+    allocated_bytes = 0;
+    counting = true;
+    b.fn(b.ops);
+    counting = false;
+
+    auto ops = static_cast<double>(b.ops);
+    return {
+        .ns_per_op = samples[samples.size() / 2] / ops,
+        .allocs_per_op = static_cast<double>(allocations.load()) / ops,
+        .heap_bytes_per_op = static_cast<double>(allocated_bytes.load()) / ops,
+    };
+}
+
+} // namespace
+
+auto operator new(std::size_t size) -> void* { return allocate(size); }
+auto operator new[](std::size_t size) -> void* { return allocate(size); }
+auto operator delete(void* p) noexcept -> void { std::free(p); }
+auto operator delete[](void* p) noexcept -> void { std::free(p); }
+auto operator delete(void* p, std::size_t) noexcept -> void { std::free(p); }
+auto operator delete[](void* p, std::size_t) noexcept -> void { std::free(p); }
+
+auto bench::add(std::initializer_list<benchmark> benchmarks) -> bool {
+    registry().insert(registry().end(), benchmarks);
+    return true;
+}
+
+// Usage: corofx_bench [filter]
+// Runs every benchmark whose name contains `filter` and prints the results as JSON.
+auto main(int argc, char** argv) -> int {
+    auto filter = argc > 1 ? std::string_view{argv[1]} : std::string_view{};
+    auto& benchmarks = registry();
+    std::ranges::sort(benchmarks, {}, &bench::benchmark::name);
+
+    auto first = true;
+    std::cout << "{\n  \"benchmarks\": [";
+    for (auto const& b : benchmarks) {
+        if (b.name.find(filter) == std::string_view::npos) continue;
+        auto r = measure(b);
+        std::cout << (first ? "\n" : ",\n") << "    {\"name\": \"" << b.name
+                  << "\", \"ops\": " << b.ops << ", \"ns_per_op\": " << r.ns_per_op
+                  << ", \"allocs_per_op\": " << r.allocs_per_op
+                  << ", \"heap_bytes_per_op\": " << r.heap_bytes_per_op << "}" << std::flush;
+        first = false;
+    }
+    std::cout << "\n  ]\n}\n";
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <string_view>
+
+namespace bench {
+
+// Prevents the compiler from optimizing away a value.
+template<typename T>
+auto do_not_optimize(T const& value) -> void {
+#ifdef __GNUC__
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    auto volatile sink = &value;
+    static_cast<void>(sink);
+#endif
+}
+
+// A benchmark performs `ops` operations per call.
+struct benchmark {
+    std::string_view name;
+    std::size_t ops;
+    void (*fn)(std::size_t ops);
+};
+
+// Registers benchmarks to be run by `corofx_bench`.
+auto add(std::initializer_list<benchmark> benchmarks) -> bool;
+
+} // namespace bench
@@ -0,0 +1,81 @@
+#include "bench.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+
+using namespace corofx;
+
+namespace {
+
+struct state_get {
+    using return_type = int;
+};
+
+struct state_put {
+    using return_type = void;
+
+    int x{};
+};
+
+constexpr auto ops = std::size_t{10'000'000};
+
+// The same producer is instantiated with unbound and bound effect rows.
+template<effect... Es>
+auto countdown() -> task<void, Es...> {
+    for (auto i = co_await state_get{}; i > 0; i = co_await state_get{}) {
+        co_await state_put{i - 1};
+    }
+    co_return {};
+}
+
+auto tail_dynamic(std::size_t n) -> void {
+    auto x = static_cast<int>(n / 2);
+    countdown<state_get, state_put>()
+        .with(
+            tail_handler_of<state_put>([&](state_put&& e) { x = e.x; }),
+            tail_handler_of<state_get>([&](state_get&&) { return x; }))();
+    bench::do_not_optimize(x);
+}
+
+auto tail_bound(std::size_t n) -> void {
+    auto x = static_cast<int>(n / 2);
+    auto put = tail_handler_of<state_put>([&](state_put&& e) { x = e.x; });
+    auto get = tail_handler_of<state_get>([&](state_get&&) { return x; });
+    countdown<bound<decltype(get)>, bound<decltype(put)>>().with(put, get)();
+    bench::do_not_optimize(x);
+}
+
+auto frame_dynamic(std::size_t n) -> void {
+    auto x = static_cast<int>(n / 2);
+    countdown<state_get, state_put>()
+        .with(
+            handler_of<state_put>([&](auto&& e, auto&& resume) -> task<void> {
+                x = e.x;
+                co_return resume();
+            }),
+            handler_of<state_get>([&](auto&&, auto&& resume) -> task<void> {
+                co_return resume(x);
+            }))();
+    bench::do_not_optimize(x);
+}
+
+auto frame_bound(std::size_t n) -> void {
+    auto x = static_cast<int>(n / 2);
+    auto put = handler_of<state_put>([&](auto&& e, auto&& resume) -> task<void> {
+        x = e.x;
+        co_return resume();
+    });
+    auto get =
+        handler_of<state_get>([&](auto&&, auto&& resume) -> task<void> { co_return resume(x); });
+    countdown<bound<decltype(get)>, bound<decltype(put)>>().with(put, get)();
+    bench::do_not_optimize(x);
+}
+
+auto const registered = bench::add({
+    {"dispatch/tail/dynamic", ops, tail_dynamic},
+    {"dispatch/tail/bound", ops, tail_bound},
+    {"dispatch/frame/dynamic", ops, frame_dynamic},
+    {"dispatch/frame/bound", ops, frame_bound},
+});
+
+} // namespace
@@ -0,0 +1,57 @@
+#include "bench.hpp"
+#include "corofx/channel.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace corofx;
+
+namespace {
+
+constexpr auto ops = std::size_t{1'000'000};
+constexpr auto capacity = std::size_t{1024};
+
+auto produce(channel<std::uint64_t>& ch, std::size_t n) -> task<void, suspend> {
+    for (auto i = std::size_t{}; i < n; ++i) co_await send(ch, std::uint64_t{i});
+    co_return {};
+}
+
+auto consume(channel<std::uint64_t>& ch, std::uint64_t* sum) -> task<void, suspend> {
+    while (auto value = co_await recv(ch)) *sum += *value;
+    co_return {};
+}
+
+auto exchange(channel<std::uint64_t>& ch, std::size_t producers, std::size_t consumers,
+              std::size_t n) -> task<void, spawn, join, suspend> {
+    auto sums = std::vector<std::uint64_t>(consumers);
+    auto consuming = std::vector<job_handle>{};
+    for (auto& sum : sums) consuming.push_back(co_await spawn{consume(ch, &sum)});
+    auto producing = std::vector<job_handle>{};
+    for (auto i = std::size_t{}; i < producers; ++i) {
+        producing.push_back(co_await spawn{produce(ch, n / producers)});
+    }
+    for (auto& h : producing) co_await join{h};
+    ch.close();
+    for (auto& h : consuming) co_await join{h};
+    bench::do_not_optimize(sums);
+    co_return {};
+}
+
+// Each producer and consumer is a task, on a pool with one worker per task.
+template<std::size_t Producers, std::size_t Consumers>
+auto throughput(std::size_t n) -> void {
+    auto sched = scheduler{Producers + Consumers};
+    auto ch = channel<std::uint64_t>{capacity};
+    sched.run(exchange(ch, Producers, Consumers, n));
+}
+
+auto const registered = bench::add({
+    {"channel/spsc", ops, throughput<1, 1>},
+    {"channel/mpsc/producers:4", ops, throughput<4, 1>},
+    {"channel/mpmc/producers:4/consumers:4", ops, throughput<4, 4>},
+});
+
+} // namespace
@@ -0,0 +1,109 @@
+#include "bench.hpp"
+#include "corofx/check.hpp"
+#include "corofx/file.hpp"
+#include "corofx/task.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+
+using namespace corofx;
+
+namespace {
+
+constexpr auto mib = std::size_t{1} << 20;
+constexpr auto file_mib = std::size_t{128};
+
+// A log file of `file_mib` MiB, written on first use and removed at exit.
+class log_file {
+public:
+    log_file() : path_{(std::filesystem::temp_directory_path() / "corofx_bench_XXXXXX").string()} {
+        auto fd = ::mkstemp(path_.data());
+        corofx::check(fd >= 0);
+        ::close(fd);
+        auto out = std::ofstream{path_};
+        for (auto i = std::size_t{}; static_cast<std::size_t>(out.tellp()) < file_mib * mib; ++i) {
+            out << "2024-01-01T00:00:00Z INFO request " << i << " took " << i % 1000 << " us\n";
+        }
+    }
+
+    log_file(log_file const&) = delete;
+    log_file(log_file&&) = delete;
+    ~log_file() { std::filesystem::remove(path_); }
+    auto operator=(log_file const&) -> log_file& = delete;
+    auto operator=(log_file&&) -> log_file& = delete;
+
+    [[nodiscard]]
+    auto path() const -> char const* {
+        return path_.c_str();
+    }
+
+private:
+    std::string path_;
+};
+
+auto file() -> log_file const& {
+    static auto const f = log_file{};
+    return f;
+}
+
+struct count_lines {
+    auto operator()(std::span<std::byte const> chunk) const -> std::size_t {
+        return static_cast<std::size_t>(std::ranges::count(chunk, std::byte{'\n'}));
+    }
+};
+
+// Reads one byte per page, so that the cost of getting the bytes to the task dominates.
+struct touch_pages {
+    auto operator()(std::span<std::byte const> chunk) const -> std::size_t {
+        auto x = std::size_t{};
+        for (auto i = std::size_t{}; i < chunk.size(); i += 4096) {
+            x += static_cast<std::size_t>(chunk[i]);
+        }
+        return x;
+    }
+};
+
+// Parses the first `limit` bytes of the input.
+template<typename Parse>
+auto parse(std::size_t limit) -> task<std::size_t, read_chunk> {
+    auto x = std::size_t{};
+    auto seen = std::size_t{};
+    while (seen < limit) {
+        auto chunk = co_await read_chunk{};
+        if (chunk.empty()) break;
+        x += Parse{}(chunk);
+        seen += chunk.size();
+    }
+    co_return x;
+}
+
+template<typename Parse>
+auto mapped(std::size_t n) -> void {
+    auto f = mapped_file::open(file().path());
+    bench::do_not_optimize(parse<Parse>(n * mib).with(mapped_handler_of(*f))());
+}
+
+template<typename Parse>
+auto streamed(std::size_t n) -> void {
+    auto fd = ::open(file().path(), O_RDONLY | O_CLOEXEC);
+    bench::do_not_optimize(parse<Parse>(n * mib).with(read_handler_of(fd))());
+    ::close(fd);
+}
+
+// An operation is one MiB of a file in the page cache.
+auto const registered = bench::add({
+    {"file/mib:128/lines/read", file_mib, streamed<count_lines>},
+    {"file/mib:128/lines/mmap", file_mib, mapped<count_lines>},
+    {"file/mib:128/pages/read", file_mib, streamed<touch_pages>},
+    {"file/mib:128/pages/mmap", file_mib, mapped<touch_pages>},
+});
+
+} // namespace
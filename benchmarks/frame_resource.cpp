@@ -0,0 +1,55 @@
+#include "bench.hpp"
+#include "corofx/frame_resource.hpp"
+#include "corofx/task.hpp"
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+
+using namespace corofx;
+
+namespace {
+
+struct lookup {
+    using return_type = int;
+
+    int key{};
+};
+
+constexpr auto ops = std::size_t{100'000};
+constexpr auto keys = 16;
+
+// See examples/arena.cpp.
+auto sum_keys(int first, int count) -> task<int, lookup> { // NOLINT(misc-no-recursion)
+    if (count == 1) co_return co_await lookup{first};
+    auto half = count / 2;
+    co_return co_await sum_keys(first, half) + co_await sum_keys(first + half, count - half);
+}
+
+auto request(int id) -> int {
+    return sum_keys(id, keys).with(handler_of<lookup>([](lookup&& e, auto& resume) -> task<int> {
+        co_return resume(e.key + 1);
+    }))();
+}
+
+// Each operation is a request of 31 task frames and 16 handler frames.
+auto heap(std::size_t n) -> void {
+    for (auto i = std::size_t{}; i < n; ++i) bench::do_not_optimize(request(static_cast<int>(i)));
+}
+
+auto arena(std::size_t n) -> void {
+    auto buffer = std::array<std::byte, 32 * 1024>{};
+    auto resource = std::pmr::monotonic_buffer_resource{buffer.data(), buffer.size()};
+    for (auto i = std::size_t{}; i < n; ++i) {
+        auto scope = frame_resource_scope{&resource};
+        bench::do_not_optimize(request(static_cast<int>(i)));
+        resource.release();
+    }
+}
+
+auto const registered = bench::add({
+    {"frame_resource/request/heap", ops, heap},
+    {"frame_resource/request/arena", ops, arena},
+});
+
+} // namespace
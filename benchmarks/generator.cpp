@@ -0,0 +1,53 @@
+#include "bench.hpp"
+#include "corofx/generator.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <vector>
+
+using namespace corofx;
+
+namespace {
+
+struct scale {
+    using return_type = int;
+
+    int x{};
+};
+
+constexpr auto ops = std::size_t{10'000'000};
+
+auto traverse(std::vector<int> const& xs) -> generator<int> {
+    for (auto x : xs) co_yield x;
+}
+
+auto traverse_scaled(std::vector<int> const& xs) -> generator<int, scale> {
+    for (auto x : xs) co_yield co_await scale{x};
+}
+
+auto sum_scaled(std::vector<int> const& xs) -> task<int, scale> {
+    auto sum = 0;
+    for (auto x : co_await traverse_scaled(xs)) sum += x;
+    co_return sum;
+}
+
+// Compare with yield/handler_of and yield/tail_handler_of.
+auto co_yield_loop(std::size_t n) -> void {
+    auto xs = std::vector<int>(n, 1);
+    auto sum = 0;
+    for (auto x : traverse(xs)) sum += x;
+    bench::do_not_optimize(sum);
+}
+
+auto co_yield_tail_effect(std::size_t n) -> void {
+    auto xs = std::vector<int>(n, 1);
+    auto sum = sum_scaled(xs).with(tail_handler_of<scale>([](scale&& e) { return e.x * 2; }))();
+    bench::do_not_optimize(sum);
+}
+
+auto const registered = bench::add({
+    {"generator/co_yield", ops, co_yield_loop},
+    {"generator/co_yield_tail_effect", ops, co_yield_tail_effect},
+});
+
+} // namespace
@@ -0,0 +1,82 @@
+#include "bench.hpp"
+#include "corofx/check.hpp"
+#include "corofx/log.hpp"
+#include "corofx/task.hpp"
+
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace corofx;
+
+namespace {
+
+constexpr auto ops = std::size_t{1'000'000};
+
+// A fresh file per run, removed afterwards.
+class temp_file {
+public:
+    temp_file() : path_{(std::filesystem::temp_directory_path() / "corofx_bench_XXXXXX").string()} {
+        auto fd = ::mkstemp(path_.data());
+        corofx::check(fd >= 0);
+        ::close(fd);
+    }
+
+    temp_file(temp_file const&) = delete;
+    temp_file(temp_file&&) = delete;
+    ~temp_file() { std::filesystem::remove(path_); }
+    auto operator=(temp_file const&) -> temp_file& = delete;
+    auto operator=(temp_file&&) -> temp_file& = delete;
+
+    [[nodiscard]]
+    auto path() const -> char const* {
+        return path_.c_str();
+    }
+
+private:
+    std::string path_;
+};
+
+auto serve(std::size_t n) -> task<void, log_message> {
+    for (auto i = std::size_t{}; i < n; ++i) {
+        co_await log_message::info("request ", i, " served in ", i % 1000, " us");
+    }
+    co_return {};
+}
+
+// Every record reaches the file before the next one is formatted, as with `std::endl`.
+auto iostream_sync(std::size_t n) -> void {
+    auto file = temp_file{};
+    auto out = std::ofstream{file.path()};
+    for (auto i = std::size_t{}; i < n; ++i) {
+        out << "INFO request " << i << " served in " << i % 1000 << " us" << std::endl;
+    }
+}
+
+// Records stay in the stream buffer, and are lost if the process crashes.
+auto iostream_buffered(std::size_t n) -> void {
+    auto file = temp_file{};
+    auto out = std::ofstream{file.path()};
+    for (auto i = std::size_t{}; i < n; ++i) {
+        out << "INFO request " << i << " served in " << i % 1000 << " us" << '\n';
+    }
+}
+
+// Includes writing out the records left when the logger is destroyed.
+auto async(std::size_t n) -> void {
+    auto file = temp_file{};
+    auto l = logger::open(file.path(), {.overflow = log_overflow::block});
+    serve(n).with(log_handler_of(*l))();
+}
+
+auto const registered = bench::add({
+    {"log/iostream/sync", ops, iostream_sync},
+    {"log/iostream/buffered", ops, iostream_buffered},
+    {"log/async", ops, async},
+});
+
+} // namespace
@@ -0,0 +1,121 @@
+#include "bench.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <utility>
+
+using namespace corofx;
+
+namespace {
+
+struct state_get {
+    using return_type = int;
+};
+
+struct state_put {
+    using return_type = void;
+
+    int x{};
+};
+
+template<int I>
+struct fx {
+    using return_type = int;
+};
+
+constexpr auto ops = std::size_t{100'000};
+constexpr auto steps = 10;
+constexpr auto wide_depth = 10;
+
+// See examples/state.cpp.
+auto stateful(int depth) -> task<void, state_get, state_put> { // NOLINT(misc-no-recursion)
+    if (depth == 0) {
+        for (auto i = co_await state_get{}; i > 0; i = co_await state_get{}) {
+            co_await state_put{i - 1};
+        }
+    } else {
+        co_await stateful(depth - 1);
+    }
+    co_return {};
+}
+
+// Each operation runs `stateful(Depth)` once with a handler installed at the top.
+template<int Depth>
+auto nested(std::size_t n) -> void {
+    for (auto i = std::size_t{}; i < n; ++i) {
+        auto x = steps;
+        stateful(Depth).with(
+            handler_of<state_put>([&](auto&& e, auto&& resume) -> task<void> {
+                x = e.x;
+                co_return resume();
+            }),
+            handler_of<state_get>([&](auto&&, auto&& resume) -> task<void> {
+                co_return resume(x);
+            }))();
+        bench::do_not_optimize(x);
+    }
+}
+
+// A chain of tasks with a wide effect row.
+template<int... Is>
+auto wide(int depth, std::integer_sequence<int, Is...> is) // NOLINT(misc-no-recursion)
+    -> task<int, fx<Is>...> {
+    if (depth == 0) co_return co_await fx<0>{};
+    co_return co_await wide(depth - 1, is);
+}
+
+// Each operation runs a chain of `wide_depth` tasks with `Width` effects each.
+template<int Width>
+auto wide_nested(std::size_t n) -> void {
+    [n]<int... Is>(std::integer_sequence<int, Is...> is) {
+        for (auto i = std::size_t{}; i < n; ++i) {
+            auto x = wide(wide_depth, is).with(tail_handler_of<fx<Is>>([](fx<Is>&&) {
+                return Is;
+            })...)();
+            bench::do_not_optimize(x);
+        }
+    }(std::make_integer_sequence<int, Width>{});
+}
+
+auto perform_all(std::size_t n) -> task<int, fx<0>> {
+    auto sum = 0;
+    for (auto i = std::size_t{}; i < n; ++i) sum += co_await fx<0>{};
+    co_return sum;
+}
+
+auto distant(int distance, std::size_t n) -> task<int, fx<0>>; // NOLINT(misc-no-recursion)
+
+auto shadowed(int distance, std::size_t n) -> task<int, fx<0>, fx<1>> { // NOLINT(misc-no-recursion)
+    co_return co_await distant(distance, n);
+}
+
+// Performs `n` effects whose handler is installed outside of `distance` handlers of another
+// effect, so that each perform walks past them.
+auto distant(int distance, std::size_t n) -> task<int, fx<0>> { // NOLINT(misc-no-recursion)
+    if (distance == 0) co_return co_await perform_all(n);
+    co_return co_await shadowed(distance - 1, n).with(tail_handler_of<fx<1>>([](fx<1>&&) {
+        return 1;
+    }));
+}
+
+// Each operation is one perform.
+template<int Distance>
+auto perform_distant(std::size_t n) -> void {
+    auto x = distant(Distance, n).with(tail_handler_of<fx<0>>([](fx<0>&&) { return 0; }))();
+    bench::do_not_optimize(x);
+}
+
+auto const registered = bench::add({
+    {"nested/depth:1", ops, nested<1>},
+    {"nested/depth:10", ops, nested<10>},
+    {"nested/depth:100", ops / 10, nested<100>},
+    {"nested/width:1", ops, wide_nested<1>},
+    {"nested/width:16", ops, wide_nested<16>},
+    {"nested/distance:0", ops * 100, perform_distant<0>},
+    {"nested/distance:1", ops * 100, perform_distant<1>},
+    {"nested/distance:4", ops * 100, perform_distant<4>},
+    {"nested/distance:16", ops * 100, perform_distant<16>},
+    {"nested/distance:64", ops * 100, perform_distant<64>},
+});
+
+} // namespace
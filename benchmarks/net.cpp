@@ -0,0 +1,100 @@
+#include "bench.hpp"
+#include "corofx/net.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+using namespace corofx;
+
+namespace {
+
+constexpr auto ops = std::size_t{20'000};
+
+auto transfer(int fd, std::span<std::byte> data, bool send) -> task<bool, net_read, net_write> {
+    while (not data.empty()) {
+        auto n = send ? co_await net_write{fd, data} : co_await net_read{fd, data};
+        if (n <= 0) co_return false;
+        data = data.subspan(static_cast<std::size_t>(n));
+    }
+    co_return true;
+}
+
+auto echo(int fd, std::size_t bytes) -> task<void, net_read, net_write> {
+    auto buffer = std::vector<std::byte>(bytes);
+    while (co_await transfer(fd, buffer, false)) {
+        if (not co_await transfer(fd, buffer, true)) break;
+    }
+    ::close(fd);
+    co_return {};
+}
+
+auto server(int listener, std::size_t conns, std::size_t bytes)
+    -> task<void, spawn, join, net_accept> {
+    auto handles = std::vector<job_handle>{};
+    for (auto i = std::size_t{}; i < conns; ++i) {
+        auto fd = co_await net_accept{listener};
+        handles.push_back(co_await spawn{echo(fd, bytes)});
+    }
+    for (auto& h : handles) co_await join{h};
+    co_return {};
+}
+
+// Sends a message and waits for its echo, `rounds` times.
+auto client(int fd, std::size_t bytes, std::size_t rounds) -> task<void, net_read, net_write> {
+    auto buffer = std::vector<std::byte>(bytes);
+    for (auto i = std::size_t{}; i < rounds; ++i) {
+        if (not co_await transfer(fd, buffer, true)) break;
+        if (not co_await transfer(fd, buffer, false)) break;
+    }
+    ::close(fd);
+    co_return {};
+}
+
+auto run_echo(int listener, sockaddr_in addr, std::size_t conns, std::size_t bytes, std::size_t n)
+    -> task<void, spawn, join, net_accept, net_read, net_write> {
+    auto handles = std::vector<job_handle>{};
+    handles.push_back(co_await spawn{server(listener, conns, bytes)});
+    for (auto i = std::size_t{}; i < conns; ++i) {
+        auto fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        ::connect(fd, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr));
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        handles.push_back(co_await spawn{client(fd, bytes, n / conns)});
+    }
+    for (auto& h : handles) co_await join{h};
+    co_return {};
+}
+
+// Each operation is one message round trip over loopback TCP.
+template<std::size_t Conns, std::size_t Bytes>
+auto round_trip(std::size_t n) -> void {
+    auto listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    auto addr = sockaddr_in{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    auto len = socklen_t{sizeof(addr)};
+    ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::listen(listener, Conns);
+    ::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+    auto r = reactor{};
+    r.run(run_echo(listener, addr, Conns, Bytes, n));
+    ::close(listener);
+}
+
+auto const registered = bench::add({
+    {"net/echo/conns:1/bytes:64", ops, round_trip<1, 64>},
+    {"net/echo/conns:1/bytes:16384", ops, round_trip<1, 16384>},
+    {"net/echo/conns:16/bytes:64", ops, round_trip<16, 64>},
+    {"net/echo/conns:16/bytes:16384", ops, round_trip<16, 16384>},
+    {"net/echo/conns:128/bytes:64", ops, round_trip<128, 64>},
+});
+
+} // namespace
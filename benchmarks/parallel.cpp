@@ -0,0 +1,62 @@
+#include "bench.hpp"
+#include "corofx/parallel.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+using namespace corofx;
+
+using sum = parallel_reduce<std::uint32_t>;
+
+namespace {
+
+constexpr auto elements = std::size_t{100'000'000};
+
+auto data() -> std::span<std::uint32_t const> {
+    static auto const xs = [] {
+        auto v = std::vector<std::uint32_t>(elements);
+        std::iota(v.begin(), v.end(), std::uint32_t{});
+        return v;
+    }();
+    return xs;
+}
+
+// Addition wraps around, so it is associative and commutative.
+struct plus {
+    auto operator()(std::uint32_t a, std::uint32_t b) const -> std::uint32_t { return a + b; }
+};
+
+auto total(std::size_t n) -> task<std::uint32_t, sum> {
+    co_return co_await sum{data().first(n), 0, plus{}};
+}
+
+auto hand_written(std::size_t n) -> void {
+    auto x = std::uint32_t{};
+    for (auto v : data().first(n)) x += v;
+    bench::do_not_optimize(x);
+}
+
+auto sequential(std::size_t n) -> void {
+    bench::do_not_optimize(total(n).with(sequential_handler_of<sum>())());
+}
+
+template<std::size_t Threads>
+auto parallel(std::size_t n) -> void {
+    static auto pool = parallel_pool{Threads};
+    bench::do_not_optimize(total(n).with(parallel_handler_of<sum>(pool))());
+}
+
+auto const registered = bench::add({
+    {"parallel/reduce/n:1e8/loop", elements, hand_written},
+    {"parallel/reduce/n:1e8/sequential", elements, sequential},
+    {"parallel/reduce/n:1e8/threads:1", elements, parallel<1>},
+    {"parallel/reduce/n:1e8/threads:2", elements, parallel<2>},
+    {"parallel/reduce/n:1e8/threads:4", elements, parallel<4>},
+    {"parallel/reduce/n:1e8/threads:8", elements, parallel<8>},
+});
+
+} // namespace
@@ -0,0 +1,52 @@
+#include "bench.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace corofx;
+
+namespace {
+
+constexpr auto ops = std::size_t{100'000};
+constexpr auto work_per_op = 2'000;
+
+auto work(std::size_t seed) -> std::uint64_t {
+    auto x = static_cast<std::uint64_t>(seed) + 1;
+    for (auto i = 0; i < work_per_op; ++i) x = x * 6364136223846793005 + 1442695040888963407;
+    return x;
+}
+
+// Splits `[lo, hi)` in halves, spawning the left half, until single operations remain.
+auto tree(std::size_t lo, std::size_t hi, std::uint64_t* out) -> task<void, spawn, join> {
+    if (hi - lo == 1) {
+        *out = work(lo);
+        co_return {};
+    }
+    auto mid = lo + (hi - lo) / 2;
+    auto left = std::uint64_t{};
+    auto right = std::uint64_t{};
+    auto j = co_await spawn{tree(lo, mid, &left)};
+    co_await tree(mid, hi, &right);
+    co_await join{j};
+    *out = left ^ right;
+    co_return {};
+}
+
+template<std::size_t Threads>
+auto spawn_join(std::size_t n) -> void {
+    auto sched = scheduler{Threads};
+    auto x = std::uint64_t{};
+    sched.run(tree(0, n, &x));
+    bench::do_not_optimize(x);
+}
+
+auto const registered = bench::add({
+    {"scheduler/threads:1", ops, spawn_join<1>},
+    {"scheduler/threads:2", ops, spawn_join<2>},
+    {"scheduler/threads:4", ops, spawn_join<4>},
+    {"scheduler/threads:8", ops, spawn_join<8>},
+});
+
+} // namespace
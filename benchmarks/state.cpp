@@ -0,0 +1,80 @@
+#include "bench.hpp"
+#include "corofx/state.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+
+using namespace corofx;
+
+namespace {
+
+struct state_get {
+    using return_type = int;
+};
+
+struct state_put {
+    using return_type = void;
+
+    int x{};
+};
+
+constexpr auto ops = std::size_t{10'000'000};
+constexpr auto depth = 100;
+
+// The loop runs `depth` tasks below the handlers, as in `examples/state.cpp`.
+auto countdown(int d) -> task<void, state_get, state_put> { // NOLINT(misc-no-recursion)
+    if (d == 0) {
+        for (auto i = co_await state_get{}; i > 0; i = co_await state_get{}) {
+            co_await state_put{i - 1};
+        }
+    } else {
+        co_await countdown(d - 1);
+    }
+    co_return {};
+}
+
+auto builtin_countdown(int d) -> task<void, state<int>> { // NOLINT(misc-no-recursion)
+    if (d == 0) {
+        for (auto i = co_await state<int>::get(); i > 0; i = co_await state<int>::get()) {
+            co_await state<int>::put(i - 1);
+        }
+    } else {
+        co_await builtin_countdown(d - 1);
+    }
+    co_return {};
+}
+
+auto state_frame(std::size_t n) -> void {
+    auto x = static_cast<int>(n / 2);
+    countdown(depth)
+        .with(
+            handler_of<state_put>([&](auto&& e, auto&& resume) -> task<void> {
+                x = e.x;
+                co_return resume();
+            }),
+            handler_of<state_get>([&](auto&&, auto&& resume) -> task<void> {
+                co_return resume(x);
+            }))();
+    bench::do_not_optimize(x);
+}
+
+auto state_tail(std::size_t n) -> void {
+    auto x = static_cast<int>(n / 2);
+    countdown(depth)
+        .with(
+            tail_handler_of<state_put>([&](state_put&& e) { x = e.x; }),
+            tail_handler_of<state_get>([&](state_get&&) { return x; }))();
+    bench::do_not_optimize(x);
+}
+
+auto state_builtin(std::size_t n) -> void {
+    builtin_countdown(depth).with(state_handler_of(static_cast<int>(n / 2)))();
+}
+
+auto const registered = bench::add({
+    {"state/depth:100/frame", ops, state_frame},
+    {"state/depth:100/tail", ops, state_tail},
+    {"state/depth:100/builtin", ops, state_builtin},
+});
+
+} // namespace
@@ -0,0 +1,95 @@
+#include "bench.hpp"
+#include "corofx/stream.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace corofx;
+
+namespace {
+
+constexpr auto ops = std::size_t{10'000'000};
+
+using u64 = std::uint64_t;
+
+struct is_odd {
+    auto operator()(u64 x) const -> bool { return x % 2 == 1; }
+};
+
+struct triple {
+    auto operator()(u64 x) const -> u64 { return x * 3; }
+};
+
+struct plus {
+    auto operator()(u64 acc, u64 x) const -> u64 { return acc + x; }
+};
+
+auto source(std::size_t n) -> task<void, emit<u64>> {
+    for (auto i = u64{}; i < n; ++i) {
+        if (not co_await emit{i}) break;
+    }
+    co_return {};
+}
+
+auto hand_written(std::size_t n) -> void {
+    auto sum = u64{};
+    auto left = n / 2;
+    for (auto i = u64{}; i < n and left > 0; ++i) {
+        if (not is_odd{}(i)) continue;
+        sum += triple{}(i);
+        --left;
+    }
+    bench::do_not_optimize(sum);
+}
+
+auto fused(std::size_t n) -> void {
+    auto sum = stream<u64>{source(n)}.filter(is_odd{}).map(triple{}).take(n / 2).fold(
+        u64{}, plus{})();
+    bench::do_not_optimize(sum);
+}
+
+// The same stages written as handlers that re-emit, each with its own frame per element.
+auto filtered(std::size_t n) -> task<void, emit<u64>> {
+    co_await source(n).with(
+        handler_of<emit<u64>>([](auto&& e, auto&& resume) -> task<void, emit<u64>> {
+            if (not is_odd{}(e.value)) co_return resume(true);
+            co_return resume(co_await emit{e.value});
+        }));
+    co_return {};
+}
+
+auto mapped(std::size_t n) -> task<void, emit<u64>> {
+    co_await filtered(n).with(
+        handler_of<emit<u64>>([](auto&& e, auto&& resume) -> task<void, emit<u64>> {
+            co_return resume(co_await emit{triple{}(e.value)});
+        }));
+    co_return {};
+}
+
+auto taken(std::size_t n) -> task<void, emit<u64>> {
+    auto left = n / 2;
+    co_await mapped(n).with(
+        handler_of<emit<u64>>([&](auto&& e, auto&& resume) -> task<void, emit<u64>> {
+            --left;
+            co_return resume(co_await emit{e.value} and left > 0);
+        }));
+    co_return {};
+}
+
+auto stacked(std::size_t n) -> void {
+    auto sum = u64{};
+    taken(n).with(tail_handler_of<emit<u64>>([&](emit<u64>&& e) {
+        sum = plus{}(sum, e.value);
+        return true;
+    }))();
+    bench::do_not_optimize(sum);
+}
+
+auto const registered = bench::add({
+    {"stream/filter_map_take/loop", ops, hand_written},
+    {"stream/filter_map_take/fused", ops, fused},
+    {"stream/filter_map_take/stacked", ops, stacked},
+});
+
+} // namespace
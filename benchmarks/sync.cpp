@@ -0,0 +1,72 @@
+#include "bench.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/sync.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+using namespace corofx;
+
+namespace {
+
+constexpr auto ops = std::size_t{1'000'000};
+
+auto increment_async(async_mutex& m, std::uint64_t* counter, std::size_t n)
+    -> task<void, lock> {
+    for (auto i = std::size_t{}; i < n; ++i) {
+        co_await lock{m};
+        ++*counter;
+        m.unlock();
+    }
+    co_return {};
+}
+
+auto worker(std::mutex& m, std::uint64_t* counter, std::size_t n) -> task<void> {
+    for (auto i = std::size_t{}; i < n; ++i) {
+        auto guard = std::lock_guard{m};
+        ++*counter;
+    }
+    co_return {};
+}
+
+auto worker(async_mutex& m, std::uint64_t* counter, std::size_t n) -> task<void, suspend> {
+    co_await increment_async(m, counter, n).with(sync_handler_of<lock>());
+    co_return {};
+}
+
+template<typename Mutex>
+auto run_all(Mutex& m, std::uint64_t* counter, std::size_t threads, std::size_t n)
+    -> task<void, spawn, join, suspend> {
+    auto handles = std::vector<job_handle>{};
+    for (auto i = std::size_t{}; i < threads; ++i) {
+        handles.push_back(co_await spawn{worker(m, counter, n / threads)});
+    }
+    for (auto& h : handles) co_await join{h};
+    co_return {};
+}
+
+// One task per worker increments a shared counter under the mutex.
+template<typename Mutex, std::size_t Threads>
+auto contend(std::size_t n) -> void {
+    auto sched = scheduler{Threads};
+    auto m = Mutex{};
+    auto counter = std::uint64_t{};
+    sched.run(run_all(m, &counter, Threads, n));
+    bench::do_not_optimize(counter);
+}
+
+auto const registered = bench::add({
+    {"sync/mutex/threads:1/async", ops, contend<async_mutex, 1>},
+    {"sync/mutex/threads:1/std", ops, contend<std::mutex, 1>},
+    {"sync/mutex/threads:2/async", ops, contend<async_mutex, 2>},
+    {"sync/mutex/threads:2/std", ops, contend<std::mutex, 2>},
+    {"sync/mutex/threads:4/async", ops, contend<async_mutex, 4>},
+    {"sync/mutex/threads:4/std", ops, contend<std::mutex, 4>},
+    {"sync/mutex/threads:8/async", ops, contend<async_mutex, 8>},
+    {"sync/mutex/threads:8/std", ops, contend<std::mutex, 8>},
+});
+
+} // namespace
@@ -0,0 +1,94 @@
+#include "bench.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+using namespace corofx;
+
+namespace {
+
+struct state_get {
+    using return_type = int;
+};
+
+struct state_put {
+    using return_type = void;
+
+    int x{};
+};
+
+struct yield {
+    using return_type = bool;
+
+    int i{};
+};
+
+constexpr auto ops = std::size_t{10'000'000};
+
+auto countdown() -> task<void, state_get, state_put> {
+    for (auto i = co_await state_get{}; i > 0; i = co_await state_get{}) {
+        co_await state_put{i - 1};
+    }
+    co_return {};
+}
+
+auto traverse(std::vector<int> const& xs) -> task<void, yield> {
+    for (auto x : xs) {
+        if (not co_await yield{x}) break;
+    }
+    co_return {};
+}
+
+auto state_frame(std::size_t n) -> void {
+    auto x = static_cast<int>(n / 2);
+    countdown()
+        .with(
+            handler_of<state_put>([&](auto&& e, auto&& resume) -> task<void> {
+                x = e.x;
+                co_return resume();
+            }),
+            handler_of<state_get>([&](auto&&, auto&& resume) -> task<void> {
+                co_return resume(x);
+            }))();
+    bench::do_not_optimize(x);
+}
+
+auto state_tail(std::size_t n) -> void {
+    auto x = static_cast<int>(n / 2);
+    countdown()
+        .with(
+            tail_handler_of<state_put>([&](state_put&& e) { x = e.x; }),
+            tail_handler_of<state_get>([&](state_get&&) { return x; }))();
+    bench::do_not_optimize(x);
+}
+
+auto yield_frame(std::size_t n) -> void {
+    auto xs = std::vector<int>(n, 1);
+    auto sum = 0;
+    traverse(xs).with(handler_of<yield>([&](auto&& e, auto&& resume) -> task<void> {
+        sum += e.i;
+        co_return resume(true);
+    }))();
+    bench::do_not_optimize(sum);
+}
+
+auto yield_tail(std::size_t n) -> void {
+    auto xs = std::vector<int>(n, 1);
+    auto sum = 0;
+    traverse(xs).with(tail_handler_of<yield>([&](yield&& e) {
+        sum += e.i;
+        return true;
+    }))();
+    bench::do_not_optimize(sum);
+}
+
+auto const registered = bench::add({
+    {"state/handler_of", ops, state_frame},
+    {"state/tail_handler_of", ops, state_tail},
+    {"yield/handler_of", ops, yield_frame},
+    {"yield/tail_handler_of", ops, yield_tail},
+});
+
+} // namespace
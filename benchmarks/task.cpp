@@ -0,0 +1,60 @@
+#include "bench.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <utility>
+
+using namespace corofx;
+
+namespace {
+
+struct bar {
+    using return_type = int;
+
+    int x{};
+};
+
+constexpr auto ops = std::size_t{10'000'000};
+
+auto identity(int x) -> task<int> { co_return x; }
+
+auto do_bar(std::size_t n) -> task<int, bar> {
+    auto x = 0;
+    for (auto i = std::size_t{}; i < n; ++i) x = co_await bar{x};
+    co_return x;
+}
+
+auto create_run(std::size_t n) -> void {
+    for (auto i = std::size_t{}; i < n; ++i) {
+        auto x = identity(static_cast<int>(i))();
+        bench::do_not_optimize(x);
+    }
+}
+
+auto perform_resume(std::size_t n) -> void {
+    auto x = do_bar(n).with(handler_of<bar>([](auto&& e, auto&& resume) -> task<int> {
+        co_return resume(e.x + 1);
+    }))();
+    bench::do_not_optimize(x);
+}
+
+auto handled_task_move(std::size_t n) -> void {
+    auto t = do_bar(0).with(handler_of<bar>([](auto&& e, auto&& resume) -> task<int> {
+        co_return resume(e.x);
+    }));
+    for (auto i = std::size_t{}; i < n; ++i) {
+        auto moved = std::move(t);
+        bench::do_not_optimize(moved);
+        t = std::move(moved);
+    }
+    auto x = std::move(t)();
+    bench::do_not_optimize(x);
+}
+
+auto const registered = bench::add({
+    {"task/create_run", ops, create_run},
+    {"task/perform_resume", ops, perform_resume},
+    {"task/handled_task_move", ops, handled_task_move},
+});
+
+} // namespace
@@ -0,0 +1,67 @@
+#include "bench.hpp"
+#include "corofx/detail/timer_wheel.hpp"
+#include "corofx/net.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+#include "corofx/timer.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace corofx;
+using detail::timer_node;
+using detail::timer_wheel;
+
+namespace {
+
+constexpr auto ops = std::size_t{1'000'000};
+constexpr auto sleepers = std::size_t{100'000};
+
+// A cheap deterministic spread of deadlines over several wheel levels.
+auto deadline_of(std::size_t i) -> std::uint64_t { return (i * 2654435761u) % 1'000'000; }
+
+auto insert_cancel(std::size_t n) -> void {
+    auto wheel = timer_wheel{};
+    auto node = timer_node{};
+    for (auto i = std::size_t{}; i < n; ++i) {
+        wheel.insert(node, deadline_of(i));
+        wheel.cancel(node);
+    }
+    bench::do_not_optimize(wheel);
+}
+
+auto insert_expire(std::size_t n) -> void {
+    auto wheel = timer_wheel{};
+    auto nodes = std::vector<timer_node>(n);
+    for (auto i = std::size_t{}; i < n; ++i) wheel.insert(nodes[i], deadline_of(i));
+    auto fired = std::size_t{};
+    wheel.advance(1'000'000, [&](timer_node&) { ++fired; });
+    bench::do_not_optimize(fired);
+}
+
+auto sleeper(std::size_t i) -> task<void, sleep_for> {
+    co_await sleep_for{std::chrono::microseconds{deadline_of(i) % 10'000}};
+    co_return {};
+}
+
+auto spawn_sleepers(std::size_t n) -> task<void, spawn, sleep_for> {
+    for (auto i = std::size_t{}; i < n; ++i) co_await spawn{sleeper(i)};
+    co_return {};
+}
+
+// Each operation is one task that sleeps up to 10ms, all of them concurrently.
+auto reactor_sleep(std::size_t n) -> void {
+    auto r = reactor{};
+    r.run(spawn_sleepers(n));
+    bench::do_not_optimize(r.timer_slack());
+}
+
+auto const registered = bench::add({
+    {"timer/wheel/insert_cancel", ops, insert_cancel},
+    {"timer/wheel/insert_expire", ops, insert_expire},
+    {"timer/reactor/sleepers:100000", sleepers, reactor_sleep},
+});
+
+} // namespace
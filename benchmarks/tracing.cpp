@@ -0,0 +1,27 @@
+#include "bench.hpp"
+#include "corofx/tracing.hpp"
+
+#include <cstddef>
+
+using namespace corofx;
+
+namespace {
+
+constexpr auto ops = std::size_t{1'000'000};
+
+struct ask {};
+
+// The cost of recording one event when tracing is enabled.
+auto emit(std::size_t n) -> void {
+    for (auto i = std::size_t{}; i < n; ++i) {
+        tracing::detail::emit(
+            tracing::event_kind::effect_perform, &i, &tracing::detail::label_of<ask>);
+        bench::do_not_optimize(i);
+    }
+}
+
+auto const registered = bench::add({
+    {"tracing/emit", ops, emit},
+});
+
+} // namespace
@@ -0,0 +1,64 @@
+#include "bench.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+#include "corofx/when.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace corofx;
+
+namespace {
+
+constexpr auto requests = std::size_t{1'000};
+constexpr auto fan_out = std::size_t{8};
+constexpr auto work_per_backend = 20'000;
+
+// Stands in for a call to one backend.
+auto backend(std::uint64_t seed) -> task<std::uint64_t> {
+    auto x = seed + 1;
+    for (auto i = 0; i < work_per_backend; ++i) x = x * 6364136223846793005 + 1442695040888963407;
+    co_return x;
+}
+
+auto serial_request(std::uint64_t id) -> task<std::uint64_t> {
+    auto x = std::uint64_t{};
+    for (auto i = std::uint64_t{}; i < fan_out; ++i) x ^= co_await backend(id * fan_out + i);
+    co_return x;
+}
+
+auto concurrent_request(std::uint64_t id) -> task<std::uint64_t, spawn, join> {
+    auto calls = std::vector<task<std::uint64_t>>{};
+    for (auto i = std::uint64_t{}; i < fan_out; ++i) calls.push_back(backend(id * fan_out + i));
+    auto x = std::uint64_t{};
+    for (auto r : co_await when_all(std::move(calls))) x ^= r;
+    co_return x;
+}
+
+// Requests are handled one at a time, so the time per request is its latency.
+template<bool Concurrent>
+auto requests_loop(std::size_t n) -> task<std::uint64_t, spawn, join> {
+    auto x = std::uint64_t{};
+    for (auto i = std::uint64_t{}; i < n; ++i) {
+        if constexpr (Concurrent) {
+            x ^= co_await concurrent_request(i);
+        } else {
+            x ^= co_await serial_request(i);
+        }
+    }
+    co_return x;
+}
+
+template<bool Concurrent>
+auto fan_out_requests(std::size_t n) -> void {
+    auto sched = scheduler{fan_out};
+    bench::do_not_optimize(sched.run(requests_loop<Concurrent>(n)));
+}
+
+auto const registered = bench::add({
+    {"when_all/fan_out:8/serial", requests, fan_out_requests<false>},
+    {"when_all/fan_out:8/concurrent", requests, fan_out_requests<true>},
+});
+
+} // namespace
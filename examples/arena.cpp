@@ -0,0 +1,42 @@
+#include "corofx/frame_resource.hpp"
+#include "corofx/task.hpp"
+
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <memory_resource>
+
+using namespace corofx;
+
+struct lookup {
+    using return_type = int;
+
+    int key{};
+};
+
+auto sum_keys(int first, int count) -> task<int, lookup> { // NOLINT(misc-no-recursion)
+    if (count == 1) co_return co_await lookup{first};
+    auto half = count / 2;
+    co_return co_await sum_keys(first, half) + co_await sum_keys(first + half, count - half);
+}
+
+// Every frame of a request, including handler frames, comes from a per-request arena that is
+// released in one shot when the request is done.
+auto handle_request(int id, std::pmr::monotonic_buffer_resource& arena) -> int {
+    auto scope = frame_resource_scope{&arena};
+    auto result = sum_keys(id * 10, 10).with(
+        handler_of<lookup>([](lookup&& e, auto& resume) -> task<int> {
+            co_return resume(e.key * e.key);
+        }))();
+    arena.release();
+    return result;
+}
+
+auto main() -> int {
+    // The arena starts from a stack buffer, so small requests never touch the heap.
+    auto buffer = std::array<std::byte, 16 * 1024>{};
+    auto arena = std::pmr::monotonic_buffer_resource{buffer.data(), buffer.size()};
+    for (auto id = 0; id < 3; ++id) {
+        std::cout << "request " << id << ": " << handle_request(id, arena) << '\n';
+    }
+}
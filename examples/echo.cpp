@@ -0,0 +1,104 @@
+#include "corofx/net.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace corofx;
+
+constexpr auto num_clients = 3;
+constexpr auto num_messages = 2;
+
+auto write_all(int fd, std::span<std::byte const> data) -> task<bool, net_write> {
+    while (not data.empty()) {
+        auto n = co_await net_write{fd, data};
+        if (n <= 0) co_return false;
+        data = data.subspan(static_cast<std::size_t>(n));
+    }
+    co_return true;
+}
+
+auto echo(int fd) -> task<void, net_read, net_write> {
+    auto buffer = std::array<std::byte, 4096>{};
+    for (auto n = co_await net_read{fd, buffer}; n > 0; n = co_await net_read{fd, buffer}) {
+        if (not co_await write_all(fd, std::span{buffer}.first(static_cast<std::size_t>(n)))) {
+            break;
+        }
+    }
+    ::close(fd);
+    co_return {};
+}
+
+auto server(int listener) -> task<void, spawn, join, net_accept> {
+    auto connections = std::vector<job_handle>{};
+    for (auto i = 0; i < num_clients; ++i) {
+        auto fd = co_await net_accept{listener};
+        if (fd < 0) break;
+        connections.push_back(co_await spawn{echo(fd)});
+    }
+    for (auto& c : connections) co_await join{c};
+    co_return {};
+}
+
+auto client(int fd, int id) -> task<void, net_read, net_write> {
+    for (auto i = 0; i < num_messages; ++i) {
+        auto message = "client " + std::to_string(id) + " message " + std::to_string(i);
+        co_await write_all(fd, std::as_bytes(std::span{message}));
+        auto reply = std::string(message.size(), '\0');
+        auto buffer = std::as_writable_bytes(std::span{reply});
+        auto received = std::size_t{};
+        while (received < reply.size()) {
+            auto n = co_await net_read{fd, buffer.subspan(received)};
+            if (n <= 0) break;
+            received += static_cast<std::size_t>(n);
+        }
+        std::cout << "echoed: " << reply << "\n";
+    }
+    ::close(fd);
+    co_return {};
+}
+
+auto connect_to(sockaddr_in const& addr) -> int {
+    auto fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ::connect(fd, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr));
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+auto echo_demo(int listener, sockaddr_in addr)
+    -> task<void, spawn, join, net_accept, net_read, net_write> {
+    auto tasks = std::vector<job_handle>{};
+    tasks.push_back(co_await spawn{server(listener)});
+    for (auto id = 0; id < num_clients; ++id) {
+        tasks.push_back(co_await spawn{client(connect_to(addr), id)});
+    }
+    for (auto& t : tasks) co_await join{t};
+    co_return {};
+}
+
+auto main() -> int {
+    auto listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    auto addr = sockaddr_in{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    auto len = socklen_t{sizeof(addr)};
+    ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::listen(listener, num_clients);
+    ::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+
+    auto r = reactor{};
+    r.run(echo_demo(listener, addr));
+    ::close(listener);
+}
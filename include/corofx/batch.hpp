@@ -0,0 +1,275 @@
+#pragma once
+
+#include "check.hpp"
+#include "detail/type_set.hpp"
+#include "effect.hpp"
+#include "frame.hpp"
+#include "frame_resource.hpp"
+#include "handler.hpp"
+#include "scheduler.hpp"
+#include "task.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace corofx {
+
+struct batch_options {
+    // A batch is sent as soon as it holds this many effects.
+    std::size_t max_size{256};
+    // A batch is sent at the latest this long after its first effect, even if tasks keep joining.
+    std::chrono::steady_clock::duration max_delay{std::chrono::milliseconds{1}};
+};
+
+struct batch_stats {
+    // Bulk calls made.
+    std::uint64_t batches{};
+    // Effects answered by them.
+    std::uint64_t effects{};
+};
+
+namespace detail {
+
+// Effects sent together in one bulk call.
+template<effect E>
+class batch {
+public:
+    using value_type = value_holder<typename E::return_type>;
+
+    // Parks a task until the results are in. Used as a `suspend` callback.
+    static auto park(waker w, void* arg) noexcept -> void {
+        auto& b = *static_cast<batch*>(arg);
+        auto lock = std::unique_lock{b.mutex_};
+        if (b.done_) {
+            lock.unlock();
+            w.wake();
+            return;
+        }
+        b.parked_.push_back(w);
+    }
+
+    // Stores the results and wakes every parked task.
+    auto complete(std::vector<value_type> results) -> void {
+        check(results.size() == effects_.size());
+        auto parked = std::vector<waker>{};
+        {
+            auto lock = std::lock_guard{mutex_};
+            results_ = std::move(results);
+            done_ = true;
+            parked.swap(parked_);
+        }
+        for (auto w : parked) w.wake();
+    }
+
+    [[nodiscard]]
+    auto done() const -> bool {
+        auto lock = std::lock_guard{mutex_};
+        return done_;
+    }
+
+    // Returns the result of the effect at `index`, once the batch is done.
+    [[nodiscard]]
+    auto take(std::size_t index) -> value_type {
+        auto lock = std::lock_guard{mutex_};
+        check(done_);
+        return std::move(results_[index]);
+    }
+
+private:
+    template<effect, typename>
+    friend class batcher;
+
+    // Guarded by the batcher until the batch is closed.
+    std::vector<E> effects_;
+    bool closed_{};
+
+    mutable std::mutex mutex_;
+    std::vector<value_type> results_;
+    std::vector<waker> parked_;
+    bool done_{};
+};
+
+// Collects effects into batches and sends them with `bulk`.
+template<effect E, typename F>
+class batcher {
+public:
+    using batch_type = batch<E>;
+
+    struct ticket {
+        std::shared_ptr<batch_type> batch;
+        std::size_t index;
+        // The first effect of a batch waits for the batch to fill up.
+        bool leader;
+    };
+
+    batcher(F bulk, batch_options const& options) noexcept
+        : bulk_{std::move(bulk)}, options_{options} {
+        check(options_.max_size > 0);
+    }
+
+    // Adds an effect to the open batch, and sends the batch if that filled it.
+    [[nodiscard]]
+    auto join(E&& eff) -> ticket {
+        auto lock = std::unique_lock{mutex_};
+        auto leader = not open_;
+        if (leader) open_ = std::make_shared<batch_type>();
+        auto b = open_;
+        auto index = b->effects_.size();
+        b->effects_.push_back(std::move(eff));
+        if (b->effects_.size() >= options_.max_size) {
+            close(*b);
+            lock.unlock();
+            send(*b);
+        }
+        return {.batch = std::move(b), .index = index, .leader = leader};
+    }
+
+    // Returns the number of effects in a batch, or nothing if it was closed.
+    [[nodiscard]]
+    auto size(batch_type const& b) -> std::optional<std::size_t> {
+        auto lock = std::lock_guard{mutex_};
+        if (b.closed_) return std::nullopt;
+        return b.effects_.size();
+    }
+
+    // Sends a batch unless it was already sent.
+    auto flush(batch_type& b) -> void {
+        {
+            auto lock = std::lock_guard{mutex_};
+            if (b.closed_) return;
+            close(b);
+        }
+        send(b);
+    }
+
+    [[nodiscard]]
+    auto options() const noexcept -> batch_options const& {
+        return options_;
+    }
+
+    [[nodiscard]]
+    auto stats() const noexcept -> batch_stats {
+        return {
+            .batches = batches_.load(std::memory_order_relaxed),
+            .effects = effects_.load(std::memory_order_relaxed),
+        };
+    }
+
+private:
+    auto close(batch_type& b) noexcept -> void {
+        b.closed_ = true;
+        if (open_.get() == &b) open_.reset();
+    }
+
+    auto send(batch_type& b) -> void {
+        batches_.fetch_add(1, std::memory_order_relaxed);
+        effects_.fetch_add(b.effects_.size(), std::memory_order_relaxed);
+        b.complete(bulk_(std::span<E const>{b.effects_}));
+    }
+
+    F bulk_;
+    batch_options options_;
+    std::mutex mutex_;
+    std::shared_ptr<batch_type> open_;
+    std::atomic<std::uint64_t> batches_;
+    std::atomic<std::uint64_t> effects_;
+};
+
+// Handles one effect as part of a batch.
+// The leader of a batch yields until a round of every other ready task adds nothing to it, then
+// sends it. Other tasks park until the batch is sent.
+template<effect E, typename F>
+auto handle_batched(std::shared_ptr<batcher<E, F>> b, E eff, resumer<E>& resume)
+    -> task<void, yield_thread, suspend> {
+    auto t = b->join(std::move(eff));
+    if (t.leader) {
+        auto start = std::chrono::steady_clock::now();
+        auto size = b->size(*t.batch);
+        while (size) {
+            co_await yield_thread{};
+            auto n = b->size(*t.batch);
+            if (n == size or std::chrono::steady_clock::now() - start >= b->options().max_delay) {
+                break;
+            }
+            size = n;
+        }
+        b->flush(*t.batch);
+    }
+    if (not t.batch->done()) co_await suspend{&batch<E>::park, t.batch.get()};
+    co_return resume(t.batch->take(t.index));
+}
+
+} // namespace detail
+
+// A handler entry that sends effects from many tasks to `bulk` together.
+// `bulk(std::span<E const>)` returns the results in the same order. Effects wait for a batch to
+// fill up until every other ready task has had a chance to join it, so tasks spawned together
+// share one bulk call. Copies share their batches.
+template<effect E, typename F>
+class batching_handler : public handler<E> {
+public:
+    using effect_type = E;
+    using effect_types = detail::type_set<yield_thread, suspend>;
+
+    static constexpr bool tail_resumptive = false;
+
+    explicit batching_handler(std::shared_ptr<detail::batcher<E, F>> b) noexcept
+        : batcher_{std::move(b)}, resource_{detail::current_frame_resource()} {}
+
+    [[nodiscard]]
+    auto handle(E&& eff, resumer<E>& resume, frame<>& storage) noexcept
+        -> std::coroutine_handle<> final {
+        using task_type = task<void, yield_thread, suspend>;
+        auto resource = frame_resource_scope{resource_};
+        storage = detail::handle_batched(batcher_, std::move(eff), resume);
+        auto h = task_type::handle_type::from_address((*storage).address());
+        h.promise().set_evidence(evidence_);
+        return h;
+    }
+
+    [[nodiscard]]
+    auto stats() const noexcept -> batch_stats {
+        return batcher_->stats();
+    }
+
+    // Handler tasks run with the evidence in scope outside of the handler.
+    auto set_evidence(evidence const* ev) noexcept -> void { evidence_ = ev; }
+
+    // Every effect resumes its producer, so the handled task never completes through the handler.
+    auto set_cont(std::coroutine_handle<>) noexcept -> void {}
+
+    template<typename Output>
+    auto set_output(Output&) noexcept -> void {}
+
+private:
+    std::shared_ptr<detail::batcher<E, F>> batcher_;
+    std::pmr::memory_resource* resource_;
+    evidence const* evidence_{};
+};
+
+// Creates a batching handler entry for `E`, which must be movable and whose results are sent back
+// by `bulk` in order. The handled task also performs `yield_thread` and `suspend`, so it runs on an
+// executor such as `scheduler` or `reactor`.
+template<effect E, typename F>
+    requires std::same_as<
+        std::invoke_result_t<F&, std::span<E const>>,
+        std::vector<value_holder<typename E::return_type>>>
+[[nodiscard]]
+auto batch_handler_of(F bulk, batch_options const& options = {}) -> batching_handler<E, F> {
+    return batching_handler<E, F>{
+        std::make_shared<detail::batcher<E, F>>(std::move(bulk), options)};
+}
+
+} // namespace corofx
@@ -0,0 +1,297 @@
+#pragma once
+
+#include "config.hpp"
+#include "detail/ring_buffer.hpp"
+#include "scheduler.hpp"
+#include "task.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace corofx {
+
+namespace detail {
+
+enum class chan_dir : std::uint8_t {
+    recv,
+    send,
+};
+
+// A task waiting on one or more channels. The first channel to claim it wakes it up.
+struct chan_wait {
+    enum class state : std::uint8_t {
+        registering,
+        waiting,
+        claimed,
+    };
+
+    // Claims the task and returns its previous state. Only a task claimed while `waiting` must
+    // be woken up by the claimer; one claimed while `registering` wakes itself up.
+    [[nodiscard]]
+    auto claim() noexcept -> state {
+        auto s = current.load(std::memory_order_seq_cst);
+        while (s != state::claimed and
+               not current.compare_exchange_weak(s, state::claimed, std::memory_order_seq_cst)) {}
+        return s;
+    }
+
+    std::atomic<state> current{state::registering};
+    waker w;
+};
+
+// The registration of a waiting task on one channel.
+struct chan_node {
+    chan_wait* wait{};
+    chan_node* prev{};
+    chan_node* next{};
+    bool linked{};
+};
+
+// An intrusive FIFO list of waiting tasks.
+class chan_list {
+public:
+    COROFX_PUBLIC auto push_back(chan_node& n) noexcept -> void;
+    COROFX_PUBLIC auto remove(chan_node& n) noexcept -> void;
+    [[nodiscard]]
+    COROFX_PUBLIC auto pop_front() noexcept -> chan_node*;
+
+private:
+    chan_node* head_{};
+    chan_node* tail_{};
+};
+
+// The part of a channel that does not depend on its element type: closing and parking.
+//
+// Values only ever go through the lock-free ring buffer. The lock guards the lists of parked
+// tasks, and is only taken when a counter says that some task may be parked. A task parks by
+// registering itself and then re-checking the buffer, while the other side updates the buffer
+// and then checks the counter, so one of them always sees the other.
+class channel_state {
+public:
+    explicit channel_state(ring_index const& ring) noexcept : ring_{&ring} {}
+
+    [[nodiscard]]
+    auto closed() const noexcept -> bool {
+        return closed_.load(std::memory_order_seq_cst);
+    }
+
+    // Wakes up every parked task.
+    COROFX_PUBLIC auto close() noexcept -> void;
+
+    // Registers a task waiting to receive or send.
+    // Returns true if the channel may already be ready, in which case the task should not wait.
+    [[nodiscard]]
+    COROFX_PUBLIC auto park(chan_node& n, chan_dir dir) noexcept -> bool;
+
+    COROFX_PUBLIC auto unpark(chan_node& n, chan_dir dir) noexcept -> void;
+
+    // Wakes up another task waiting to receive or send if the channel is still ready, for a task
+    // that was woken up but went on without using it.
+    auto pass_on(chan_dir dir) noexcept -> void {
+        if (dir == chan_dir::recv ? not ring_->empty() : not ring_->full()) notify(dir);
+    }
+
+    // Wakes up one task waiting to receive or send, if any.
+    auto notify(chan_dir dir) noexcept -> void {
+        // An RMW orders the preceding push or pop before the check.
+        if (waiting(dir).fetch_add(0, std::memory_order_seq_cst) != 0) notify_slow(dir);
+    }
+
+private:
+    [[nodiscard]]
+    auto waiting(chan_dir dir) noexcept -> std::atomic<std::size_t>& {
+        return waiting_[static_cast<std::size_t>(dir)];
+    }
+
+    [[nodiscard]]
+    auto parked(chan_dir dir) noexcept -> chan_list& {
+        return parked_[static_cast<std::size_t>(dir)];
+    }
+
+    COROFX_PUBLIC auto notify_slow(chan_dir dir) noexcept -> void;
+
+    ring_index const* ring_;
+    std::atomic<bool> closed_{};
+    alignas(64) std::array<std::atomic<std::size_t>, 2> waiting_{};
+    std::mutex mutex_;
+    std::array<chan_list, 2> parked_{};
+};
+
+// Parks a task on several channels at once, through `suspend`.
+struct chan_park {
+    // Null states are skipped.
+    std::span<channel_state* const> states;
+    std::span<chan_node> nodes;
+    chan_dir dir{};
+    chan_wait wait{};
+};
+
+COROFX_PUBLIC auto park_on(waker w, void* park) noexcept -> void;
+COROFX_PUBLIC auto unpark_all(chan_park& park) noexcept -> void;
+
+struct chan_access;
+
+} // namespace detail
+
+enum class send_status : std::uint8_t {
+    sent,
+    full,
+    closed,
+};
+
+// A bounded multi-producer multi-consumer channel.
+//
+// Values are passed through a lock-free ring buffer. Tasks that find it full or empty are parked
+// with `suspend` and woken up by the other side, so that no thread ever blocks on a channel.
+// The capacity is rounded up to a power of two, and is at least 2.
+template<typename T>
+    requires std::is_nothrow_move_constructible_v<T>
+class channel {
+public:
+    explicit channel(std::size_t capacity) : ring_{capacity}, state_{ring_} {}
+
+    channel(channel const&) = delete;
+    channel(channel&&) = delete;
+    auto operator=(channel const&) -> channel& = delete;
+    auto operator=(channel&&) -> channel& = delete;
+
+    ~channel() = default;
+
+    [[nodiscard]]
+    auto capacity() const noexcept -> std::size_t {
+        return ring_.capacity();
+    }
+
+    // Checks if the channel has been closed. Values sent before may still be received.
+    [[nodiscard]]
+    auto closed() const noexcept -> bool {
+        return state_.closed();
+    }
+
+    // Sends without waiting. `value` is moved from only if it is sent.
+    [[nodiscard]]
+    auto try_send(T& value) noexcept -> send_status {
+        if (state_.closed()) return send_status::closed;
+        if (not ring_.try_push(value)) {
+            return state_.closed() ? send_status::closed : send_status::full;
+        }
+        state_.notify(detail::chan_dir::recv);
+        return send_status::sent;
+    }
+
+    // Receives without waiting. Returns `std::nullopt` if the channel is empty.
+    [[nodiscard]]
+    auto try_recv() noexcept -> std::optional<T> {
+        auto value = ring_.try_pop();
+        if (value) state_.notify(detail::chan_dir::send);
+        return value;
+    }
+
+    // Makes further sends fail and wakes up every parked task.
+    auto close() noexcept -> void { state_.close(); }
+
+private:
+    friend struct detail::chan_access;
+
+    detail::ring_buffer<T> ring_;
+    detail::channel_state state_;
+};
+
+namespace detail {
+
+struct chan_access {
+    template<typename T>
+    [[nodiscard]]
+    static auto state(channel<T>& ch) noexcept -> channel_state& {
+        return ch.state_;
+    }
+};
+
+} // namespace detail
+
+// Sends a value, waiting while the channel is full. Returns false if the channel is closed.
+template<typename T>
+auto send(channel<T>& ch, T value) -> task<bool, suspend> {
+    auto states = std::array{&detail::chan_access::state(ch)};
+    auto nodes = std::array<detail::chan_node, 1>{};
+    while (true) {
+        switch (ch.try_send(value)) {
+        case send_status::sent: co_return true;
+        case send_status::closed: co_return false;
+        case send_status::full: break;
+        }
+        auto park = detail::chan_park{states, nodes, detail::chan_dir::send};
+        co_await suspend{&detail::park_on, &park};
+        detail::unpark_all(park);
+    }
+}
+
+// Receives a value, waiting while the channel is empty.
+// Returns `std::nullopt` once the channel is closed and drained.
+template<typename T>
+auto recv(channel<T>& ch) -> task<std::optional<T>, suspend> {
+    auto states = std::array{&detail::chan_access::state(ch)};
+    auto nodes = std::array<detail::chan_node, 1>{};
+    while (true) {
+        if (auto value = ch.try_recv()) co_return value;
+        if (ch.closed()) co_return ch.try_recv();
+        auto park = detail::chan_park{states, nodes, detail::chan_dir::recv};
+        co_await suspend{&detail::park_on, &park};
+        detail::unpark_all(park);
+    }
+}
+
+// Receives a value from whichever channel has one first, waiting while they are all empty.
+// The index of the variant tells which channel it came from; earlier channels take priority.
+// Returns `std::nullopt` once every channel is closed and drained.
+template<typename... Ts>
+    requires(sizeof...(Ts) != 0)
+auto select(channel<Ts>&... chs) -> task<std::optional<std::variant<Ts...>>, suspend> {
+    using result_type = std::optional<std::variant<Ts...>>;
+    auto nodes = std::array<detail::chan_node, sizeof...(Ts)>{};
+    auto woken = false;
+    while (true) {
+        auto result = result_type{};
+        auto open = false;
+        auto try_one = [&]<std::size_t I>(std::integral_constant<std::size_t, I>, auto& ch) {
+            if (auto value = ch.try_recv()) {
+                result.emplace(std::in_place_index<I>, std::move(*value));
+                return true;
+            }
+            if (not ch.closed()) open = true;
+            return false;
+        };
+        [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+            static_cast<void>((try_one(std::integral_constant<std::size_t, Is>{}, chs) or ...));
+        }(std::index_sequence_for<Ts...>{});
+        if (result or not open) {
+            // A channel that woke this task but was not taken from woke no other receiver, so
+            // its wake-up is passed on.
+            if (woken) {
+                auto taken = result ? result->index() : sizeof...(Ts);
+                [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+                    ((Is != taken ? detail::chan_access::state(chs).pass_on(detail::chan_dir::recv)
+                                  : void()),
+                     ...);
+                }(std::index_sequence_for<Ts...>{});
+            }
+            co_return result;
+        }
+        // Closed channels are left out, as they would wake the task right away.
+        auto states = std::array{(chs.closed() ? nullptr : &detail::chan_access::state(chs))...};
+        auto park = detail::chan_park{states, nodes, detail::chan_dir::recv};
+        co_await suspend{&detail::park_on, &park};
+        detail::unpark_all(park);
+        woken = true;
+    }
+}
+
+} // namespace corofx
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../config.hpp"
+
+#include <cstddef>
+
+namespace corofx::detail {
+
+// A thread-local, size-class-segregated freelist pool for coroutine frames.
+//
+// Blocks are not owned by the thread that allocated them, so a frame may be freed on any thread;
+// it is simply recycled into the freeing thread's cache. Each cache is bounded and overflow is
+// returned to the global heap.
+class frame_pool {
+public:
+    static constexpr auto granularity = std::size_t{64};
+    static constexpr auto num_classes = std::size_t{16};
+    static constexpr auto max_pooled_size = granularity * num_classes;
+    static constexpr auto max_cached_blocks = std::size_t{256};
+
+    [[nodiscard]]
+    COROFX_PUBLIC static auto allocate(std::size_t size) -> void*;
+
+    COROFX_PUBLIC static auto deallocate(void* ptr, std::size_t size) noexcept -> void;
+
+    // Returns all blocks cached by the calling thread to the global heap.
+    COROFX_PUBLIC static auto trim() noexcept -> void;
+
+    // Returns the number of blocks cached by the calling thread.
+    [[nodiscard]]
+    COROFX_PUBLIC static auto cached_blocks() noexcept -> std::size_t;
+};
+
+} // namespace corofx::detail
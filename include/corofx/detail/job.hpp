@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../effect.hpp"
+#include "../frame.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace corofx::detail {
+
+class job;
+
+// Runs jobs. Implemented by the scheduler and the reactor.
+class executor {
+public:
+    // Makes a job parked by `suspend` ready to run again. Safe to call from any thread.
+    virtual auto wake(job* j) noexcept -> void = 0;
+
+protected:
+    executor() noexcept = default;
+    executor(executor const&) = default;
+    executor(executor&&) = default;
+    ~executor() = default;
+    auto operator=(executor const&) -> executor& = default;
+    auto operator=(executor&&) -> executor& = default;
+};
+
+// A spawned or root task together with its scheduling state.
+class job {
+public:
+    job(frame<> root, std::size_t refs, executor* owner) noexcept
+        : root_{std::move(root)}, next_{*root_}, owner_{owner}, refs_{refs} {}
+
+    auto retain() noexcept -> void { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+    auto release() noexcept -> void {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    // Adds a job to resume on completion. Returns false if the job has already completed.
+    [[nodiscard]]
+    auto add_waiter(job* waiter) noexcept -> bool {
+        auto head = waiters_.load(std::memory_order_acquire);
+        do {
+            if (head == this) return false;
+            waiter->next_waiter_ = head;
+        } while (not waiters_.compare_exchange_weak(
+            head, waiter, std::memory_order_acq_rel, std::memory_order_acquire));
+        return true;
+    }
+
+    // Marks the job as completed and returns the list of waiters.
+    [[nodiscard]]
+    auto close() noexcept -> job* {
+        return waiters_.exchange(this, std::memory_order_acq_rel);
+    }
+
+    [[nodiscard]]
+    auto done() const noexcept -> bool {
+        return waiters_.load(std::memory_order_acquire) == this;
+    }
+
+    frame<> root_;
+    std::coroutine_handle<> next_;
+    executor* owner_;
+    std::optional<value_holder<void>> output_;
+    job* next_waiter_{};
+
+private:
+    std::atomic<std::size_t> refs_;
+    // Points to the job itself once completed.
+    std::atomic<job*> waiters_{};
+};
+
+} // namespace corofx::detail
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "../check.hpp"
+#include "../frame.hpp"
+#include "../frame_resource.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <utility>
+
+namespace corofx::detail {
+
+// A coroutine that handler adapters let the handler resume in place of the producer, to observe
+// the resumption before resuming the producer themselves. It is kept in the storage of the effect
+// awaiter and owns the frame of the handler it wraps.
+class probe {
+public:
+    class promise_type {
+    public:
+        [[nodiscard]]
+        static auto operator new(std::size_t size) -> void* {
+            return allocate_frame(size, current_frame_resource());
+        }
+
+        static auto operator delete(void* ptr, std::size_t size) noexcept -> void {
+            deallocate_frame(ptr, size);
+        }
+
+        [[nodiscard]]
+        auto get_return_object() noexcept -> probe {
+            return probe{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        [[nodiscard]]
+        auto initial_suspend() const noexcept -> std::suspend_always {
+            return {};
+        }
+
+        [[nodiscard]]
+        auto final_suspend() const noexcept -> std::suspend_always {
+            return {};
+        }
+
+        auto return_void() const noexcept -> void {}
+
+        [[noreturn]]
+        auto unhandled_exception() noexcept -> void {
+            unreachable("unhandled exception");
+        }
+
+        // The handler frame, destroyed with the probe.
+        frame<> inner;
+    };
+
+    explicit probe(std::coroutine_handle<promise_type> h) noexcept : frame_{h} {}
+
+    [[nodiscard]]
+    auto get() const noexcept -> std::coroutine_handle<promise_type> {
+        return *frame_;
+    }
+
+    operator frame<>() && noexcept { return std::move(frame_); }
+
+private:
+    frame<promise_type> frame_;
+};
+
+// Transfers control from a probe to the producer, leaving the probe suspended.
+class resume_with : public std::suspend_always {
+public:
+    explicit resume_with(std::coroutine_handle<> next) noexcept : next_{next} {}
+
+    [[nodiscard]]
+    auto await_suspend(std::coroutine_handle<>) const noexcept -> std::coroutine_handle<> {
+        return next_;
+    }
+
+private:
+    std::coroutine_handle<> next_;
+};
+
+} // namespace corofx::detail
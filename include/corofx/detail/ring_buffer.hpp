@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace corofx::detail {
+
+// The positions of a ring buffer, which do not depend on its element type.
+class ring_index {
+public:
+    [[nodiscard]]
+    auto capacity() const noexcept -> std::size_t {
+        return mask_ + 1;
+    }
+
+    // Checks if there is nothing to pop. Exact only when no push or pop is in progress.
+    [[nodiscard]]
+    auto empty() const noexcept -> bool {
+        return tail_.load(std::memory_order_seq_cst) == head_.load(std::memory_order_seq_cst);
+    }
+
+    // Checks if there is no room to push. Exact only when no push or pop is in progress.
+    [[nodiscard]]
+    auto full() const noexcept -> bool {
+        auto head = head_.load(std::memory_order_seq_cst);
+        return tail_.load(std::memory_order_seq_cst) - head > mask_;
+    }
+
+protected:
+    explicit ring_index(std::size_t capacity) noexcept
+        : mask_{std::bit_ceil(std::max(capacity, std::size_t{2})) - 1} {}
+
+    std::size_t mask_;
+    alignas(64) std::atomic<std::size_t> head_{};
+    alignas(64) std::atomic<std::size_t> tail_{};
+};
+
+// A bounded lock-free multi-producer multi-consumer queue.
+// Each cell carries a sequence number telling whether it is ready to be pushed or popped at a
+// given position, so that producers and consumers only contend on their own position counter.
+// Based on Dmitry Vyukov's bounded MPMC queue. The capacity is rounded up to a power of two.
+template<typename T>
+    requires std::is_nothrow_move_constructible_v<T>
+class ring_buffer : public ring_index {
+public:
+    explicit ring_buffer(std::size_t capacity)
+        : ring_index{capacity}, cells_{std::make_unique<cell[]>(mask_ + 1)} {
+        for (auto i = std::size_t{}; i <= mask_; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ring_buffer(ring_buffer const&) = delete;
+    ring_buffer(ring_buffer&&) = delete;
+    auto operator=(ring_buffer const&) -> ring_buffer& = delete;
+    auto operator=(ring_buffer&&) -> ring_buffer& = delete;
+
+    ~ring_buffer() {
+        while (try_pop()) {}
+    }
+
+    // Moves `value` into the buffer. Returns false, leaving `value` untouched, if it is full.
+    [[nodiscard]]
+    auto try_push(T& value) noexcept -> bool {
+        auto pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            auto& c = cells_[pos & mask_];
+            auto seq = c.seq.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst)) {
+                    std::construct_at(c.get(), std::move(value));
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (seq < pos) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    [[nodiscard]]
+    auto try_pop() noexcept -> std::optional<T> {
+        auto pos = head_.load(std::memory_order_relaxed);
+        while (true) {
+            auto& c = cells_[pos & mask_];
+            auto seq = c.seq.load(std::memory_order_acquire);
+            if (seq == pos + 1) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst)) {
+                    auto value = std::optional<T>{std::move(*c.get())};
+                    std::destroy_at(c.get());
+                    c.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return value;
+                }
+            } else if (seq < pos + 1) {
+                return std::nullopt;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct cell {
+        auto get() noexcept -> T* { return std::launder(reinterpret_cast<T*>(storage)); }
+
+        std::atomic<std::size_t> seq;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    std::unique_ptr<cell[]> cells_;
+};
+
+} // namespace corofx::detail
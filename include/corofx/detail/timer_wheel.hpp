@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace corofx::detail {
+
+// An intrusive timer. Copies are never linked.
+class timer_node {
+public:
+    timer_node() noexcept = default;
+
+    timer_node(timer_node const&) noexcept {}
+
+    auto operator=(timer_node const&) noexcept -> timer_node& { return *this; }
+
+    [[nodiscard]]
+    auto deadline() const noexcept -> std::uint64_t {
+        return deadline_;
+    }
+
+    [[nodiscard]]
+    auto linked() const noexcept -> bool {
+        return next_ != nullptr;
+    }
+
+private:
+    friend class timer_wheel;
+
+    std::uint64_t deadline_{};
+    timer_node* prev_{};
+    timer_node* next_{};
+    std::uint8_t level_{};
+    std::uint8_t slot_{};
+};
+
+// A hierarchical timing wheel over integer ticks (Varghese and Lauck, 1987).
+//
+// Level `l` has 64 slots of `64^l` ticks each. Timers are inserted into the lowest level whose
+// span covers their deadline and cascade one level down every time the level below wraps around,
+// so insertion and cancellation take constant time and each timer moves at most `levels` times.
+class timer_wheel {
+public:
+    static constexpr auto slot_bits = std::size_t{6};
+    static constexpr auto slots = std::size_t{1} << slot_bits;
+    static constexpr auto levels = std::size_t{4};
+    // Timers further away are parked in the last level and re-inserted when it wraps.
+    static constexpr auto max_delta = (std::uint64_t{1} << (slot_bits * levels)) - 1;
+
+    explicit timer_wheel(std::uint64_t now = 0) noexcept : now_{now} {
+        for (auto& level : heads_) {
+            for (auto& head : level) head.prev_ = head.next_ = &head;
+        }
+    }
+
+    timer_wheel(timer_wheel const&) = delete;
+    timer_wheel(timer_wheel&&) = delete;
+    ~timer_wheel() = default;
+    auto operator=(timer_wheel const&) -> timer_wheel& = delete;
+    auto operator=(timer_wheel&&) -> timer_wheel& = delete;
+
+    // Schedules `node` to expire at tick `deadline`. Past deadlines expire on the next advance.
+    auto insert(timer_node& node, std::uint64_t deadline) noexcept -> void {
+        node.deadline_ = deadline;
+        link(node);
+        ++size_;
+    }
+
+    auto cancel(timer_node& node) noexcept -> void {
+        if (not node.linked()) return;
+        unlink(node);
+        --size_;
+    }
+
+    // Expires every timer due at or before tick `to`, calling `on_expire` with each of them.
+    // `on_expire` may insert timers but must not cancel other timers.
+    template<typename F>
+    auto advance(std::uint64_t to, F&& on_expire) -> void {
+        while (now_ <= to) {
+            if (size_ == 0) {
+                now_ = to + 1;
+                return;
+            }
+            if ((now_ & slot_mask) == 0) cascade();
+            auto pending = occupied_[0] >> (now_ & slot_mask);
+            if (pending == 0) {
+                now_ = std::min(to + 1, (now_ | slot_mask) + 1);
+                continue;
+            }
+            auto skip = static_cast<std::uint64_t>(std::countr_zero(pending));
+            if (now_ + skip > to) {
+                now_ = to + 1;
+                break;
+            }
+            now_ += skip;
+            for (auto node = detach(0, now_ & slot_mask); node;) {
+                auto next = node->next_;
+                node->prev_ = node->next_ = nullptr;
+                --size_;
+                on_expire(*node);
+                node = next;
+            }
+            ++now_;
+        }
+    }
+
+    // Returns a tick at or before the earliest deadline, or nothing if there are no timers.
+    [[nodiscard]]
+    auto next_expiry() const noexcept -> std::optional<std::uint64_t> {
+        if (size_ == 0) return std::nullopt;
+        auto pending = occupied_[0] >> (now_ & slot_mask);
+        if (pending != 0) return now_ + static_cast<std::uint64_t>(std::countr_zero(pending));
+        // Later timers are at least as far as the next cascade.
+        return (now_ + slot_mask) & ~slot_mask;
+    }
+
+    // The next tick to be processed.
+    [[nodiscard]]
+    auto now() const noexcept -> std::uint64_t {
+        return now_;
+    }
+
+    [[nodiscard]]
+    auto size() const noexcept -> std::size_t {
+        return size_;
+    }
+
+private:
+    static constexpr auto slot_mask = std::uint64_t{slots - 1};
+
+    auto link(timer_node& node) noexcept -> void {
+        auto delta = node.deadline_ > now_ ? node.deadline_ - now_ : 0;
+        auto when = delta > max_delta ? now_ + max_delta : now_ + delta;
+        auto level = std::size_t{};
+        while (level < levels - 1 and delta >= (std::uint64_t{1} << (slot_bits * (level + 1)))) {
+            ++level;
+        }
+        auto slot = (when >> (slot_bits * level)) & slot_mask;
+        auto& head = heads_[level][slot];
+        node.level_ = static_cast<std::uint8_t>(level);
+        node.slot_ = static_cast<std::uint8_t>(slot);
+        node.prev_ = head.prev_;
+        node.next_ = &head;
+        head.prev_->next_ = &node;
+        head.prev_ = &node;
+        occupied_[level] |= std::uint64_t{1} << slot;
+    }
+
+    auto unlink(timer_node& node) noexcept -> void {
+        node.prev_->next_ = node.next_;
+        node.next_->prev_ = node.prev_;
+        node.prev_ = node.next_ = nullptr;
+        auto& head = heads_[node.level_][node.slot_];
+        if (head.next_ == &head) occupied_[node.level_] &= ~(std::uint64_t{1} << node.slot_);
+    }
+
+    // Empties a slot and returns its timers as a null-terminated list.
+    [[nodiscard]]
+    auto detach(std::size_t level, std::uint64_t slot) noexcept -> timer_node* {
+        auto& head = heads_[level][slot];
+        if (head.next_ == &head) return nullptr;
+        auto first = head.next_;
+        head.prev_->next_ = nullptr;
+        head.prev_ = head.next_ = &head;
+        occupied_[level] &= ~(std::uint64_t{1} << slot);
+        return first;
+    }
+
+    // Moves the timers of the higher-level slots that start at `now_` one level down.
+    auto cascade() noexcept -> void {
+        for (auto level = std::size_t{1}; level < levels; ++level) {
+            auto slot = (now_ >> (slot_bits * level)) & slot_mask;
+            for (auto node = detach(level, slot); node;) {
+                auto next = node->next_;
+                link(*node);
+                node = next;
+            }
+            if (slot != 0) break;
+        }
+    }
+
+    std::uint64_t now_;
+    std::size_t size_{};
+    std::array<std::uint64_t, levels> occupied_{};
+    std::array<std::array<timer_node, slots>, levels> heads_;
+};
+
+} // namespace corofx::detail
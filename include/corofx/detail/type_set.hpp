@@ -1,9 +1,21 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <type_traits>
+#include <utility>
 
+// Membership is a base class lookup in one class per set, so set operations do not recurse over
+// the elements of a row. `add` and `subtract` both pick the elements of the result by index.
 namespace corofx::detail {
 
+template<typename... Ts>
+struct type_set;
+
+// Derives from `std::type_identity<T>` for each element, so that membership is a base lookup.
+template<typename... Ts>
+struct set_of : std::type_identity<Ts>... {};
+
 template<typename S, typename U>
 struct contains_impl {
     static constexpr bool value = false;
@@ -11,28 +23,169 @@ struct contains_impl {
 
 template<template<typename...> typename S, typename... Ts, typename U>
 struct contains_impl<S<Ts...>, U> {
-    struct set : std::type_identity<Ts>... {};
-
-    static constexpr bool value = std::is_base_of_v<std::type_identity<U>, set>;
+    static constexpr bool value = std::is_base_of_v<std::type_identity<U>, set_of<Ts...>>;
 };
 
 template<template<typename...> typename S, typename... Ts, typename... Us>
 struct contains_impl<S<Ts...>, S<Us...>> {
-    struct set : std::type_identity<Ts>... {};
+    static constexpr bool value =
+        (std::is_base_of_v<std::type_identity<Us>, set_of<Ts...>> and ...);
+};
+
+// Returns the indices at which `mask` is set.
+template<auto Mask>
+inline constexpr auto positions = [] {
+    constexpr auto n = [] {
+        auto count = std::size_t{};
+        for (auto keep : Mask) count += keep ? 1 : 0;
+        return count;
+    }();
+    auto result = std::array<std::size_t, n>{};
+    auto k = std::size_t{};
+    for (auto i = std::size_t{}; i < Mask.size(); ++i) {
+        if (Mask[i]) result[k++] = i;
+    }
+    return result;
+}();
+
+template<std::size_t I, typename T>
+struct indexed : std::type_identity<T> {};
 
-    static constexpr bool value = (std::is_base_of_v<std::type_identity<Us>, set> and ...);
+template<typename Is, typename... Ts>
+struct indexed_types;
+
+template<std::size_t... Is, typename... Ts>
+struct indexed_types<std::index_sequence<Is...>, Ts...> : indexed<Is, Ts>... {};
+
+template<std::size_t I, typename T>
+auto type_at(indexed<I, T> const&) -> std::type_identity<T>;
+
+// Appends the types of `Ts...` at `Positions` to `S`.
+template<typename S, auto Positions, typename... Ts>
+struct select_impl;
+
+template<typename... Ps, auto Positions, typename... Ts>
+struct select_impl<type_set<Ps...>, Positions, Ts...> {
+    using types = indexed_types<std::index_sequence_for<Ts...>, Ts...>;
+
+    template<std::size_t... Ks>
+    static auto select(std::index_sequence<Ks...>) -> type_set<
+        Ps...,
+        typename decltype(type_at<Positions[Ks]>(std::declval<types const&>()))::type...>;
+
+    using result = decltype(select(std::make_index_sequence<Positions.size()>{}));
 };
 
-template<typename S, typename S2, typename... Ss>
-struct add_impl {
-    using result = add_impl<typename add_impl<S, S2>::result, Ss...>::result;
+template<typename S, typename... Us>
+struct subtract_impl;
+
+template<typename... Ts, typename... Us>
+struct subtract_impl<type_set<Ts...>, Us...> {
+    static constexpr auto keep = std::array<bool, sizeof...(Ts)>{
+        not std::is_base_of_v<std::type_identity<Ts>, set_of<Us...>>...};
+
+    using result = select_impl<type_set<>, positions<keep>, Ts...>::result;
 };
 
-template<typename S, typename S2, typename Remain>
-struct subtract_impl {
-    using result = Remain;
+// Only used in unevaluated operands, to concatenate sets with a fold expression.
+template<typename... Ts, typename... Us>
+auto operator+(type_set<Ts...>, type_set<Us...>) -> type_set<Ts..., Us...>;
+
+// A row as indexed bases, in which a type is found by a base lookup even if it is repeated.
+template<typename Row>
+struct bag_of;
+
+template<typename... Us>
+struct bag_of<type_set<Us...>> {
+    using type = indexed_types<std::index_sequence_for<Us...>, Us...>;
+};
+
+// The index of the first `T` in `Ts...`, which contains it.
+template<typename T, typename... Ts>
+inline constexpr auto first_index = [] {
+    constexpr bool same[] = {std::is_same_v<T, Ts>...};
+    auto i = std::size_t{};
+    while (not same[i]) ++i;
+    return i;
+}();
+
+// Marks the types of `Us...` that are in `Bag`.
+template<typename Bag, typename... Us>
+inline constexpr auto members =
+    std::array<bool, sizeof...(Us)>{std::is_base_of_v<std::type_identity<Us>, Bag>...};
+
+template<typename S, std::size_t R, typename Row, typename Rows, typename Rs>
+struct row_mask;
+
+// Marks the types of the row at index `R` of `Rows...` that are neither in the set nor in an
+// earlier row, nor repeated earlier in the row.
+template<typename... Ts,
+         std::size_t R,
+         typename... Us,
+         typename... Rows,
+         std::size_t... Rs>
+struct row_mask<type_set<Ts...>,
+                R,
+                type_set<Us...>,
+                type_set<Rows...>,
+                std::index_sequence<Rs...>> {
+    using bag = bag_of<type_set<Us...>>::type;
+
+    // A type that appears once in the row converts to its base unambiguously, so rows are only
+    // compared element by element when they repeat a type.
+    static constexpr bool is_set = (std::is_convertible_v<bag*, std::type_identity<Us>*> and ...);
+
+    template<std::size_t... Is>
+    static constexpr auto keep(std::index_sequence<Is...>) {
+        auto result = std::array<bool, sizeof...(Us)>{
+            not std::is_base_of_v<std::type_identity<Us>, set_of<Ts...>>...};
+        if constexpr (not is_set) {
+            auto first = std::array<bool, sizeof...(Us)>{(first_index<Us, Us...> == Is)...};
+            for (auto i = std::size_t{}; i < result.size(); ++i) result[i] = result[i] and first[i];
+        }
+        [[maybe_unused]] auto drop = [&](std::size_t r, auto const& in) {
+            if (std::cmp_greater_equal(r, R)) return;
+            for (auto i = std::size_t{}; i < result.size(); ++i) {
+                if (in[i]) result[i] = false;
+            }
+        };
+        (drop(Rs, members<typename bag_of<Rows>::type, Us...>), ...);
+        return result;
+    }
+
+    static constexpr auto value = keep(std::index_sequence_for<Us...>{});
+};
+
+template<typename S, typename Rows, typename Rs, typename Added>
+struct union_impl;
+
+// Handlers usually add no effects.
+template<typename... Ts, typename... Rows, std::size_t... Rs>
+struct union_impl<type_set<Ts...>, type_set<Rows...>, std::index_sequence<Rs...>, type_set<>> {
+    using result = type_set<Ts...>;
 };
 
+// Marks the first of each added type that is not in the set, then selects them all at once.
+template<typename... Ts, typename... Rows, std::size_t... Rs, typename... Cs>
+struct union_impl<type_set<Ts...>, type_set<Rows...>, std::index_sequence<Rs...>, type_set<Cs...>> {
+    static constexpr auto keep = [] {
+        auto result = std::array<bool, sizeof...(Cs)>{};
+        auto i = std::size_t{};
+        [[maybe_unused]] auto append = [&](auto const& mask) {
+            for (auto k : mask) result[i++] = k;
+        };
+        (append(row_mask<type_set<Ts...>, Rs, Rows, type_set<Rows...>, std::index_sequence<Rs...>>::
+                    value),
+         ...);
+        return result;
+    }();
+
+    using result = select_impl<type_set<Ts...>, positions<keep>, Cs...>::result;
+};
+
+template<typename S, typename... Ss>
+struct add_impl;
+
 // TODO: Down with ::template and .template
 template<typename... Ts>
 struct type_set {
@@ -40,7 +193,7 @@ struct type_set {
     using add = add_impl<type_set, Ss...>::result;
 
     template<typename... Us>
-    using subtract = subtract_impl<type_set, type_set<Us...>, type_set<>>::result;
+    using subtract = subtract_impl<type_set, Us...>::result;
 
     static constexpr bool empty = sizeof...(Ts) == 0;
 
@@ -56,26 +209,13 @@ struct type_set {
     using unpack_to = S<Ts...>;
 };
 
-template<template<typename...> typename S, typename... Ts>
-struct add_impl<S<Ts...>, S<>> {
-    using result = S<Ts...>;
-};
-
-template<template<typename...> typename S, typename... Ts, typename U, typename... Us>
-struct add_impl<S<Ts...>, S<U, Us...>> {
-    using result = std::conditional_t<
-        S<Ts...>::template contains<U>,
-        add_impl<S<Ts...>, S<Us...>>,
-        add_impl<S<Ts..., U>, S<Us...>>>::result;
-};
-
-// TODO: Double check if template instantiation is lazy enough?
-template<template<typename...> typename S, typename T, typename... Ts, typename S2, typename... Us>
-struct subtract_impl<S<T, Ts...>, S2, S<Us...>> {
-    using result = std::conditional_t<
-        S2::template contains<T>,
-        subtract_impl<S<Ts...>, S2, S<Us...>>,
-        subtract_impl<S<Ts...>, S2, S<Us..., T>>>::result;
+template<typename S, typename... Ss>
+struct add_impl {
+    using result = union_impl<
+        S,
+        type_set<Ss...>,
+        std::index_sequence_for<Ss...>,
+        decltype((type_set<>{} + ... + Ss{}))>::result;
 };
 
 } // namespace corofx::detail
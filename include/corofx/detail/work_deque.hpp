@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace corofx::detail {
+
+// A bounded Chase-Lev work-stealing deque of pointers.
+// The owner pushes and pops at the bottom; other threads steal from the top.
+// Based on "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al., 2013), with
+// the fences folded into sequentially consistent accesses, which sanitizers can reason about.
+template<typename T, std::size_t Capacity>
+    requires((Capacity & (Capacity - 1)) == 0)
+class work_deque {
+public:
+    // Returns false if the deque is full. Owner only.
+    [[nodiscard]]
+    auto push(T* item) noexcept -> bool {
+        auto b = bottom_.load(std::memory_order_relaxed);
+        auto t = top_.load(std::memory_order_acquire);
+        if (b - t >= static_cast<std::int64_t>(Capacity)) return false;
+        slot(b).store(item, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only.
+    [[nodiscard]]
+    auto pop() noexcept -> T* {
+        auto b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_seq_cst);
+        auto t = top_.load(std::memory_order_seq_cst);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        auto item = slot(b).load(std::memory_order_relaxed);
+        if (t == b) {
+            if (not top_.compare_exchange_strong(
+                    t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread. May fail spuriously under contention.
+    [[nodiscard]]
+    auto steal() noexcept -> T* {
+        auto t = top_.load(std::memory_order_seq_cst);
+        auto b = bottom_.load(std::memory_order_seq_cst);
+        if (t >= b) return nullptr;
+        auto item = slot(t).load(std::memory_order_relaxed);
+        if (not top_.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // Whether the deque looked empty. Owner only.
+    [[nodiscard]]
+    auto empty() const noexcept -> bool {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    auto slot(std::int64_t i) noexcept -> std::atomic<T*>& {
+        return items_[static_cast<std::size_t>(i) & (Capacity - 1)];
+    }
+
+    alignas(64) std::atomic<std::int64_t> top_{};
+    alignas(64) std::atomic<std::int64_t> bottom_{};
+    alignas(64) std::array<std::atomic<T*>, Capacity> items_{};
+};
+
+} // namespace corofx::detail
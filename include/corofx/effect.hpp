@@ -1,6 +1,8 @@
 #pragma once
 
+#include "check.hpp"
 #include "frame.hpp"
+#include "tracing.hpp"
 
 #include <concepts>
 #include <coroutine>
@@ -24,11 +26,52 @@ concept effect = std::movable<T> and
 template<effect E>
 class resumer;
 
+namespace detail {
+
+struct resumer_access;
+
+} // namespace detail
+
 template<effect E>
 class handler {
 public:
+    // Handles the effect and returns the coroutine to transfer control to.
+    // `eff` refers to the effect in the producer's frame and stays valid until the producer
+    // resumes. A handler frame created for the effect is kept in `storage` until then too.
+    [[nodiscard]]
+    virtual auto handle(E&& eff, resumer<E>& resume, frame<>& storage) noexcept
+        -> std::coroutine_handle<> = 0;
+
+    // Handles the effect in place. Only called on tail-resumptive handlers.
+    [[nodiscard]]
+    virtual auto handle_tail(E&&) noexcept -> value_holder<typename E::return_type> {
+        check_unreachable();
+    }
+
+    // Handles the effect in place if the producer can go on right away, and returns nothing
+    // otherwise. Only called on handlers that check for it before `handle`.
     [[nodiscard]]
-    virtual auto handle(E&& eff, resumer<E>& resume) noexcept -> frame<> = 0;
+    virtual auto try_ready(E&) noexcept -> std::optional<value_holder<typename E::return_type>> {
+        check_unreachable();
+    }
+
+    [[nodiscard]]
+    auto tail_resumptive() const noexcept -> bool {
+        return tail_resumptive_;
+    }
+
+    [[nodiscard]]
+    auto checks_ready() const noexcept -> bool {
+        return checks_ready_;
+    }
+
+protected:
+    explicit handler(bool tail_resumptive = false, bool checks_ready = false) noexcept
+        : tail_resumptive_{tail_resumptive}, checks_ready_{checks_ready} {}
+
+private:
+    bool tail_resumptive_;
+    bool checks_ready_;
 };
 
 class resumer_tag {
@@ -49,7 +92,7 @@ private:
     std::coroutine_handle<> resume_;
 };
 
-template<effect E>
+template<effect E, typename H = handler<E>>
 class effect_awaiter;
 
 template<effect E>
@@ -63,7 +106,9 @@ public:
 
     [[nodiscard]]
     auto operator()(value_holder<typename E::return_type> value) noexcept -> resumer_tag {
-        effect_.set_value(std::move(value));
+        tracing::detail::record(
+            tracing::event_kind::handler_resume, resume_.address(), &tracing::detail::label_of<E>);
+        value_ = std::move(value);
         return resumer_tag{resume_};
     }
 
@@ -74,23 +119,76 @@ public:
         return operator()({});
     }
 
+    // Stores the result and returns the suspended producer without resuming it.
+    // Handlers that resume the producer later, or from another thread, use this instead of
+    // `co_return resume(value)`.
+    [[nodiscard]]
+    auto set_value(value_holder<typename E::return_type> value) noexcept
+        -> std::coroutine_handle<> {
+        tracing::detail::record(
+            tracing::event_kind::handler_resume, resume_.address(), &tracing::detail::label_of<E>);
+        value_ = std::move(value);
+        return resume_;
+    }
+
+    [[nodiscard]]
+    auto set_value() noexcept -> std::coroutine_handle<>
+        requires(std::is_void_v<typename E::return_type>)
+    {
+        return set_value({});
+    }
+
 private:
-    friend class effect_awaiter<E>;
+    template<effect, typename>
+    friend class effect_awaiter;
+    friend struct detail::resumer_access;
 
-    explicit resumer(std::coroutine_handle<> resume, effect_awaiter<E>& effect) noexcept
-        : resume_{resume}, effect_{effect} {}
+    resumer() noexcept = default;
 
+    // The result is kept here, so that the awaiter does not need another pointer to it.
     std::coroutine_handle<> resume_;
-    effect_awaiter<E>& effect_;
+    std::optional<value_holder<typename E::return_type>> value_;
 };
 
-template<effect E>
-class effect_awaiter : public std::suspend_always {
+namespace detail {
+
+// Lets handler adapters observe or redirect the resumption of a producer.
+struct resumer_access {
+    template<effect E>
+    [[nodiscard]]
+    static auto producer(resumer<E>& r) noexcept -> std::coroutine_handle<>& {
+        return r.resume_;
+    }
+
+    template<effect E>
+    [[nodiscard]]
+    static auto value(resumer<E>& r) noexcept
+        -> std::optional<value_holder<typename E::return_type>>& {
+        return r.value_;
+    }
+};
+
+} // namespace detail
+
+namespace detail {
+
+// Checks if the handler type `H` tries to resume the producer before suspending it.
+template<typename H>
+concept checks_ready = requires { requires H::checks_ready; };
+
+} // namespace detail
+
+// Awaits an effect handled by `H`.
+// `H` is `handler<E>` unless the handler type is statically bound to the effect, in which case
+// the handler is invoked without virtual dispatch.
+// The effect is passed to the handler in place: it lives in the producer's frame until the
+// producer resumes, and is never moved by the awaiter.
+template<effect E, typename H>
+class effect_awaiter {
 public:
     using value_type = E::return_type;
 
-    explicit effect_awaiter(handler<E>* h, std::coroutine_handle<> k, E eff) noexcept
-        : eff_{std::move(eff)}, resumer_{k, *this}, frame_{h->handle(std::move(eff_), resumer_)} {}
+    explicit effect_awaiter(H* h, E& eff) noexcept : handler_{h}, eff_{eff} {}
 
     effect_awaiter(effect_awaiter const&) = delete;
     effect_awaiter(effect_awaiter&&) = delete;
@@ -98,24 +196,79 @@ public:
     auto operator=(effect_awaiter const&) -> effect_awaiter& = delete;
     auto operator=(effect_awaiter&&) -> effect_awaiter& = delete;
 
+    // Tail-resumptive handlers run here and resume the producer without suspending it, as do
+    // handlers that check for it when the producer can go on right away.
+    // They are traced as entered only, without a frame.
     [[nodiscard]]
-    auto await_suspend(std::coroutine_handle<>) const noexcept -> std::coroutine_handle<> {
-        return *frame_;
+    auto await_ready() noexcept -> bool {
+        if constexpr (std::is_same_v<H, handler<E>>) {
+            if (not handler_->tail_resumptive()) return handler_->checks_ready() and try_ready();
+        } else if constexpr (not H::tail_resumptive) {
+            if constexpr (detail::checks_ready<H>) {
+                return try_ready();
+            } else {
+                return false;
+            }
+        }
+        tracing::detail::record(
+            tracing::event_kind::handler_enter, nullptr, &tracing::detail::label_of<E>);
+        resumer_.value_ = handler_->handle_tail(std::move(eff_));
+        return true;
+    }
+
+    [[nodiscard]]
+    auto await_suspend(std::coroutine_handle<> k) noexcept -> std::coroutine_handle<> {
+        resumer_.resume_ = k;
+        tracing::detail::record(
+            tracing::event_kind::handler_enter, k.address(), &tracing::detail::label_of<E>);
+        return handler_->handle(std::move(eff_), resumer_, frame_);
     }
 
     auto await_resume() noexcept -> value_type {
+#ifdef COROFX_ENABLE_TRACING
+        if (resumer_.resume_) {
+            tracing::detail::record(
+                tracing::event_kind::task_resume,
+                resumer_.resume_.address(),
+                &tracing::detail::label_of<E>);
+        }
+#endif
         if constexpr (not std::is_void_v<value_type>) {
-            return std::move(*value_);
+            return std::move(*resumer_.value_);
         }
     }
 
-    auto set_value(value_holder<value_type> value) noexcept -> void { value_ = std::move(value); }
-
 private:
-    E eff_; // NOTE: This effect will not be moved until the task starts running.
-    resumer<E> resumer_;
+    [[nodiscard]]
+    auto try_ready() noexcept -> bool {
+        resumer_.value_ = handler_->try_ready(eff_);
+        if (not resumer_.value_) return false;
+        tracing::detail::record(
+            tracing::event_kind::handler_enter, nullptr, &tracing::detail::label_of<E>);
+        return true;
+    }
+
+    H* handler_;
+    E& eff_;
     frame<> frame_;
-    std::optional<value_holder<value_type>> value_;
+    resumer<E> resumer_;
+};
+
+namespace detail {
+
+template<effect E>
+struct effect_copy {
+    E eff;
+};
+
+} // namespace detail
+
+// Awaits a copy of an effect performed through an lvalue, which the handler may move from.
+template<effect E, typename H = handler<E>>
+class effect_copy_awaiter : private detail::effect_copy<E>, public effect_awaiter<E, H> {
+public:
+    explicit effect_copy_awaiter(H* h, E const& eff) noexcept
+        : detail::effect_copy<E>{eff}, effect_awaiter<E, H>{h, this->eff} {}
 };
 
 } // namespace corofx
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "check.hpp"
+#include "config.hpp"
+#include "effect.hpp"
+#include "handler.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace corofx {
+
+// Returns the next chunk of the input, which is empty at the end of it.
+// How long the chunk stays valid depends on the handler.
+struct COROFX_PUBLIC read_chunk {
+    using return_type = std::span<std::byte const>;
+};
+
+// A file mapped read-only into memory.
+class mapped_file {
+public:
+    // Maps the file at `path`, hinting that it will be read sequentially.
+    // Returns nothing if it could not be opened or mapped.
+    [[nodiscard]]
+    COROFX_PUBLIC static auto open(char const* path) -> std::optional<mapped_file>;
+
+    mapped_file(mapped_file const&) = delete;
+    COROFX_PUBLIC mapped_file(mapped_file&& other) noexcept;
+    COROFX_PUBLIC ~mapped_file();
+    auto operator=(mapped_file const&) -> mapped_file& = delete;
+    COROFX_PUBLIC auto operator=(mapped_file&& other) noexcept -> mapped_file&;
+
+    [[nodiscard]]
+    auto bytes() const noexcept -> std::span<std::byte const> {
+        return {data_, size_};
+    }
+
+private:
+    mapped_file(std::byte const* data, std::size_t size) noexcept : data_{data}, size_{size} {}
+
+    std::byte const* data_;
+    std::size_t size_;
+};
+
+// Handles `read_chunk` with chunks of a mapped file, without copying or system calls per chunk
+// other than a hint to read the next chunk ahead. Chunks stay valid while the file is mapped.
+class COROFX_PUBLIC mapped_reader : public tail_handler_entry<read_chunk> {
+public:
+    mapped_reader(mapped_file const& file, std::size_t chunk_size) noexcept
+        : rest_{file.bytes()}, chunk_size_{chunk_size} {
+        check(chunk_size_ > 0);
+    }
+
+    [[nodiscard]]
+    auto handle_tail(read_chunk&&) noexcept -> std::span<std::byte const> final;
+
+private:
+    std::span<std::byte const> rest_;
+    std::size_t chunk_size_;
+};
+
+// Handles `read_chunk` by reading a file descriptor into a buffer, one `read` per chunk.
+// A chunk stays valid until the next one is read. A read error ends the input, and its `errno`
+// is stored in `*error` if given, which is otherwise left unchanged.
+class COROFX_PUBLIC streaming_reader : public tail_handler_entry<read_chunk> {
+public:
+    streaming_reader(int fd, std::size_t chunk_size, int* error = nullptr)
+        : fd_{fd}, error_{error}, buffer_(chunk_size) {
+        check(chunk_size > 0);
+    }
+
+    [[nodiscard]]
+    auto handle_tail(read_chunk&&) noexcept -> std::span<std::byte const> final;
+
+private:
+    int fd_;
+    int* error_;
+    std::vector<std::byte> buffer_;
+};
+
+inline constexpr auto default_chunk_size = std::size_t{1} << 20;
+
+// Creates a handler entry that reads `file` in chunks of `chunk_size` bytes.
+[[nodiscard]]
+inline auto mapped_handler_of(mapped_file const& file, std::size_t chunk_size = default_chunk_size)
+    -> mapped_reader {
+    return mapped_reader{file, chunk_size};
+}
+
+// Creates a handler entry that reads `fd` in chunks of at most `chunk_size` bytes.
+// Given `error`, a failed read stores its `errno` there, where the caller can tell it apart from
+// the end of the input after the task has moved the handler.
+[[nodiscard]]
+inline auto read_handler_of(int fd, std::size_t chunk_size = default_chunk_size,
+                            int* error = nullptr) -> streaming_reader {
+    return streaming_reader{fd, chunk_size, error};
+}
+
+} // namespace corofx
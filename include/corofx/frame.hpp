@@ -1,5 +1,7 @@
 #pragma once
 
+#include "tracing.hpp"
+
 #include <coroutine>
 #include <type_traits>
 #include <utility>
@@ -9,6 +11,8 @@ namespace corofx {
 template<typename P = void>
 class frame {
 public:
+    frame() noexcept = default;
+
     explicit frame(std::coroutine_handle<P> data) noexcept : data_{data} {}
 
     template<typename Q>
@@ -20,7 +24,10 @@ public:
     frame(frame&& that) noexcept : data_{std::exchange(that.data_, {})} {}
 
     ~frame() {
-        if (data_) data_.destroy();
+        if (data_) {
+            tracing::detail::record(tracing::event_kind::frame_destroy, data_.address());
+            data_.destroy();
+        }
     }
 
     auto operator=(frame const&) -> frame& = delete;
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace corofx {
+
+namespace detail {
+
+// Allocates a coroutine frame from `resource`, or from the default allocator if it is null.
+// Frames remember where they came from in a trailer, so that they are freed the same way.
+[[nodiscard]]
+COROFX_PUBLIC auto allocate_frame(std::size_t size, std::pmr::memory_resource* resource) -> void*;
+
+COROFX_PUBLIC auto deallocate_frame(void* ptr, std::size_t size) noexcept -> void;
+
+// Returns the resource of the innermost `frame_resource_scope` on this thread, if any.
+[[nodiscard]]
+COROFX_PUBLIC auto current_frame_resource() noexcept -> std::pmr::memory_resource*;
+
+COROFX_PUBLIC auto exchange_frame_resource(std::pmr::memory_resource* resource) noexcept
+    -> std::pmr::memory_resource*;
+
+} // namespace detail
+
+// Allocates the frames of coroutines created on this thread from a memory resource while alive.
+// Frames keep using the resource they came from when they are freed, even after the scope ends,
+// so the resource must outlive them. A null resource restores the default allocator.
+class frame_resource_scope {
+public:
+    explicit frame_resource_scope(std::pmr::memory_resource* resource) noexcept
+        : previous_{detail::exchange_frame_resource(resource)} {}
+
+    frame_resource_scope(frame_resource_scope const&) = delete;
+    frame_resource_scope(frame_resource_scope&&) = delete;
+    auto operator=(frame_resource_scope const&) -> frame_resource_scope& = delete;
+    auto operator=(frame_resource_scope&&) -> frame_resource_scope& = delete;
+
+    ~frame_resource_scope() { detail::exchange_frame_resource(previous_); }
+
+private:
+    std::pmr::memory_resource* previous_;
+};
+
+} // namespace corofx
@@ -0,0 +1,336 @@
+#pragma once
+
+#include "check.hpp"
+#include "detail/type_set.hpp"
+#include "effect.hpp"
+#include "frame.hpp"
+#include "handler.hpp"
+#include "promise.hpp"
+#include "task.hpp"
+#include "tracing.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace corofx {
+
+namespace detail {
+
+// Checks if the handler of a generator row entry is known to resume the generator.
+template<typename E>
+inline constexpr bool resumes_generator = not std::is_polymorphic_v<handler<E>>;
+
+template<typename H>
+inline constexpr bool resumes_generator<bound<H>> = H::tail_resumptive;
+
+template<typename E>
+inline constexpr bool is_bound_entry = false;
+
+template<typename H>
+inline constexpr bool is_bound_entry<bound<H>> = true;
+
+// Checks if an effect of a generator is passed through a `generator_entry`. Bound entries and
+// handlers that are not dispatched virtually are known to resume the generator.
+template<typename E>
+concept forwarded_effect = not is_bound_entry<E> and not resumes_generator<E>;
+
+// Passes the effects of a generator to the handler in scope outside of it. A handler task that
+// does not resume the generator continues through `drop` instead of its handled task.
+template<effect E>
+class generator_entry final : public handler<E> {
+public:
+    generator_entry(handler<E>* outer, drop_hook* drop, evidence const* parent) noexcept
+        : handler<E>{false, outer->checks_ready()}, outer_{outer}, drop_{drop},
+          node_{this, parent} {}
+
+    generator_entry(generator_entry const&) = delete;
+    generator_entry(generator_entry&&) = delete;
+    ~generator_entry() = default;
+    auto operator=(generator_entry const&) -> generator_entry& = delete;
+    auto operator=(generator_entry&&) -> generator_entry& = delete;
+
+    [[nodiscard]]
+    auto handle(E&& eff, resumer<E>& resume, frame<>& storage) noexcept
+        -> std::coroutine_handle<> final {
+        auto previous = exchange_drop_hook(drop_);
+        if (previous) {
+            // An effect of a nested generator ends the innermost one.
+            exchange_drop_hook(previous);
+        } else {
+            drop_->handler = {};
+        }
+        auto next = outer_->handle(std::move(eff), resume, storage);
+        exchange_drop_hook(previous);
+        return next;
+    }
+
+    [[nodiscard]]
+    auto try_ready(E& eff) noexcept -> std::optional<value_holder<typename E::return_type>> final {
+        return outer_->try_ready(eff);
+    }
+
+    [[nodiscard]]
+    auto node() const noexcept -> evidence const* {
+        return &node_;
+    }
+
+private:
+    handler<E>* outer_;
+    drop_hook* drop_;
+    evidence node_;
+};
+
+template<effect E>
+using generator_entry_slot =
+    std::conditional_t<forwarded_effect<E>, std::optional<generator_entry<E>>, std::monostate>;
+
+} // namespace detail
+
+// A lazily evaluated sequence produced with `co_yield`.
+//
+// Each element costs a single resumption and no allocation. A generator may perform the effects in
+// its row; they are handled by the task that binds it with `co_await`. A handler that does not
+// resume the generator ends it, and its frame is destroyed; the binding task goes on. Handlers
+// must not park the generator, and bound entries must be tail-resumptive. Generators without
+// effects can be iterated directly.
+template<typename T, effect... Es>
+class generator {
+    static_assert(std::is_object_v<T>, "generator elements must be object types");
+    static_assert(
+        ((detail::resumes_generator<Es> or not detail::is_bound_entry<Es>) and ...),
+        "bound handlers of generator effects must be tail-resumptive");
+
+public:
+    class promise_type;
+    class iterator;
+    using handle_type = std::coroutine_handle<promise_type>;
+    using value_type = T;
+    using effect_types = detail::type_set<Es...>;
+
+    generator(generator const&) = delete;
+    generator(generator&& that) noexcept : frame_{std::move(that.frame_)} { adopt(); }
+    ~generator() = default;
+    auto operator=(generator const&) -> generator& = delete;
+
+    auto operator=(generator&& that) noexcept -> generator& {
+        frame_ = std::move(that.frame_);
+        adopt();
+        return *this;
+    }
+
+    // Runs the generator up to its first element.
+    [[nodiscard]]
+    auto begin() -> iterator {
+        check(effect_types::empty or (*frame_).promise().bound());
+        return iterator{promise_type::advance(*frame_)};
+    }
+
+    [[nodiscard]]
+    auto end() const noexcept -> std::default_sentinel_t {
+        return {};
+    }
+
+private:
+    template<typename, effect...>
+    friend class task;
+
+    explicit generator(handle_type h) noexcept : frame_{h} { adopt(); }
+
+    // Lets the promise destroy the frame when the generator ends early.
+    auto adopt() noexcept -> void {
+        if (*frame_) (*frame_).promise().owner_ = &frame_;
+    }
+
+    auto set_evidence(evidence const* ev) noexcept -> void { (*frame_).promise().set_evidence(ev); }
+
+    frame<promise_type> frame_;
+};
+
+template<typename T, effect... Es>
+class generator<T, Es...>::iterator {
+public:
+    using iterator_concept = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() noexcept = default;
+
+    [[nodiscard]]
+    auto operator*() const noexcept -> T const& {
+        return *frame_.promise().value_;
+    }
+
+    auto operator++() -> iterator& {
+        frame_ = promise_type::advance(frame_);
+        return *this;
+    }
+
+    auto operator++(int) -> void { ++*this; }
+
+    [[nodiscard]]
+    friend auto operator==(iterator const& it, std::default_sentinel_t) noexcept -> bool {
+        return not it.frame_ or it.frame_.done();
+    }
+
+private:
+    friend class generator;
+
+    explicit iterator(handle_type h) noexcept : frame_{h} {}
+
+    handle_type frame_;
+};
+
+template<typename T, effect... Es>
+class generator<T, Es...>::promise_type {
+public:
+    [[nodiscard]]
+    static auto operator new(std::size_t size) -> void* {
+        return promise_base::operator new(size);
+    }
+
+    static auto operator delete(void* ptr, std::size_t size) noexcept -> void {
+        promise_base::operator delete(ptr, size);
+    }
+
+    promise_type() noexcept = default;
+    promise_type(promise_type const&) = delete;
+    promise_type(promise_type&&) = delete;
+    ~promise_type() = default;
+    auto operator=(promise_type const&) -> promise_type& = delete;
+    auto operator=(promise_type&&) -> promise_type& = delete;
+
+    [[nodiscard]]
+    auto get_return_object() noexcept -> generator {
+        return generator{handle_type::from_promise(*this)};
+    }
+
+    [[nodiscard]]
+    constexpr auto initial_suspend() const noexcept -> std::suspend_always {
+        return {};
+    }
+
+    [[nodiscard]]
+    constexpr auto final_suspend() const noexcept -> std::suspend_always {
+        return {};
+    }
+
+    // The element stays alive in the generator frame until it is resumed.
+    [[nodiscard]]
+    auto yield_value(T const& value) noexcept -> std::suspend_always {
+        value_ = std::addressof(value);
+        return {};
+    }
+
+    auto return_void() const noexcept -> void {}
+
+    [[noreturn]]
+    auto unhandled_exception() noexcept -> void {
+        unreachable("unhandled exception");
+    }
+
+    template<typename U, effect... Gs>
+    [[nodiscard]]
+    auto await_transform(task<U, Gs...> t) noexcept -> task_awaiter<decltype(t)>
+        requires(evidence_context<Es...>::template handles<Gs...>)
+    {
+        t.frame_->promise().set_evidence(evidence_.get());
+        return task_awaiter{std::move(t)};
+    }
+
+    // Effects are passed to their handler in place.
+    template<effect E>
+    [[nodiscard]]
+    auto await_transform(E&& eff) noexcept
+        -> effect_awaiter<E, detail::handler_type_t<evidence_context<Es...>, E>>
+        requires(evidence_context<Es...>::template handles<E>)
+    {
+        tracing::detail::record(
+            tracing::event_kind::effect_perform,
+            handle_type::from_promise(*this).address(),
+            &tracing::detail::label_of<E>);
+        return effect_awaiter<E, detail::handler_type_t<evidence_context<Es...>, E>>{
+            get_handler<E>(), eff};
+    }
+
+    // Effects performed through an lvalue are copied first.
+    template<effect E>
+    [[nodiscard]]
+    auto await_transform(E const& eff) noexcept
+        -> effect_copy_awaiter<E, detail::handler_type_t<evidence_context<Es...>, E>>
+        requires(evidence_context<Es...>::template handles<E>)
+    {
+        tracing::detail::record(
+            tracing::event_kind::effect_perform,
+            handle_type::from_promise(*this).address(),
+            &tracing::detail::label_of<E>);
+        return effect_copy_awaiter<E, detail::handler_type_t<evidence_context<Es...>, E>>{
+            get_handler<E>(), eff};
+    }
+
+    template<effect E>
+    [[nodiscard]]
+    auto get_handler() const noexcept {
+        return evidence_.template get_handler<E>();
+    }
+
+    // Effects whose handler may not resume the generator are passed through an entry of the
+    // generator, in front of the evidence of the binding task.
+    auto set_evidence(evidence const* ev) noexcept -> void {
+        auto top = ev;
+        (bind_entry<Es>(ev, top), ...);
+        evidence_.set(top);
+    }
+
+    [[nodiscard]]
+    auto bound() const noexcept -> bool {
+        return evidence_.get() != nullptr;
+    }
+
+    // Resumes the generator up to its next element or its end. A generator whose handler ended
+    // without resuming it is destroyed, and a null handle is returned.
+    static auto advance(handle_type h) noexcept -> handle_type {
+        auto& p = h.promise();
+        if (not p.forwards_) {
+            h.resume();
+            return h;
+        }
+        p.value_ = nullptr;
+        h.resume();
+        if (h.done() or p.value_) return h;
+        check(p.drop_.handler and p.drop_.handler.done());
+        *p.owner_ = {};
+        return {};
+    }
+
+private:
+    friend class generator;
+    friend class iterator;
+
+    template<effect E>
+    auto bind_entry(evidence const* ev, evidence const*& top) noexcept -> void {
+        if constexpr (detail::forwarded_effect<E>) {
+            auto outer = ev->template find<E>();
+            if (outer->tail_resumptive()) return;
+            auto& entry = std::get<std::optional<detail::generator_entry<E>>>(entries_);
+            entry.emplace(outer, &drop_, top);
+            top = entry->node();
+            forwards_ = true;
+        }
+    }
+
+    T const* value_{};
+    evidence_context<Es...> evidence_;
+    frame<promise_type>* owner_{};
+    bool forwards_{};
+    detail::drop_hook drop_{std::noop_coroutine(), {}};
+    std::tuple<detail::generator_entry_slot<Es>...> entries_;
+};
+
+} // namespace corofx
@@ -1,38 +1,166 @@
 #pragma once
 
+#include "config.hpp"
+#include "detail/type_set.hpp"
 #include "effect.hpp"
 #include "frame.hpp"
+#include "frame_resource.hpp"
+#include "instrument.hpp"
 
+#include <concepts>
+#include <coroutine>
+#include <memory_resource>
 #include <optional>
+#include <type_traits>
+#include <utility>
 
 namespace corofx {
 
+// An effect row entry that statically binds `H::effect_type` to the handler type `H`.
+// Effects performed through a bound entry call the handler directly instead of through
+// `handler<E>`. Tasks with unbound entries can still be awaited from a task with bound ones.
+template<typename H>
+struct bound {
+    using return_type = H::effect_type::return_type;
+    using effect_type = H::effect_type;
+    using handler_type = H;
+};
+
+namespace detail {
+
+// Identifies an effect type at run time.
+// Evidence built in a shared library is found by user code, so every module must see the same key.
+// An instantiation is only as visible as its effect type, so effects whose evidence the library
+// builds are exported types.
 template<effect E>
+COROFX_PUBLIC inline constexpr char effect_key{};
+
+template<effect E>
+struct entry {
+    static auto lookup(std::type_identity<E>) noexcept -> E;
+};
+
+template<typename H>
+struct entry<bound<H>> {
+    static auto lookup(std::type_identity<typename H::effect_type>) noexcept -> bound<H>;
+    static auto lookup(std::type_identity<bound<H>>) noexcept -> bound<H>;
+};
+
+template<effect... Es>
+struct entries : entry<Es>... {
+    using entry<Es>::lookup...;
+};
+
+template<typename Entries, typename E>
+concept has_entry = requires { Entries::lookup(std::type_identity<E>{}); };
+
+// Maps an effect to the row entry that handles it, either `E` itself or a bound entry.
+template<typename Entries, effect E>
+using entry_of = decltype(Entries::lookup(std::type_identity<E>{}));
+
+// Where a handler task that does not resume the producer continues, instead of the continuation of
+// the task it handles. The handler task is recorded, so that the owner of the hook can tell that
+// it ended.
+struct drop_hook {
+    std::coroutine_handle<> cont;
+    std::coroutine_handle<> handler;
+};
+
+// Sets the hook taken by the next handler task created on this thread, and returns the previous
+// one.
+COROFX_PUBLIC auto exchange_drop_hook(drop_hook* hook) noexcept -> drop_hook*;
+
+} // namespace detail
+
+// An installed effect handler.
+// Evidence is linked to the evidence installed outside of it. A task only refers to the innermost
+// evidence in scope, so passing handlers to a child task is a single pointer copy.
 class evidence {
-protected:
-    auto set_handler(handler<E>* h) noexcept -> void { handler_ = h; }
+public:
+    evidence() noexcept = default;
+
+    template<effect E>
+    evidence(handler<E>* h, evidence const* parent) noexcept
+        : key_{&detail::effect_key<E>}, handler_{h}, parent_{parent} {}
 
+    // Finds the innermost handler for `E`.
+    // The chain is walked on every perform, so the cost grows with the number of handlers of other
+    // effects in between. Caching the result would cost every task frame instead.
+    template<effect E>
     [[nodiscard]]
-    auto get_handler() const noexcept -> handler<E>* {
-        return handler_;
+    auto find() const noexcept -> handler<E>* {
+        for (auto ev = this; ev; ev = ev->parent_) {
+            if (ev->key_ == &detail::effect_key<E>) return static_cast<handler<E>*>(ev->handler_);
+        }
+        return nullptr;
     }
 
+    [[nodiscard]]
+    auto parent() const noexcept -> evidence const* {
+        return parent_;
+    }
+
+    auto set_parent(evidence const* parent) noexcept -> void { parent_ = parent; }
+
 private:
-    handler<E>* handler_{};
+    void const* key_{};
+    void* handler_{};
+    evidence const* parent_{};
 };
 
+// The handlers in scope of a task with the effect row `Es...`.
 template<effect... Es>
-class evidence_vec : public evidence<Es>... {
+class evidence_context {
+    using entries = detail::entries<Es...>;
+
 public:
-    using evidence<Es>::set_handler...;
+    // Checks if every effect is handled, either through `handler<E>` or a bound entry.
+    template<effect... Gs>
+    static constexpr bool handles = (detail::has_entry<entries, Gs> and ...);
 
+    // Returns `handler<E>*` or, if `E` is bound, a pointer to the concrete handler type.
     template<effect E>
     [[nodiscard]]
-    auto get_handler() const noexcept -> handler<E>* {
-        return evidence<E>::get_handler();
+    auto get_handler() const noexcept {
+        using entry = detail::entry_of<entries, E>;
+        if constexpr (std::same_as<entry, E>) {
+            return evidence_->template find<E>();
+        } else {
+            return static_cast<typename entry::handler_type*>(
+                evidence_->template find<typename entry::effect_type>());
+        }
     }
+
+    [[nodiscard]]
+    auto get() const noexcept -> evidence const* {
+        return evidence_;
+    }
+
+    auto set(evidence const* ev) noexcept -> void { evidence_ = ev; }
+
+private:
+    evidence const* evidence_{};
 };
 
+namespace detail {
+
+// Declares `value_type` if the handler entry `H` does. Used by handler adapters.
+template<typename H>
+struct value_type_of {};
+
+template<typename H>
+    requires requires { typename H::value_type; }
+struct value_type_of<H> {
+    using value_type = H::value_type;
+};
+
+// The handler type that an effect awaited in `Context` is dispatched to.
+template<typename Context, effect E>
+using handler_type_t =
+    std::remove_pointer_t<decltype(std::declval<Context const&>().template get_handler<E>())>;
+
+} // namespace detail
+
 // An effect handler entry.
 template<effect E, typename F>
 class handler_impl : public handler<E> {
@@ -40,27 +168,40 @@ public:
     using effect_type = E;
     using task_type = std::invoke_result_t<F, E&&, resumer<E>&>;
     using value_type = task_type::value_type;
+    using effect_types = task_type::effect_types;
 
-    handler_impl(F fn) noexcept : fn_{std::move(fn)} {}
+    static constexpr bool tail_resumptive = false;
+
+    // Handler frames come from the frame resource in scope when the handler is created, so that
+    // they share the lifetime of the task it handles.
+    handler_impl(F fn) noexcept
+        : fn_{std::move(fn)}, resource_{detail::current_frame_resource()} {}
 
     [[nodiscard]]
-    auto handle(E&& eff, resumer<E>& resume) noexcept -> frame<> final {
+    auto handle(E&& eff, resumer<E>& resume, frame<>& storage) noexcept
+        -> std::coroutine_handle<> final {
+#ifdef COROFX_ENABLE_INSTRUMENTATION
+        auto scope = instrument::detail::effect_scope{
+            instrument::detail::site_of<E>(instrument::site_kind::effect)};
+#endif
+        auto resource = frame_resource_scope{resource_};
+        auto drop = detail::exchange_drop_hook(nullptr);
         auto task = fn_(std::move(eff), resume);
         auto& p = task.frame_->promise();
-        p.set_cont(cont_);
+        if (drop) {
+            drop->handler = *task.frame_;
+            p.set_cont(drop->cont);
+        } else {
+            p.set_cont(cont_);
+        }
         p.set_output(*output_);
-        task_type::effect_types::apply(
-            [&]<effect... Es>() { (p.set_handler(ev_vec_.template get_handler<Es>()), ...); });
-        return std::move(task);
+        p.set_evidence(evidence_);
+        storage = std::move(task);
+        return *storage;
     }
 
-    template<typename Task>
-    auto copy_handlers(Task& t) noexcept -> void {
-        if constexpr (not task_type::effect_types::empty) {
-            task_type::effect_types::apply(
-                [&]<effect... Es>() { (ev_vec_.set_handler(t.template get_handler<Es>()), ...); });
-        }
-    }
+    // Handler tasks run with the evidence in scope outside of the handler.
+    auto set_evidence(evidence const* ev) noexcept -> void { evidence_ = ev; }
 
     auto set_cont(std::coroutine_handle<> cont) noexcept -> void { cont_ = cont; }
     auto set_output(std::optional<value_holder<value_type>>& output) noexcept -> void {
@@ -69,16 +210,145 @@ public:
 
 private:
     F fn_;
+    std::pmr::memory_resource* resource_;
     std::coroutine_handle<> cont_;
     std::optional<value_holder<value_type>>* output_{};
-    task_type::effect_types::template unpack_to<evidence_vec> ev_vec_;
+    evidence const* evidence_{};
 };
 
 // Creates an effect handler entry.
+// A handler taking the effect by reference reads it in place, without copying or moving it.
 template<effect E, typename F>
 [[nodiscard]]
 auto handler_of(F fn) noexcept -> handler_impl<E, F> {
     return handler_impl<E, F>{std::move(fn)};
 }
 
+namespace detail {
+
+// The members of a handler entry that handles effects in place. It has no handler frame to link
+// to the task it handles, and is never asked to suspend it.
+template<effect E>
+struct inline_entry {
+    using effect_type = E;
+    using effect_types = type_set<>;
+
+    [[nodiscard]]
+    constexpr auto checks_ready() const noexcept -> bool {
+        return false;
+    }
+
+    [[nodiscard]]
+    auto try_ready(E&) noexcept -> std::optional<value_holder<typename E::return_type>> {
+        check_unreachable();
+    }
+
+    [[nodiscard]]
+    auto handle(E&&, resumer<E>&, frame<>&) noexcept -> std::coroutine_handle<> {
+        check_unreachable();
+    }
+
+    auto set_evidence(evidence const*) noexcept -> void {}
+
+    auto set_cont(std::coroutine_handle<>) noexcept -> void {}
+
+    template<typename Output>
+    auto set_output(Output&) noexcept -> void {}
+};
+
+} // namespace detail
+
+// The base of handler entries that only implement `handle_tail`.
+template<effect E>
+class tail_handler_entry : public handler<E>, public detail::inline_entry<E> {
+public:
+    static constexpr bool tail_resumptive = true;
+    static constexpr bool checks_ready = false;
+
+    [[nodiscard]]
+    auto handle(E&& eff, resumer<E>& resume, frame<>& storage) noexcept
+        -> std::coroutine_handle<> final {
+        return detail::inline_entry<E>::handle(std::move(eff), resume, storage);
+    }
+
+protected:
+    tail_handler_entry() noexcept : handler<E>{true} {}
+};
+
+// A tail-resumptive effect handler entry.
+// The handler is a plain function that always resumes the producer with its result.
+// It runs inline when the effect is performed, without a handler frame or a suspension.
+template<effect E, typename F>
+    requires std::same_as<std::invoke_result_t<F&, E&&>, typename E::return_type>
+class tail_handler_impl : public tail_handler_entry<E> {
+public:
+    tail_handler_impl(F fn) noexcept : fn_{std::move(fn)} {}
+
+    [[nodiscard]]
+    auto handle_tail(E&& eff) noexcept -> value_holder<typename E::return_type> final {
+        if constexpr (std::is_void_v<typename E::return_type>) {
+            fn_(std::move(eff));
+            return {};
+        } else {
+            return fn_(std::move(eff));
+        }
+    }
+
+private:
+    F fn_;
+};
+
+// Creates a tail-resumptive effect handler entry.
+template<effect E, typename F>
+[[nodiscard]]
+auto tail_handler_of(F fn) noexcept -> tail_handler_impl<E, F> {
+    return tail_handler_impl<E, F>{std::move(fn)};
+}
+
+// A suspending effect handler entry.
+// The handler is a plain function that returns the coroutine to transfer control to: either
+// `resume.set_value(x)` to resume the producer right away, or `std::noop_coroutine()` after
+// parking the producer to be resumed later through the handle returned by `set_value`.
+template<effect E, typename F>
+    requires std::same_as<std::invoke_result_t<F&, E&&, resumer<E>&>, std::coroutine_handle<>>
+class async_handler_impl : public handler<E> {
+public:
+    using effect_type = E;
+    using effect_types = detail::type_set<>;
+
+    static constexpr bool tail_resumptive = false;
+
+    async_handler_impl(F fn) noexcept : fn_{std::move(fn)} {}
+
+    [[nodiscard]]
+    auto handle(E&& eff, resumer<E>& resume, frame<>&) noexcept -> std::coroutine_handle<> final {
+        return fn_(std::move(eff), resume);
+    }
+
+    auto set_evidence(evidence const*) noexcept -> void {}
+
+    auto set_cont(std::coroutine_handle<>) noexcept -> void {}
+
+    template<typename Output>
+    auto set_output(Output&) noexcept -> void {}
+
+private:
+    F fn_;
+};
+
+// Creates a suspending effect handler entry.
+template<effect E, typename F>
+[[nodiscard]]
+auto async_handler_of(F fn) noexcept -> async_handler_impl<E, F> {
+    return async_handler_impl<E, F>{std::move(fn)};
+}
+
+// Handlers that never complete the handled task with a value can be used with any task.
+// clang-format off
+template<typename H, typename T>
+concept handler_returning =
+    effect<typename H::effect_type> and
+    (not requires { typename H::value_type; } or std::same_as<T, typename H::value_type>);
+// clang-format on
+
 } // namespace corofx
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Coroutine frame instrumentation.
+// Counting is compiled in with `COROFX_ENABLE_INSTRUMENTATION`. Otherwise all counters stay zero.
+namespace corofx::instrument {
+
+struct frame_counters {
+    std::uint64_t allocated{};
+    std::uint64_t freed{};
+    std::uint64_t allocated_bytes{};
+    std::uint64_t freed_bytes{};
+    std::uint64_t peak_live{};
+
+    [[nodiscard]]
+    auto live() const noexcept -> std::uint64_t {
+        return allocated > freed ? allocated - freed : 0;
+    }
+};
+
+enum class site_kind : std::uint8_t {
+    // Frames of a `task<T, Es...>` instantiation.
+    task,
+    // Handler frames created to handle an effect type.
+    effect,
+};
+
+struct site_counters {
+    site_kind kind;
+    std::string_view name;
+    frame_counters counters;
+};
+
+// Counters for frames allocated and freed on the calling thread.
+// A frame freed on another thread is counted there, so `live()` is only meaningful globally.
+[[nodiscard]]
+COROFX_PUBLIC auto thread_counters() noexcept -> frame_counters;
+
+[[nodiscard]]
+COROFX_PUBLIC auto global_counters() noexcept -> frame_counters;
+
+// Returns the counters of every task type and effect type that has allocated a frame.
+[[nodiscard]]
+COROFX_PUBLIC auto site_snapshot() -> std::vector<site_counters>;
+
+// Resets all peak counters to the current number of live frames.
+COROFX_PUBLIC auto reset_peaks() noexcept -> void;
+
+namespace detail {
+
+template<typename T>
+[[nodiscard]]
+constexpr auto type_name() noexcept -> std::string_view {
+#if defined(__clang__) || defined(__GNUC__)
+    auto name = std::string_view{__PRETTY_FUNCTION__};
+    auto first = name.find("T = ") + 4;
+    auto last = name.find_first_of(";]", first);
+#elif defined(_MSC_VER)
+    auto name = std::string_view{__FUNCSIG__};
+    auto first = name.find("type_name<") + 10;
+    auto last = name.rfind(">(");
+#else
+    auto name = std::string_view{"unknown"};
+    auto first = std::size_t{};
+    auto last = name.size();
+#endif
+    return name.substr(first, last - first);
+}
+
+class site {
+public:
+    COROFX_PUBLIC site(site_kind kind, std::string_view name) noexcept;
+
+    site(site const&) = delete;
+    site(site&&) = delete;
+    ~site() = default;
+    auto operator=(site const&) -> site& = delete;
+    auto operator=(site&&) -> site& = delete;
+
+private:
+    friend auto record_allocation(site*, site*, std::size_t) noexcept -> void;
+    friend auto record_free(site*, site*, std::size_t) noexcept -> void;
+    friend auto instrument::site_snapshot() -> std::vector<site_counters>;
+    friend auto instrument::reset_peaks() noexcept -> void;
+
+    site_kind kind_;
+    std::string_view name_;
+    std::atomic<std::uint64_t> allocated_;
+    std::atomic<std::uint64_t> freed_;
+    std::atomic<std::uint64_t> allocated_bytes_;
+    std::atomic<std::uint64_t> freed_bytes_;
+    std::atomic<std::uint64_t> peak_live_;
+    site* next_;
+};
+
+template<typename T>
+[[nodiscard]]
+auto site_of(site_kind kind) noexcept -> site* {
+    static auto s = site{kind, type_name<T>()};
+    return &s;
+}
+
+// Space reserved in front of each instrumented frame for the effect site.
+inline constexpr auto header_size = std::size_t{__STDCPP_DEFAULT_NEW_ALIGNMENT__};
+
+COROFX_PUBLIC auto record_allocation(site* task, site* effect, std::size_t size) noexcept -> void;
+COROFX_PUBLIC auto record_free(site* task, site* effect, std::size_t size) noexcept -> void;
+
+// The effect site that frames allocated on this thread are attributed to.
+[[nodiscard]]
+COROFX_PUBLIC auto current_effect() noexcept -> site*&;
+
+// Attributes frames allocated during its lifetime to an effect type.
+class effect_scope {
+public:
+    explicit effect_scope(site* effect) noexcept : prev_{std::exchange(current_effect(), effect)} {}
+
+    effect_scope(effect_scope const&) = delete;
+    effect_scope(effect_scope&&) = delete;
+    ~effect_scope() { current_effect() = prev_; }
+    auto operator=(effect_scope const&) -> effect_scope& = delete;
+    auto operator=(effect_scope&&) -> effect_scope& = delete;
+
+private:
+    site* prev_;
+};
+
+// Wraps the allocation of a frame for the promise type `P`.
+template<typename P, typename Allocate>
+[[nodiscard]]
+auto allocate_frame(std::size_t size, Allocate allocate) -> void* {
+    auto effect = current_effect();
+    auto p = static_cast<std::byte*>(allocate(size + header_size));
+    *reinterpret_cast<site**>(p) = effect; // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    record_allocation(site_of<P>(site_kind::task), effect, size);
+    return p + header_size;
+}
+
+// Wraps the deallocation of a frame for the promise type `P`.
+template<typename P, typename Deallocate>
+auto deallocate_frame(void* ptr, std::size_t size, Deallocate deallocate) noexcept -> void {
+    auto p = static_cast<std::byte*>(ptr) - header_size;
+    auto effect = *reinterpret_cast<site**>(p); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    record_free(site_of<P>(site_kind::task), effect, size);
+    deallocate(p, size + header_size);
+}
+
+} // namespace detail
+
+} // namespace corofx::instrument
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "config.hpp"
+#include "detail/probe.hpp"
+#include "effect.hpp"
+#include "frame.hpp"
+#include "handler.hpp"
+#include "instrument.hpp"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Effect latency instrumentation.
+// Handlers wrapped with `instrumented` record how long each effect takes from being performed to
+// resuming its producer, in a histogram per effect type and thread.
+namespace corofx::instrument {
+
+namespace detail {
+
+class latency_site;
+
+} // namespace detail
+
+// A log-linear histogram of nanosecond latencies with a relative error of at most 1/16.
+class latency_histogram {
+public:
+    static constexpr auto sub_bucket_bits = 4;
+    static constexpr auto sub_buckets = std::size_t{1} << sub_bucket_bits;
+    static constexpr auto num_buckets = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+    [[nodiscard]]
+    static constexpr auto bucket_of(std::uint64_t ns) noexcept -> std::size_t {
+        if (ns < sub_buckets) return static_cast<std::size_t>(ns);
+        auto shift = std::bit_width(ns) - 1 - sub_bucket_bits;
+        return static_cast<std::size_t>(shift + 1) * sub_buckets +
+               static_cast<std::size_t>((ns >> shift) & (sub_buckets - 1));
+    }
+
+    // Returns the highest latency counted in a bucket.
+    [[nodiscard]]
+    static constexpr auto highest_of(std::size_t bucket) noexcept -> std::uint64_t {
+        if (bucket < sub_buckets) return bucket;
+        auto shift = bucket / sub_buckets - 1;
+        auto low = (sub_buckets + bucket % sub_buckets) << shift;
+        return low + ((std::uint64_t{1} << shift) - 1);
+    }
+
+    auto record(std::uint64_t ns) noexcept -> void {
+        ++counts_[bucket_of(ns)];
+        ++count_;
+        sum_ += ns;
+    }
+
+    auto merge(latency_histogram const& that) noexcept -> void {
+        for (auto i = std::size_t{}; i < num_buckets; ++i) counts_[i] += that.counts_[i];
+        count_ += that.count_;
+        sum_ += that.sum_;
+    }
+
+    // Returns the latency that a fraction `q` of the recorded latencies do not exceed.
+    [[nodiscard]]
+    COROFX_PUBLIC auto percentile(double q) const noexcept -> std::uint64_t;
+
+    [[nodiscard]]
+    auto count() const noexcept -> std::uint64_t {
+        return count_;
+    }
+
+    [[nodiscard]]
+    auto sum() const noexcept -> std::uint64_t {
+        return sum_;
+    }
+
+private:
+    friend class detail::latency_site;
+
+    std::array<std::uint64_t, num_buckets> counts_{};
+    std::uint64_t count_{};
+    std::uint64_t sum_{};
+};
+
+struct effect_latency {
+    std::string_view name;
+    // Effects handled, including those whose producer was never resumed.
+    std::uint64_t invocations;
+    // Latencies of the effects whose producer was resumed.
+    latency_histogram histogram;
+};
+
+// Merges the histograms of every thread, for every effect type handled by an instrumented handler.
+[[nodiscard]]
+COROFX_PUBLIC auto latency_snapshot() -> std::vector<effect_latency>;
+
+// Writes p50, p99 and p999 latencies, their sum and their count in the Prometheus text format.
+[[nodiscard]]
+COROFX_PUBLIC auto write_prometheus(std::vector<effect_latency> const& latencies, char const* path)
+    -> bool;
+
+namespace detail {
+
+// The counters of one thread for one effect type. Only the owning thread writes to them.
+struct thread_latencies {
+    std::array<std::atomic<std::uint64_t>, latency_histogram::num_buckets> counts;
+    std::atomic<std::uint64_t> count;
+    std::atomic<std::uint64_t> sum;
+    std::atomic<std::uint64_t> invocations;
+};
+
+class latency_site {
+public:
+    COROFX_PUBLIC explicit latency_site(std::string_view name) noexcept;
+
+    latency_site(latency_site const&) = delete;
+    latency_site(latency_site&&) = delete;
+    ~latency_site() = default;
+    auto operator=(latency_site const&) -> latency_site& = delete;
+    auto operator=(latency_site&&) -> latency_site& = delete;
+
+    auto record_invocation() noexcept -> void { bump(local().invocations, 1); }
+
+    auto record(std::uint64_t ns) noexcept -> void {
+        auto& l = local();
+        bump(l.counts[latency_histogram::bucket_of(ns)], 1);
+        bump(l.count, 1);
+        bump(l.sum, ns);
+    }
+
+private:
+    friend auto instrument::latency_snapshot() -> std::vector<effect_latency>;
+
+    static auto bump(std::atomic<std::uint64_t>& counter, std::uint64_t n) noexcept -> void {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Returns the counters of the calling thread, creating them on first use.
+    [[nodiscard]]
+    COROFX_PUBLIC auto local() noexcept -> thread_latencies&;
+
+    [[nodiscard]]
+    auto merged() -> effect_latency;
+
+    std::string_view name_;
+    std::size_t index_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<thread_latencies>> threads_;
+    latency_site* next_;
+};
+
+template<effect E>
+[[nodiscard]]
+auto latency_site_of() noexcept -> latency_site* {
+    static auto s = latency_site{type_name<E>()};
+    return &s;
+}
+
+[[nodiscard]]
+inline auto now() noexcept -> std::uint64_t {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+// Records the latency of an effect when its handler resumes the producer.
+inline auto time_resume(latency_site* site, std::uint64_t start, std::coroutine_handle<> producer)
+    -> corofx::detail::probe {
+    site->record(now() - start);
+    co_await corofx::detail::resume_with{producer};
+}
+
+} // namespace detail
+
+} // namespace corofx::instrument
+
+namespace corofx {
+
+// A handler entry that records the latency of each effect handled by `H`.
+// Tail-resumptive handlers are timed inline. Other handlers resume a small probe frame instead of
+// the producer, which records the latency and then resumes the producer.
+template<typename H>
+class instrumented_handler : public handler<typename H::effect_type>,
+                             public detail::value_type_of<H> {
+public:
+    using effect_type = H::effect_type;
+    using effect_types = H::effect_types;
+
+    static constexpr bool tail_resumptive = H::tail_resumptive;
+
+    explicit instrumented_handler(H inner) noexcept
+        : handler<effect_type>{tail_resumptive}, inner_{std::move(inner)},
+          site_{instrument::detail::latency_site_of<effect_type>()} {}
+
+    [[nodiscard]]
+    auto handle(effect_type&& eff, resumer<effect_type>& resume, frame<>& storage) noexcept
+        -> std::coroutine_handle<> final {
+        site_->record_invocation();
+        auto& producer = detail::resumer_access::producer(resume);
+        auto p = instrument::detail::time_resume(site_, instrument::detail::now(), producer);
+        producer = p.get();
+        auto next = inner_.handle(std::move(eff), resume, storage);
+        p.get().promise().inner = std::move(storage);
+        storage = std::move(p);
+        return next;
+    }
+
+    [[nodiscard]]
+    auto handle_tail(effect_type&& eff) noexcept
+        -> value_holder<typename effect_type::return_type> final {
+        site_->record_invocation();
+        auto start = instrument::detail::now();
+        auto value = inner_.handle_tail(std::move(eff));
+        site_->record(instrument::detail::now() - start);
+        return value;
+    }
+
+    auto set_evidence(evidence const* ev) noexcept -> void { inner_.set_evidence(ev); }
+
+    auto set_cont(std::coroutine_handle<> cont) noexcept -> void { inner_.set_cont(cont); }
+
+    template<typename Output>
+    auto set_output(Output& output) noexcept -> void {
+        inner_.set_output(output);
+    }
+
+private:
+    H inner_;
+    instrument::detail::latency_site* site_;
+};
+
+// Wraps a handler entry to record effect latencies, queried with `instrument::latency_snapshot`.
+template<typename H>
+[[nodiscard]]
+auto instrumented(H handler) noexcept -> instrumented_handler<H> {
+    return instrumented_handler<H>{std::move(handler)};
+}
+
+} // namespace corofx
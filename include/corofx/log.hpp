@@ -0,0 +1,245 @@
+#pragma once
+
+#include "config.hpp"
+#include "effect.hpp"
+#include "handler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+namespace corofx {
+
+enum class log_level : std::uint8_t { debug, info, warning, error };
+
+// What a thread does when its buffer has no room for a record.
+enum class log_overflow : std::uint8_t {
+    // Discards the record.
+    drop,
+    // Wakes the writer and waits for it to make room.
+    // The wait ties up the OS thread, and with it a scheduler worker, since the task is not parked.
+    // The thread yields, then sleeps for up to a millisecond at a time until the record fits.
+    block,
+    // Writes the buffer and the record from the logging thread.
+    sync,
+};
+
+struct log_options {
+    // The size of each thread's buffer, rounded up to a power of two.
+    std::size_t buffer_size{std::size_t{1} << 20};
+    log_overflow overflow{log_overflow::drop};
+    // How long the writer waits for more records once every buffer is empty. It then sleeps until
+    // a thread logs again.
+    std::chrono::steady_clock::duration flush_interval{std::chrono::milliseconds{1}};
+};
+
+struct log_stats {
+    // Records written to buffers.
+    std::uint64_t records{};
+    // Records discarded by `log_overflow::drop`.
+    std::uint64_t dropped{};
+    // Bytes lost to failed writes.
+    std::uint64_t failed_bytes{};
+};
+
+namespace detail {
+
+// Formats the arguments of a record into a fixed buffer, truncating what does not fit.
+class log_writer {
+public:
+    log_writer(char* first, char* last) noexcept : pos_{first}, end_{last} {}
+
+    auto append(std::string_view s) noexcept -> void {
+        auto n = std::min(s.size(), static_cast<std::size_t>(end_ - pos_));
+        pos_ = std::copy_n(s.data(), n, pos_);
+    }
+
+    template<typename T>
+    auto write(T const& value) noexcept -> void {
+        if constexpr (std::is_same_v<T, bool>) {
+            append(value ? "true" : "false");
+        } else if constexpr (std::is_same_v<T, char>) {
+            append({&value, 1});
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            auto [ptr, ec] = std::to_chars(pos_, end_, value);
+            pos_ = ec == std::errc{} ? ptr : end_;
+        } else {
+            append(std::string_view{value});
+        }
+    }
+
+    [[nodiscard]]
+    auto pos() const noexcept -> char* {
+        return pos_;
+    }
+
+private:
+    char* pos_;
+    char* end_;
+};
+
+class log_buffer;
+
+} // namespace detail
+
+template<typename T>
+concept loggable = std::is_arithmetic_v<T> or std::convertible_to<T const&, std::string_view>;
+
+// Appends a line to the log of the handler.
+// The record refers to its arguments and is formatted by the handler, so it must be performed in
+// the full-expression that creates it: `co_await log_message::info("served ", n, " bytes");`.
+class log_message {
+public:
+    using return_type = void;
+
+    static constexpr auto max_args = std::size_t{8};
+
+    template<loggable... Args>
+        requires(sizeof...(Args) <= max_args)
+    log_message(log_level level, Args const&... args) noexcept
+        : level_{level},
+          format_{&format<Args...>},
+          args_{static_cast<void const*>(std::addressof(args))...} {}
+
+    template<loggable... Args>
+    [[nodiscard]]
+    static auto debug(Args const&... args) noexcept -> log_message {
+        return {log_level::debug, args...};
+    }
+
+    template<loggable... Args>
+    [[nodiscard]]
+    static auto info(Args const&... args) noexcept -> log_message {
+        return {log_level::info, args...};
+    }
+
+    template<loggable... Args>
+    [[nodiscard]]
+    static auto warning(Args const&... args) noexcept -> log_message {
+        return {log_level::warning, args...};
+    }
+
+    template<loggable... Args>
+    [[nodiscard]]
+    static auto error(Args const&... args) noexcept -> log_message {
+        return {log_level::error, args...};
+    }
+
+    [[nodiscard]]
+    auto level() const noexcept -> log_level {
+        return level_;
+    }
+
+    // Formats the arguments.
+    auto format_to(detail::log_writer& out) const noexcept -> void { format_(out, args_.data()); }
+
+private:
+    template<typename... Args>
+    static auto format(detail::log_writer& out, void const* const* args) noexcept -> void {
+        auto i = std::size_t{};
+        (out.write(*static_cast<Args const*>(args[i++])), ...);
+    }
+
+    log_level level_;
+    auto (*format_)(detail::log_writer& out, void const* const* args) noexcept -> void;
+    std::array<void const*, max_args> args_{};
+};
+
+// Writes log records to a file descriptor from a background thread.
+// Each thread formats records into its own buffer, a single-producer ring of bytes. The writer
+// drains every buffer with one `writev`, so logging never takes a lock, allocates, or makes a
+// system call, except when a thread logs for the first time, which registers its buffer, when a
+// buffer overflows, and when the writer has gone to sleep. A buffer is released once its thread
+// has exited and it is written out.
+class logger {
+public:
+    // The longest record, including its timestamp, level and newline. Longer ones are truncated.
+    static constexpr auto max_record_size = std::size_t{1024};
+
+    // Logs to `fd`, which must stay open until the logger is destroyed.
+    COROFX_PUBLIC explicit logger(int fd, log_options const& options = {});
+
+    logger(logger const&) = delete;
+    logger(logger&&) = delete;
+    // Writes every record left and stops the writer.
+    COROFX_PUBLIC ~logger();
+    auto operator=(logger const&) -> logger& = delete;
+    auto operator=(logger&&) -> logger& = delete;
+
+    // Opens `path` for appending and logs to it.
+    // Returns null if the file could not be opened.
+    [[nodiscard]]
+    COROFX_PUBLIC static auto open(char const* path, log_options const& options = {})
+        -> std::unique_ptr<logger>;
+
+    // Appends a record to the buffer of the calling thread.
+    COROFX_PUBLIC auto write(log_message const& msg) noexcept -> void;
+
+    // Writes every record in the buffers, waiting for the writer if it is writing some of them.
+    COROFX_PUBLIC auto flush() noexcept -> void;
+
+    [[nodiscard]]
+    COROFX_PUBLIC auto stats() const -> log_stats;
+
+private:
+    // Returns the buffer of the calling thread, or null if it could not be allocated.
+    auto buffer() noexcept -> detail::log_buffer*;
+    auto overflow(detail::log_buffer& b, std::string_view record) noexcept -> void;
+    auto run() -> void;
+    // Frees the buffers of exited threads that are written out, and returns the first buffer.
+    auto release_exited() -> detail::log_buffer*;
+    auto wake() noexcept -> void;
+
+    int fd_;
+    bool owned_{};
+    log_options options_;
+    std::uint64_t id_;
+
+    mutable std::mutex mutex_;
+    // A list of buffers, linked through `log_buffer::next`.
+    std::unique_ptr<detail::log_buffer> buffers_;
+    // The counters of released buffers.
+    log_stats released_;
+    std::condition_variable cv_;
+    std::atomic<bool> wake_;
+    // Set while the writer sleeps until a thread logs. Guarded by the mutex.
+    bool idle_{};
+    std::atomic<bool> stop_;
+    std::atomic<std::uint64_t> failed_bytes_;
+    std::thread writer_;
+};
+
+// The handler of `log_message`, which appends records to a logger in place.
+class log_handler : public tail_handler_entry<log_message> {
+public:
+    explicit log_handler(logger& l) noexcept : logger_{&l} {}
+
+    [[nodiscard]]
+    auto handle_tail(log_message&& msg) noexcept -> value_holder<void> final {
+        logger_->write(msg);
+        return {};
+    }
+
+private:
+    logger* logger_;
+};
+
+// Creates a handler entry that appends records to `l`.
+[[nodiscard]]
+inline auto log_handler_of(logger& l) noexcept -> log_handler {
+    return log_handler{l};
+}
+
+} // namespace corofx
@@ -0,0 +1,286 @@
+#pragma once
+
+#include "check.hpp"
+#include "detail/probe.hpp"
+#include "effect.hpp"
+#include "frame.hpp"
+#include "handler.hpp"
+
+#include <chrono>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace corofx {
+
+enum class eviction : std::uint8_t {
+    // Evicts the least recently used result.
+    lru,
+    // Evicts the first result not used since the clock hand last passed it.
+    clock,
+};
+
+struct memo_options {
+    // The number of results kept.
+    std::size_t capacity{1024};
+    eviction policy{eviction::lru};
+    // How long a result stays valid. Zero keeps results until they are evicted.
+    std::chrono::steady_clock::duration ttl{};
+};
+
+struct memo_stats {
+    std::uint64_t hits{};
+    std::uint64_t misses{};
+    std::uint64_t evictions{};
+    std::uint64_t expirations{};
+};
+
+// A bounded map from effects to results, safe to share between threads.
+template<effect E, typename Hash = std::hash<E>, typename Eq = std::equal_to<E>>
+class memo_cache {
+public:
+    using value_type = value_holder<typename E::return_type>;
+    using clock = std::chrono::steady_clock;
+
+    explicit memo_cache(memo_options const& options)
+        : options_{options}, index_(options.capacity) {
+        check(options_.capacity > 0 and options_.capacity < nil);
+        slots_.reserve(options_.capacity);
+    }
+
+    // Returns the result for an effect, counting a hit or a miss.
+    [[nodiscard]]
+    auto find(E const& eff) -> std::optional<value_type> {
+        auto lock = std::lock_guard{mutex_};
+        auto it = index_.find(eff);
+        if (it == index_.end()) {
+            ++stats_.misses;
+            return std::nullopt;
+        }
+        auto i = it->second;
+        auto& s = slots_[i];
+        if (options_.ttl != clock::duration{} and clock::now() >= s.expires) {
+            ++stats_.expirations;
+            ++stats_.misses;
+            remove(i);
+            return std::nullopt;
+        }
+        ++stats_.hits;
+        touch(i);
+        return s.value;
+    }
+
+    auto insert(E const& eff, value_type const& value) -> void {
+        auto lock = std::lock_guard{mutex_};
+        auto expires = options_.ttl != clock::duration{} ? clock::now() + options_.ttl
+                                                         : clock::time_point::max();
+        if (auto it = index_.find(eff); it != index_.end()) {
+            auto& s = slots_[it->second];
+            s.value = value;
+            s.expires = expires;
+            touch(it->second);
+            return;
+        }
+        auto i = acquire();
+        auto it = index_.emplace(eff, i).first;
+        if (i == slots_.size()) {
+            slots_.push_back({&it->first, value, expires, nil, nil, false});
+        } else {
+            slots_[i].key = &it->first;
+            slots_[i].value = value;
+            slots_[i].expires = expires;
+        }
+        link_front(i);
+    }
+
+    [[nodiscard]]
+    auto stats() const -> memo_stats {
+        auto lock = std::lock_guard{mutex_};
+        return stats_;
+    }
+
+    [[nodiscard]]
+    auto size() const -> std::size_t {
+        auto lock = std::lock_guard{mutex_};
+        return index_.size();
+    }
+
+private:
+    static constexpr auto nil = std::numeric_limits<std::uint32_t>::max();
+
+    // Results live in a fixed set of slots, linked from most to least recently used for LRU.
+    struct slot {
+        E const* key;
+        value_type value;
+        clock::time_point expires;
+        std::uint32_t prev;
+        std::uint32_t next;
+        bool referenced;
+    };
+
+    // Returns a free slot, evicting a result if the cache is full.
+    [[nodiscard]]
+    auto acquire() -> std::uint32_t {
+        if (not free_.empty()) {
+            auto i = free_.back();
+            free_.pop_back();
+            return i;
+        }
+        if (slots_.size() < options_.capacity) return static_cast<std::uint32_t>(slots_.size());
+        auto victim = tail_;
+        if (options_.policy == eviction::clock) {
+            while (slots_[hand_].referenced) {
+                slots_[hand_].referenced = false;
+                hand_ = (hand_ + 1) % static_cast<std::uint32_t>(slots_.size());
+            }
+            victim = hand_;
+            hand_ = (hand_ + 1) % static_cast<std::uint32_t>(slots_.size());
+        }
+        ++stats_.evictions;
+        remove(victim);
+        free_.pop_back();
+        return victim;
+    }
+
+    auto remove(std::uint32_t i) -> void {
+        unlink(i);
+        index_.erase(index_.find(*slots_[i].key));
+        slots_[i].key = nullptr;
+        slots_[i].referenced = false;
+        free_.push_back(i);
+    }
+
+    auto touch(std::uint32_t i) -> void {
+        if (options_.policy == eviction::clock) {
+            slots_[i].referenced = true;
+        } else if (head_ != i) {
+            unlink(i);
+            link_front(i);
+        }
+    }
+
+    auto link_front(std::uint32_t i) -> void {
+        slots_[i].prev = nil;
+        slots_[i].next = head_;
+        if (head_ != nil) slots_[head_].prev = i;
+        head_ = i;
+        if (tail_ == nil) tail_ = i;
+    }
+
+    auto unlink(std::uint32_t i) -> void {
+        auto& s = slots_[i];
+        (s.prev != nil ? slots_[s.prev].next : head_) = s.next;
+        (s.next != nil ? slots_[s.next].prev : tail_) = s.prev;
+        s.prev = s.next = nil;
+    }
+
+    memo_options options_;
+    mutable std::mutex mutex_;
+    std::unordered_map<E, std::uint32_t, Hash, Eq> index_;
+    std::vector<slot> slots_;
+    std::vector<std::uint32_t> free_;
+    std::uint32_t head_{nil};
+    std::uint32_t tail_{nil};
+    std::uint32_t hand_{};
+    memo_stats stats_;
+};
+
+namespace detail {
+
+// Caches the result of an effect when its handler resumes the producer.
+template<typename Cache, effect E>
+auto fill_on_resume(Cache* cache, E eff, resumer<E>* resume, std::coroutine_handle<> producer)
+    -> probe {
+    cache->insert(eff, *resumer_access::value(*resume));
+    co_await resume_with{producer};
+}
+
+} // namespace detail
+
+// A handler entry that answers repeated effects from a cache.
+// A hit resumes the producer right away, without running the handler `H`. On a miss, the handler
+// resumes a small probe frame instead of the producer, which caches the result and then resumes the
+// producer. Copies share the cache, so a handler can be reused across tasks.
+template<typename H, typename Hash = std::hash<typename H::effect_type>,
+         typename Eq = std::equal_to<typename H::effect_type>>
+class memoizing_handler : public handler<typename H::effect_type>, public detail::value_type_of<H> {
+public:
+    using effect_type = H::effect_type;
+    using effect_types = H::effect_types;
+    using cache_type = memo_cache<effect_type, Hash, Eq>;
+
+    static constexpr bool tail_resumptive = H::tail_resumptive;
+
+    memoizing_handler(H inner, std::shared_ptr<cache_type> cache) noexcept
+        : handler<effect_type>{tail_resumptive}, inner_{std::move(inner)},
+          cache_{std::move(cache)} {}
+
+    [[nodiscard]]
+    auto handle(effect_type&& eff, resumer<effect_type>& resume, frame<>& storage) noexcept
+        -> std::coroutine_handle<> final {
+        if (auto value = cache_->find(eff)) return resume.set_value(std::move(*value));
+        auto& producer = detail::resumer_access::producer(resume);
+        auto p = detail::fill_on_resume(cache_.get(), eff, &resume, producer);
+        producer = p.get();
+        auto next = inner_.handle(std::move(eff), resume, storage);
+        p.get().promise().inner = std::move(storage);
+        storage = std::move(p);
+        return next;
+    }
+
+    [[nodiscard]]
+    auto handle_tail(effect_type&& eff) noexcept
+        -> value_holder<typename effect_type::return_type> final {
+        if (auto value = cache_->find(eff)) return std::move(*value);
+        auto key = eff;
+        auto value = inner_.handle_tail(std::move(eff));
+        cache_->insert(key, value);
+        return value;
+    }
+
+    // Returns the cache, shared by every copy of this handler.
+    [[nodiscard]]
+    auto cache() const noexcept -> std::shared_ptr<cache_type> const& {
+        return cache_;
+    }
+
+    [[nodiscard]]
+    auto stats() const -> memo_stats {
+        return cache_->stats();
+    }
+
+    auto set_evidence(evidence const* ev) noexcept -> void { inner_.set_evidence(ev); }
+
+    auto set_cont(std::coroutine_handle<> cont) noexcept -> void { inner_.set_cont(cont); }
+
+    template<typename Output>
+    auto set_output(Output& output) noexcept -> void {
+        inner_.set_output(output);
+    }
+
+private:
+    H inner_;
+    std::shared_ptr<cache_type> cache_;
+};
+
+// Wraps a handler entry for a pure effect to cache its results by effect value.
+// The effect must be copyable, hashable with `Hash` and comparable with `Eq`.
+template<effect E, typename H, typename Hash = std::hash<E>, typename Eq = std::equal_to<E>>
+    requires std::same_as<E, typename H::effect_type> and std::copyable<E> and
+             std::copyable<value_holder<typename E::return_type>>
+[[nodiscard]]
+auto memoize(H handler, memo_options const& options = {}) -> memoizing_handler<H, Hash, Eq> {
+    return {std::move(handler), std::make_shared<memo_cache<E, Hash, Eq>>(options)};
+}
+
+} // namespace corofx
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "config.hpp"
+#include "detail/type_set.hpp"
+#include "effect.hpp"
+#include "frame.hpp"
+#include "scheduler.hpp"
+#include "task.hpp"
+#include "timer.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+namespace corofx {
+
+// Network effects on non-blocking sockets.
+// Results follow the system calls, except that errors are returned as `-errno`.
+// One task at a time may wait to read from or accept on a socket, and one to write to it. Another
+// task that would wait for the same gets `-EBUSY`.
+
+// Accepts a connection on a listening socket and returns a non-blocking socket for it.
+struct COROFX_PUBLIC net_accept {
+    using return_type = int;
+
+    int fd{};
+};
+
+// Reads into `buffer` and returns the number of bytes read, which is 0 at end of stream.
+struct COROFX_PUBLIC net_read {
+    using return_type = std::ptrdiff_t;
+
+    int fd{};
+    std::span<std::byte> buffer;
+};
+
+// Writes some prefix of `buffer` and returns the number of bytes written.
+struct COROFX_PUBLIC net_write {
+    using return_type = std::ptrdiff_t;
+
+    int fd{};
+    std::span<std::byte const> buffer;
+};
+
+template<>
+inline constexpr bool spawnable<net_accept> = true;
+
+template<>
+inline constexpr bool spawnable<net_read> = true;
+
+template<>
+inline constexpr bool spawnable<net_write> = true;
+
+namespace detail {
+
+class reactor_state;
+
+} // namespace detail
+
+// A single-threaded epoll event loop handling network, timer and scheduling effects.
+// Tasks parked by `suspend` may be woken from other threads.
+//
+// Operations are attempted as soon as they are performed. Only when a socket is not ready is the
+// performing task parked until epoll reports readiness; the loop then retries the operation and
+// resumes the task. Sleeping tasks are parked in a timer wheel that bounds the epoll timeout.
+// Tasks run one at a time on the thread calling `run`.
+class reactor {
+public:
+    using effect_types = detail::type_set<
+        spawn,
+        yield_thread,
+        join,
+        net_accept,
+        net_read,
+        net_write,
+        sleep_for,
+        sleep_until,
+        suspend>;
+
+    // The granularity of sleeps. Tasks are never woken up early.
+    static constexpr auto timer_resolution = std::chrono::milliseconds{1};
+
+    COROFX_PUBLIC reactor();
+    COROFX_PUBLIC ~reactor();
+
+    reactor(reactor const&) = delete;
+    reactor(reactor&&) = delete;
+    auto operator=(reactor const&) -> reactor& = delete;
+    auto operator=(reactor&&) -> reactor& = delete;
+
+    // Runs a task and every task it spawned to completion, and returns its result.
+    template<typename T, effect... Es>
+        requires(effect_types::template contains<detail::type_set<Es...>>)
+    [[nodiscard]]
+    auto run(task<T, Es...> t) -> T {
+        auto output = std::optional<value_holder<T>>{};
+        run_root(std::move(t), &detail::bind_task<T, Es...>, &output);
+        if constexpr (not std::is_void_v<T>) return std::move(*output);
+    }
+
+    // Returns how late sleeping tasks have been woken up so far.
+    [[nodiscard]]
+    COROFX_PUBLIC auto timer_slack() const noexcept -> timer_stats;
+
+private:
+    COROFX_PUBLIC auto run_root(frame<> root, detail::bind_fn bind, void* output) -> void;
+
+    std::unique_ptr<detail::reactor_state> state_;
+};
+
+} // namespace corofx
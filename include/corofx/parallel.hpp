@@ -0,0 +1,250 @@
+#pragma once
+
+#include "config.hpp"
+#include "effect.hpp"
+#include "handler.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace corofx {
+
+// Data-parallel effects. Which code may run in parallel shows in its effect row.
+// Bodies and operators may run on several threads at once, and cannot perform effects.
+
+// Runs `body(i)` for every `i` in `[first, last)`, in any order.
+// The effect refers to `body`, so it must be performed in the full-expression that creates it.
+class parallel_for {
+public:
+    using return_type = void;
+
+    template<typename F>
+        requires std::invocable<F const&, std::size_t>
+    parallel_for(std::size_t first, std::size_t last, F const& body) noexcept
+        : first_{first}, last_{last}, body_{std::addressof(body)}, run_{&run<F>} {}
+
+    [[nodiscard]]
+    auto first() const noexcept -> std::size_t {
+        return first_;
+    }
+
+    [[nodiscard]]
+    auto last() const noexcept -> std::size_t {
+        return last_;
+    }
+
+    // Runs the body on `[first, last)`.
+    auto operator()(std::size_t first, std::size_t last) const -> void { run_(body_, first, last); }
+
+private:
+    template<typename F>
+    static auto run(void const* body, std::size_t first, std::size_t last) -> void {
+        auto const& f = *static_cast<F const*>(body);
+        for (auto i = first; i < last; ++i) std::invoke(f, i);
+    }
+
+    std::size_t first_;
+    std::size_t last_;
+    void const* body_;
+    auto (*run_)(void const* body, std::size_t first, std::size_t last) -> void;
+};
+
+// Combines `init` and the elements of `range` with `op`, in any order and grouping, so `op` must
+// be associative and commutative.
+// The effect refers to `range` and `op`, so it must be performed in the full-expression that
+// creates it.
+template<std::copyable T>
+class parallel_reduce {
+public:
+    using return_type = T;
+
+    template<typename Op>
+        requires std::convertible_to<std::invoke_result_t<Op const&, T, T const&>, T>
+    parallel_reduce(std::span<T const> range, T init, Op const& op) noexcept(
+        std::is_nothrow_move_constructible_v<T>)
+        : range_{range}, init_{std::move(init)}, op_{std::addressof(op)}, reduce_{&reduce<Op>} {}
+
+    [[nodiscard]]
+    auto range() const noexcept -> std::span<T const> {
+        return range_;
+    }
+
+    [[nodiscard]]
+    auto init() const -> T const& {
+        return init_;
+    }
+
+    // Combines a non-empty chunk of the range, starting with `acc` if there is one.
+    [[nodiscard]]
+    auto operator()(std::optional<T> acc, std::span<T const> chunk) const -> T {
+        return reduce_(op_, std::move(acc), chunk);
+    }
+
+private:
+    template<typename Op>
+    static auto reduce(void const* op, std::optional<T> acc, std::span<T const> chunk) -> T {
+        auto const& f = *static_cast<Op const*>(op);
+        auto x = acc ? std::move(*acc) : chunk.front();
+        for (auto i = acc ? std::size_t{} : std::size_t{1}; i < chunk.size(); ++i) {
+            x = std::invoke(f, std::move(x), chunk[i]);
+        }
+        return x;
+    }
+
+    std::span<T const> range_;
+    T init_;
+    void const* op_;
+    auto (*reduce_)(void const* op, std::optional<T> acc, std::span<T const> chunk) -> T;
+};
+
+namespace detail {
+
+class parallel_state;
+
+} // namespace detail
+
+// A fork-join pool that runs chunks of an index range on its workers and the calling thread.
+// Ranges are split lazily: a thread running a range splits it in half only when its own deque is
+// empty, so that idle threads find something to steal. Otherwise it runs the next small chunk
+// without splitting. The split count adapts to load, without tuning the chunk size.
+class parallel_pool {
+public:
+    // Calls `fn(ctx, participant, first, last)` for a chunk. `participant` is below `threads()`
+    // and is never used by two threads at once.
+    using chunk_fn = auto (*)(void* ctx, std::size_t participant, std::size_t first,
+                              std::size_t last) -> void;
+
+    // Uses `threads - 1` workers besides the calling thread.
+    COROFX_PUBLIC explicit parallel_pool(std::size_t threads = std::thread::hardware_concurrency());
+    COROFX_PUBLIC ~parallel_pool();
+
+    parallel_pool(parallel_pool const&) = delete;
+    parallel_pool(parallel_pool&&) = delete;
+    auto operator=(parallel_pool const&) -> parallel_pool& = delete;
+    auto operator=(parallel_pool&&) -> parallel_pool& = delete;
+
+    // Runs chunks covering `[first, last)` and returns once all of them have run.
+    // The calling thread runs chunks too. Concurrent calls take turns.
+    COROFX_PUBLIC auto run(std::size_t first, std::size_t last, chunk_fn fn, void* ctx) -> void;
+
+    [[nodiscard]]
+    COROFX_PUBLIC auto threads() const noexcept -> std::size_t;
+
+private:
+    std::unique_ptr<detail::parallel_state> state_;
+};
+
+// Handles a data-parallel effect on a `parallel_pool`.
+// The task resumes once every chunk has run. Until then, the thread that performed the effect
+// runs chunks itself.
+template<effect E>
+class parallel_handler;
+
+// Handles a data-parallel effect on the calling thread.
+template<effect E>
+class sequential_handler;
+
+template<>
+class parallel_handler<parallel_for> : public tail_handler_entry<parallel_for> {
+public:
+    explicit parallel_handler(parallel_pool& pool) noexcept : pool_{&pool} {}
+
+    [[nodiscard]]
+    auto handle_tail(parallel_for&& eff) noexcept -> value_holder<void> final {
+        pool_->run(eff.first(), eff.last(), &run_chunk, &eff);
+        return {};
+    }
+
+private:
+    static auto run_chunk(void* ctx, std::size_t, std::size_t first, std::size_t last) -> void {
+        (*static_cast<parallel_for const*>(ctx))(first, last);
+    }
+
+    parallel_pool* pool_;
+};
+
+template<std::copyable T>
+class parallel_handler<parallel_reduce<T>> : public tail_handler_entry<parallel_reduce<T>> {
+public:
+    explicit parallel_handler(parallel_pool& pool) noexcept : pool_{&pool} {}
+
+    [[nodiscard]]
+    auto handle_tail(parallel_reduce<T>&& eff) noexcept -> T final {
+        auto partials = std::vector<partial>(pool_->threads());
+        auto ctx = context{.eff = &eff, .partials = partials.data()};
+        pool_->run(0, eff.range().size(), &reduce_chunk, &ctx);
+        auto result = std::optional<T>{eff.init()};
+        for (auto& p : partials) {
+            if (p.value) result = eff(std::move(result), std::span{&*p.value, 1});
+        }
+        return std::move(*result);
+    }
+
+private:
+    // Padded so that threads do not share cache lines.
+    struct alignas(64) partial {
+        std::optional<T> value;
+    };
+
+    struct context {
+        parallel_reduce<T> const* eff;
+        partial* partials;
+    };
+
+    static auto reduce_chunk(void* ctx, std::size_t participant, std::size_t first,
+                             std::size_t last) -> void {
+        auto& c = *static_cast<context*>(ctx);
+        auto& acc = c.partials[participant].value;
+        acc = (*c.eff)(std::move(acc), c.eff->range().subspan(first, last - first));
+    }
+
+    parallel_pool* pool_;
+};
+
+template<>
+class sequential_handler<parallel_for> : public tail_handler_entry<parallel_for> {
+public:
+    sequential_handler() noexcept = default;
+
+    [[nodiscard]]
+    auto handle_tail(parallel_for&& eff) noexcept -> value_holder<void> final {
+        eff(eff.first(), eff.last());
+        return {};
+    }
+};
+
+template<std::copyable T>
+class sequential_handler<parallel_reduce<T>> : public tail_handler_entry<parallel_reduce<T>> {
+public:
+    sequential_handler() noexcept = default;
+
+    [[nodiscard]]
+    auto handle_tail(parallel_reduce<T>&& eff) noexcept -> T final {
+        return eff(eff.init(), eff.range());
+    }
+};
+
+// Creates a handler entry that runs `E` on `pool`.
+template<effect E>
+[[nodiscard]]
+auto parallel_handler_of(parallel_pool& pool) noexcept -> parallel_handler<E> {
+    return parallel_handler<E>{pool};
+}
+
+// Creates a handler entry that runs `E` on the calling thread, for tests and single-core
+// deployments.
+template<effect E>
+[[nodiscard]]
+auto sequential_handler_of() noexcept -> sequential_handler<E> {
+    return sequential_handler<E>{};
+}
+
+} // namespace corofx
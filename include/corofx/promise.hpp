@@ -2,9 +2,14 @@
 
 #include "check.hpp"
 #include "effect.hpp"
+#include "frame_resource.hpp"
+#include "tracing.hpp"
 
 #include <concepts>
 #include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <utility>
 
@@ -18,11 +23,32 @@ public:
         [[nodiscard]]
         auto await_suspend(std::coroutine_handle<U> frame) const noexcept
             -> std::coroutine_handle<> {
+            tracing::detail::record(tracing::event_kind::task_complete, frame.address());
             if (auto k = frame.promise().cont_) return k;
             return std::noop_coroutine();
         }
     };
 
+    // Frames come from the resource of the current `frame_resource_scope`, if any.
+    [[nodiscard]]
+    static auto operator new(std::size_t size) -> void* {
+        return detail::allocate_frame(size, detail::current_frame_resource());
+    }
+
+    // Coroutines taking a leading `std::allocator_arg_t, Alloc` pair allocate their frame from
+    // the memory resource of `Alloc`, such as a `std::pmr::memory_resource*`.
+    template<typename Alloc, typename... Args>
+        requires std::convertible_to<Alloc const&, std::pmr::polymorphic_allocator<>>
+    [[nodiscard]]
+    static auto operator new(
+        std::size_t size, std::allocator_arg_t, Alloc const& alloc, Args const&...) -> void* {
+        return detail::allocate_frame(size, std::pmr::polymorphic_allocator<>{alloc}.resource());
+    }
+
+    static auto operator delete(void* ptr, std::size_t size) noexcept -> void {
+        detail::deallocate_frame(ptr, size);
+    }
+
     promise_base(promise_base const&) = delete;
     promise_base(promise_base&&) = delete;
     auto operator=(promise_base const&) -> promise_base& = delete;
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "config.hpp"
+#include "detail/type_set.hpp"
+#include "effect.hpp"
+#include "frame.hpp"
+#include "handler.hpp"
+#include "task.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace corofx {
+
+namespace detail {
+
+class job;
+class reactor_state;
+class scheduler_state;
+
+// Installs evidence and an output slot on a type-erased task frame.
+// Returns false if `ev` does not handle every effect of the task.
+using bind_fn = auto (*)(std::coroutine_handle<> frame, evidence const* ev, void* output) noexcept
+    -> bool;
+
+template<typename T, effect... Es>
+auto bind_task(std::coroutine_handle<> frame, evidence const* ev, void* output) noexcept -> bool {
+    using task_type = task<T, Es...>;
+    auto& promise = task_type::handle_type::from_address(frame.address()).promise();
+    promise.set_evidence(ev);
+    promise.set_output(*static_cast<std::optional<value_holder<T>>*>(output));
+    return ((ev->template find<Es>() != nullptr) and ...);
+}
+
+} // namespace detail
+
+// Effects that spawned tasks may perform.
+// An executor handling `spawn` checks that it also handles every effect of the spawned task.
+template<typename E>
+inline constexpr bool spawnable = false;
+
+// A shared reference to a spawned task.
+class job_handle {
+public:
+    job_handle() noexcept = default;
+    COROFX_PUBLIC job_handle(job_handle const& that) noexcept;
+    job_handle(job_handle&& that) noexcept : job_{std::exchange(that.job_, nullptr)} {}
+    COROFX_PUBLIC ~job_handle();
+
+    auto operator=(job_handle that) noexcept -> job_handle& {
+        std::swap(job_, that.job_);
+        return *this;
+    }
+
+    // Checks if the task has run to completion.
+    [[nodiscard]]
+    COROFX_PUBLIC auto done() const noexcept -> bool;
+
+private:
+    friend class detail::reactor_state;
+    friend class detail::scheduler_state;
+
+    explicit job_handle(detail::job* j) noexcept : job_{j} {}
+
+    detail::job* job_{};
+};
+
+// Gives up the current worker so that other ready tasks can run.
+struct COROFX_PUBLIC yield_thread {
+    using return_type = void;
+};
+
+// Suspends until a spawned task completes.
+struct COROFX_PUBLIC join {
+    using return_type = void;
+
+    explicit join(job_handle j) noexcept : job{std::move(j)} {}
+
+    job_handle job;
+};
+
+// Schedules a task to run concurrently with the caller.
+// Results are passed through captures.
+struct COROFX_PUBLIC spawn {
+    using return_type = job_handle;
+
+    template<effect... Es>
+        requires(spawnable<Es> and ...)
+    explicit spawn(task<void, Es...> t) noexcept
+        : frame_{std::move(t)}, bind_{&detail::bind_task<void, Es...>} {}
+
+private:
+    friend class detail::reactor_state;
+    friend class detail::scheduler_state;
+
+    frame<> frame_;
+    detail::bind_fn bind_{};
+};
+
+// Resumes a task parked by `suspend`.
+// Each waker must be woken exactly once, from any thread.
+class waker {
+public:
+    waker() noexcept = default;
+
+    COROFX_PUBLIC auto wake() const noexcept -> void;
+
+private:
+    friend class detail::reactor_state;
+    friend class detail::scheduler_state;
+
+    explicit waker(detail::job* j) noexcept : job_{j} {}
+
+    detail::job* job_{};
+};
+
+// Parks the current task until it is woken.
+// `fn(w, arg)` is called once the task has fully suspended, so it may hand `w` to other threads
+// or wake it right away.
+struct COROFX_PUBLIC suspend {
+    using return_type = void;
+    using callback = auto (*)(waker w, void* arg) noexcept -> void;
+
+    callback fn{};
+    void* arg{};
+};
+
+template<>
+inline constexpr bool spawnable<spawn> = true;
+
+template<>
+inline constexpr bool spawnable<yield_thread> = true;
+
+template<>
+inline constexpr bool spawnable<join> = true;
+
+template<>
+inline constexpr bool spawnable<suspend> = true;
+
+// A work-stealing thread pool handling `spawn`, `yield_thread`, `join` and `suspend`.
+//
+// Each worker owns a bounded deque of ready tasks and steals from a random victim when it runs
+// dry. Tasks are resumed on whichever worker picks them up.
+class scheduler {
+public:
+    using effect_types = detail::type_set<spawn, yield_thread, join, suspend>;
+
+    COROFX_PUBLIC explicit scheduler(std::size_t threads = std::thread::hardware_concurrency());
+    COROFX_PUBLIC ~scheduler();
+
+    scheduler(scheduler const&) = delete;
+    scheduler(scheduler&&) = delete;
+    auto operator=(scheduler const&) -> scheduler& = delete;
+    auto operator=(scheduler&&) -> scheduler& = delete;
+
+    // Runs a task on the pool, waits for it and every task it spawned, and returns its result.
+    template<typename T, effect... Es>
+        requires(effect_types::template contains<detail::type_set<Es...>>)
+    [[nodiscard]]
+    auto run(task<T, Es...> t) -> T {
+        auto output = std::optional<value_holder<T>>{};
+        run_root(std::move(t), &detail::bind_task<T, Es...>, &output);
+        if constexpr (not std::is_void_v<T>) return std::move(*output);
+    }
+
+    [[nodiscard]]
+    COROFX_PUBLIC auto threads() const noexcept -> std::size_t;
+
+private:
+    COROFX_PUBLIC auto run_root(frame<> root, detail::bind_fn bind, void* output) -> void;
+
+    std::unique_ptr<detail::scheduler_state> state_;
+};
+
+} // namespace corofx
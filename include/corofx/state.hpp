@@ -0,0 +1,123 @@
+#pragma once
+
+#include "effect.hpp"
+#include "handler.hpp"
+
+#include <concepts>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace corofx {
+
+// Reads or replaces a value of type `T` held by the handler.
+// `get` copies the value, so a move-only `T` can only be replaced.
+template<std::movable T>
+class state {
+public:
+    using return_type = T;
+
+    // Returns the current value.
+    [[nodiscard]]
+    static auto get() noexcept -> state
+        requires std::copyable<T>
+    {
+        return state{};
+    }
+
+    // Replaces the value and returns the previous one.
+    [[nodiscard]]
+    static auto put(T value) noexcept(std::is_nothrow_move_constructible_v<T>) -> state {
+        return state{std::move(value)};
+    }
+
+private:
+    template<effect>
+    friend class handler;
+
+    state() noexcept = default;
+    explicit state(T value) noexcept(std::is_nothrow_move_constructible_v<T>)
+        : value_{std::move(value)} {}
+
+    std::optional<T> value_;
+};
+
+// Reads a value of type `T` held by the handler.
+template<std::copyable T>
+class reader {
+public:
+    using return_type = T;
+
+    [[nodiscard]]
+    static auto ask() noexcept -> reader {
+        return reader{};
+    }
+
+private:
+    reader() noexcept = default;
+};
+
+// The handler of `state<T>`, which is also its handler entry.
+// The value is stored in the handler, which evidence points to, so `get` and `put` run inline as a
+// non-virtual call without suspending the task. No other handler type can handle `state<T>`.
+template<std::movable T>
+class handler<state<T>> : public detail::inline_entry<state<T>> {
+public:
+    explicit handler(T initial) noexcept(std::is_nothrow_move_constructible_v<T>)
+        : value_{std::move(initial)} {}
+
+    [[nodiscard]]
+    constexpr auto tail_resumptive() const noexcept -> bool {
+        return true;
+    }
+
+    [[nodiscard]]
+    auto handle_tail(state<T>&& eff) noexcept -> T {
+        if constexpr (std::copyable<T>) {
+            if (not eff.value_) return value_;
+        }
+        return std::exchange(value_, std::move(*eff.value_));
+    }
+
+private:
+    T value_;
+};
+
+// The handler of `reader<T>`, which is also its handler entry.
+template<std::copyable T>
+class handler<reader<T>> : public detail::inline_entry<reader<T>> {
+public:
+    explicit handler(T value) noexcept(std::is_nothrow_move_constructible_v<T>)
+        : value_{std::move(value)} {}
+
+    [[nodiscard]]
+    constexpr auto tail_resumptive() const noexcept -> bool {
+        return true;
+    }
+
+    [[nodiscard]]
+    auto handle_tail(reader<T>&&) noexcept -> T {
+        return value_;
+    }
+
+private:
+    T value_;
+};
+
+// Creates a handler entry for `state<T>` holding `initial`.
+template<std::movable T>
+[[nodiscard]]
+auto state_handler_of(T initial) noexcept(std::is_nothrow_move_constructible_v<T>)
+    -> handler<state<T>> {
+    return handler<state<T>>{std::move(initial)};
+}
+
+// Creates a handler entry for `reader<T>` holding `value`.
+template<std::copyable T>
+[[nodiscard]]
+auto reader_handler_of(T value) noexcept(std::is_nothrow_move_constructible_v<T>)
+    -> handler<reader<T>> {
+    return handler<reader<T>>{std::move(value)};
+}
+
+} // namespace corofx
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "check.hpp"
+#include "effect.hpp"
+#include "handler.hpp"
+#include "task.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace corofx {
+
+// Passes an element to the consumer of a stream, which returns whether to produce more.
+template<std::movable T>
+struct emit {
+    using return_type = bool;
+
+    explicit emit(T value) noexcept(std::is_nothrow_move_constructible_v<T>)
+        : value{std::move(value)} {}
+
+    T value;
+};
+
+namespace detail {
+
+template<typename F>
+struct map_stage {
+    template<typename In>
+    using output_type = std::decay_t<std::invoke_result_t<F&, In&&>>;
+
+    template<typename V, typename Next>
+    auto push(V&& value, Next next) -> bool {
+        return next(std::invoke(fn, std::forward<V>(value)));
+    }
+
+    template<typename Next>
+    auto finish(Next) -> void {}
+
+    F fn;
+};
+
+template<typename P>
+struct filter_stage {
+    template<typename In>
+    using output_type = In;
+
+    template<typename V, typename Next>
+    auto push(V&& value, Next next) -> bool {
+        if (not std::invoke(pred, std::as_const(value))) return true;
+        return next(std::forward<V>(value));
+    }
+
+    template<typename Next>
+    auto finish(Next) -> void {}
+
+    P pred;
+};
+
+struct take_stage {
+    template<typename In>
+    using output_type = In;
+
+    template<typename V, typename Next>
+    auto push(V&& value, Next next) -> bool {
+        if (left == 0) return false;
+        --left;
+        return next(std::forward<V>(value)) and left > 0;
+    }
+
+    template<typename Next>
+    auto finish(Next) -> void {}
+
+    std::size_t left;
+};
+
+template<typename T>
+struct chunk_stage {
+    template<typename In>
+    using output_type = std::vector<T>;
+
+    template<typename V, typename Next>
+    auto push(V&& value, Next next) -> bool {
+        if (buffer.empty()) buffer.reserve(size);
+        buffer.push_back(std::forward<V>(value));
+        if (buffer.size() < size) return true;
+        return next(std::exchange(buffer, {}));
+    }
+
+    // Passes on the last chunk, which may be short.
+    template<typename Next>
+    auto finish(Next next) -> void {
+        if (not buffer.empty()) next(std::exchange(buffer, {}));
+    }
+
+    std::size_t size;
+    std::vector<T> buffer;
+};
+
+template<typename In, typename Stages>
+struct stages_output;
+
+template<typename In>
+struct stages_output<In, std::tuple<>> {
+    using type = In;
+};
+
+template<typename In, typename S, typename... Ss>
+struct stages_output<In, std::tuple<S, Ss...>> {
+    using type =
+        typename stages_output<typename S::template output_type<In>, std::tuple<Ss...>>::type;
+};
+
+// Passes elements into stage `I` of a pipeline, or into the sink past the last stage.
+// Each stage calls the next one through a cursor, so the whole pipeline inlines into one function.
+template<std::size_t I, typename Stages, typename Sink>
+struct stage_cursor {
+    template<typename V>
+    auto operator()(V&& value) const -> bool {
+        if constexpr (I == std::tuple_size_v<Stages>) {
+            return (*sink)(std::forward<V>(value));
+        } else {
+            return std::get<I>(*stages).push(std::forward<V>(value), next());
+        }
+    }
+
+    // Flushes the stages from `I` on, in order.
+    auto finish() const -> void {
+        if constexpr (I < std::tuple_size_v<Stages>) {
+            std::get<I>(*stages).finish(next());
+            next().finish();
+        }
+    }
+
+    [[nodiscard]]
+    auto next() const noexcept -> stage_cursor<I + 1, Stages, Sink> {
+        return {stages, sink};
+    }
+
+    Stages* stages;
+    Sink* sink;
+};
+
+template<typename Acc, typename F>
+struct fold_sink {
+    template<typename V>
+    auto operator()(V&& value) -> bool {
+        acc = std::invoke(fn, std::move(acc), std::forward<V>(value));
+        return true;
+    }
+
+    Acc acc;
+    F fn;
+};
+
+// Runs the source under one tail-resumptive handler for the whole pipeline, so each element
+// costs one effect that is handled inline, however many stages there are.
+template<typename T, typename Stages, typename Acc, typename F, effect... Es>
+auto fold_stream(task<void, emit<T>, Es...> source, Stages stages, Acc init, F fn)
+    -> task<Acc, Es...> {
+    auto sink = fold_sink<Acc, F>{std::move(init), std::move(fn)};
+    auto head = stage_cursor<0, Stages, fold_sink<Acc, F>>{&stages, &sink};
+    co_await std::move(source).with(
+        tail_handler_of<emit<T>>([head](emit<T>&& e) { return head(std::move(e.value)); }));
+    head.finish();
+    co_return std::move(sink.acc);
+}
+
+} // namespace detail
+
+// A lazy pipeline over the elements that a task passes with `emit<T>`.
+//
+// Combinators only record their stages in the type of the stream. `fold` runs the source with a
+// single handler into which every stage is fused at compile time, so a pipeline costs one inline
+// effect per source element rather than a handler frame and two transfers per stage. Returning
+// `false` from `emit` asks the source to stop, which it should honor.
+template<std::movable T, typename Stages, effect... Es>
+class basic_stream {
+public:
+    using source_type = task<void, emit<T>, Es...>;
+    using value_type = typename detail::stages_output<T, Stages>::type;
+
+    explicit basic_stream(source_type source) noexcept
+        requires(std::tuple_size_v<Stages> == 0)
+        : source_{std::move(source)} {}
+
+    basic_stream(source_type source, Stages stages) noexcept
+        : source_{std::move(source)}, stages_{std::move(stages)} {}
+
+    // Transforms each element with `fn`.
+    template<typename F>
+    [[nodiscard]]
+    auto map(F fn) && {
+        return std::move(*this).then(detail::map_stage<F>{std::move(fn)});
+    }
+
+    // Keeps the elements for which `pred` returns true.
+    template<typename P>
+    [[nodiscard]]
+    auto filter(P pred) && {
+        return std::move(*this).then(detail::filter_stage<P>{std::move(pred)});
+    }
+
+    // Keeps the first `n` elements, then stops the source.
+    [[nodiscard]]
+    auto take(std::size_t n) && {
+        return std::move(*this).then(detail::take_stage{n});
+    }
+
+    // Groups elements into vectors of `n`, the last of which may be shorter.
+    [[nodiscard]]
+    auto chunk(std::size_t n) && {
+        check(n > 0);
+        return std::move(*this).then(detail::chunk_stage<value_type>{n, {}});
+    }
+
+    // Runs the pipeline, combining each element into `init` with `fn(acc, element)`.
+    template<typename Acc, typename F>
+    [[nodiscard]]
+    auto fold(Acc init, F fn) && -> task<Acc, Es...> {
+        return detail::fold_stream(
+            std::move(source_), std::move(stages_), std::move(init), std::move(fn));
+    }
+
+private:
+    template<typename S>
+    auto then(S stage) && {
+        auto stages = std::tuple_cat(std::move(stages_), std::tuple{std::move(stage)});
+        return basic_stream<T, decltype(stages), Es...>{std::move(source_), std::move(stages)};
+    }
+
+    source_type source_;
+    Stages stages_;
+};
+
+// A stream over the elements of a task performing `emit<T>` and `Es...`.
+template<std::movable T, effect... Es>
+using stream = basic_stream<T, std::tuple<>, Es...>;
+
+} // namespace corofx
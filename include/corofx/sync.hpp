@@ -0,0 +1,325 @@
+#pragma once
+
+#include "config.hpp"
+#include "detail/type_set.hpp"
+#include "effect.hpp"
+#include "frame.hpp"
+#include "frame_resource.hpp"
+#include "handler.hpp"
+#include "scheduler.hpp"
+#include "task.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <variant>
+
+namespace corofx {
+
+namespace detail {
+
+// A task parked on a synchronization primitive, linked into its waiter list.
+struct sync_waiter {
+    explicit sync_waiter(void* target) noexcept : target{target} {}
+
+    void* target;
+    sync_waiter* next{};
+    waker w;
+};
+
+// How a task that cannot go on right away parks on a primitive, through `suspend`.
+struct sync_parker {
+    suspend::callback park;
+    void* target;
+};
+
+// Permits, handed over in FIFO order to the tasks waiting for them.
+//
+// The state is either a count of permits, tagged in the low bit, or, when none are left, the stack
+// of tasks that started waiting since it was last taken. Waiters push themselves with a CAS.
+// Releases are combined: the one that finds none in progress returns a permit at a time, taking
+// the stack into a FIFO list when it has no waiter left, and hands the permit to the oldest
+// waiter instead of returning it if there is one. No thread ever waits for another.
+class sync_queue {
+public:
+    explicit sync_queue(std::size_t permits) noexcept : state_{tag(permits)} {}
+
+    [[nodiscard]]
+    auto try_acquire() noexcept -> bool {
+        auto s = state_.load(std::memory_order_relaxed);
+        while (s & 1 and s != tag(0)) {
+            if (state_.compare_exchange_weak(
+                    s, s - 2, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto release(std::size_t n) noexcept -> void {
+        if (pending_.fetch_add(n, std::memory_order_acq_rel) != 0) return;
+        do {
+            release_one();
+        } while (pending_.fetch_sub(1, std::memory_order_acq_rel) != 1);
+    }
+
+    // Returns a permit when no other release can run at the same time, as for a mutex, whose
+    // holders are ordered by the mutex itself.
+    auto release_exclusive() noexcept -> void { release_one(); }
+
+    // Takes a permit, or waits for one. Used as a `suspend` callback on a `sync_waiter`.
+    COROFX_PUBLIC static auto park(waker w, void* waiter) noexcept -> void;
+
+private:
+    static constexpr auto tag(std::size_t permits) noexcept -> std::uintptr_t {
+        return (permits << 1) | 1;
+    }
+
+    COROFX_PUBLIC auto release_one() noexcept -> void;
+
+    std::atomic<std::uintptr_t> state_;
+    std::atomic<std::size_t> pending_{};
+    // Owned by the release in progress.
+    sync_waiter* fifo_{};
+};
+
+// The waiters of a latch, released all at once.
+class latch_state {
+public:
+    explicit latch_state(std::ptrdiff_t count) noexcept : count_{count} {}
+
+    [[nodiscard]]
+    auto try_wait() const noexcept -> bool {
+        return count_.load(std::memory_order_acquire) <= 0;
+    }
+
+    auto count_down(std::ptrdiff_t n) noexcept -> void {
+        if (count_.fetch_sub(n, std::memory_order_acq_rel) == n) release_all();
+    }
+
+    // Waits until the count reaches zero. Used as a `suspend` callback on a `sync_waiter`.
+    COROFX_PUBLIC static auto park(waker w, void* waiter) noexcept -> void;
+
+private:
+    static constexpr auto released = std::uintptr_t{1};
+
+    COROFX_PUBLIC auto release_all() noexcept -> void;
+
+    std::atomic<std::ptrdiff_t> count_;
+    // A stack of waiters, or `released`.
+    std::atomic<std::uintptr_t> waiters_{};
+};
+
+} // namespace detail
+
+// Non-blocking synchronization for tasks that share state across threads.
+// A task that cannot go on parks through `suspend` instead of blocking its thread, so these can be
+// held across `co_await`, and is resumed by the executor once it can.
+
+// A mutex that hands itself over to waiting tasks in the order they started waiting.
+class async_mutex {
+public:
+    async_mutex() noexcept = default;
+
+    async_mutex(async_mutex const&) = delete;
+    async_mutex(async_mutex&&) = delete;
+    ~async_mutex() = default;
+    auto operator=(async_mutex const&) -> async_mutex& = delete;
+    auto operator=(async_mutex&&) -> async_mutex& = delete;
+
+    [[nodiscard]]
+    auto try_lock() noexcept -> bool {
+        return queue_.try_acquire();
+    }
+
+    // Wakes the oldest waiting task, which then holds the mutex, or unlocks it.
+    auto unlock() noexcept -> void { queue_.release_exclusive(); }
+
+private:
+    friend class lock;
+
+    detail::sync_queue queue_{1};
+};
+
+// A counting semaphore that hands permits over to waiting tasks in the order they started waiting.
+class async_semaphore {
+public:
+    explicit async_semaphore(std::size_t permits) noexcept : queue_{permits} {}
+
+    async_semaphore(async_semaphore const&) = delete;
+    async_semaphore(async_semaphore&&) = delete;
+    ~async_semaphore() = default;
+    auto operator=(async_semaphore const&) -> async_semaphore& = delete;
+    auto operator=(async_semaphore&&) -> async_semaphore& = delete;
+
+    [[nodiscard]]
+    auto try_acquire() noexcept -> bool {
+        return queue_.try_acquire();
+    }
+
+    auto release(std::size_t n = 1) noexcept -> void { queue_.release(n); }
+
+private:
+    friend class acquire;
+
+    detail::sync_queue queue_;
+};
+
+// A single-use barrier that releases every waiting task once counted down to zero.
+class async_latch {
+public:
+    explicit async_latch(std::ptrdiff_t count) noexcept : state_{count} {}
+
+    async_latch(async_latch const&) = delete;
+    async_latch(async_latch&&) = delete;
+    ~async_latch() = default;
+    auto operator=(async_latch const&) -> async_latch& = delete;
+    auto operator=(async_latch&&) -> async_latch& = delete;
+
+    auto count_down(std::ptrdiff_t n = 1) noexcept -> void { state_.count_down(n); }
+
+    [[nodiscard]]
+    auto try_wait() const noexcept -> bool {
+        return state_.try_wait();
+    }
+
+private:
+    friend class wait_latch;
+
+    detail::latch_state state_;
+};
+
+// Locks a mutex, waiting while another task holds it.
+class lock {
+public:
+    using return_type = void;
+
+    explicit lock(async_mutex& m) noexcept : mutex_{&m} {}
+
+    [[nodiscard]]
+    auto try_now() const noexcept -> bool {
+        return mutex_->try_lock();
+    }
+
+    [[nodiscard]]
+    auto parker() const noexcept -> detail::sync_parker {
+        return {&detail::sync_queue::park, &mutex_->queue_};
+    }
+
+private:
+    async_mutex* mutex_;
+};
+
+// Takes a permit from a semaphore, waiting while there is none.
+class acquire {
+public:
+    using return_type = void;
+
+    explicit acquire(async_semaphore& s) noexcept : semaphore_{&s} {}
+
+    [[nodiscard]]
+    auto try_now() const noexcept -> bool {
+        return semaphore_->try_acquire();
+    }
+
+    [[nodiscard]]
+    auto parker() const noexcept -> detail::sync_parker {
+        return {&detail::sync_queue::park, &semaphore_->queue_};
+    }
+
+private:
+    async_semaphore* semaphore_;
+};
+
+// Waits until a latch is counted down to zero.
+class wait_latch {
+public:
+    using return_type = void;
+
+    explicit wait_latch(async_latch& l) noexcept : latch_{&l} {}
+
+    [[nodiscard]]
+    auto try_now() const noexcept -> bool {
+        return latch_->try_wait();
+    }
+
+    [[nodiscard]]
+    auto parker() const noexcept -> detail::sync_parker {
+        return {&detail::latch_state::park, &latch_->state_};
+    }
+
+private:
+    async_latch* latch_;
+};
+
+namespace detail {
+
+// Parks until the primitive lets the task go on, then resumes the producer.
+template<effect E>
+auto wait_on(sync_parker p, resumer<E>& resume) -> task<void, suspend> {
+    auto waiter = sync_waiter{p.target};
+    co_await suspend{p.park, &waiter};
+    co_return resume();
+}
+
+} // namespace detail
+
+// A handler entry for `lock`, `acquire` or `wait_latch`.
+// When the task can go on right away, it is never suspended. Otherwise a handler task parks it
+// with `suspend`, so the handled task runs on an executor such as `scheduler` or `reactor`.
+template<effect E>
+class sync_handler : public handler<E> {
+public:
+    using effect_type = E;
+    using effect_types = detail::type_set<suspend>;
+
+    static constexpr bool tail_resumptive = false;
+    static constexpr bool checks_ready = true;
+
+    sync_handler() noexcept
+        : handler<E>{false, checks_ready}, resource_{detail::current_frame_resource()} {}
+
+    [[nodiscard]]
+    auto try_ready(E& eff) noexcept -> std::optional<std::monostate> final {
+        if (eff.try_now()) return std::monostate{};
+        return std::nullopt;
+    }
+
+    // Tries again, for wrappers that forward to `handle` only.
+    [[nodiscard]]
+    auto handle(E&& eff, resumer<E>& resume, frame<>& storage) noexcept
+        -> std::coroutine_handle<> final {
+        if (eff.try_now()) return resume.set_value();
+        using task_type = task<void, suspend>;
+        auto resource = frame_resource_scope{resource_};
+        storage = detail::wait_on(eff.parker(), resume);
+        auto h = task_type::handle_type::from_address((*storage).address());
+        h.promise().set_evidence(evidence_);
+        return h;
+    }
+
+    // Handler tasks run with the evidence in scope outside of the handler.
+    auto set_evidence(evidence const* ev) noexcept -> void { evidence_ = ev; }
+
+    // Every effect resumes its producer, so the handled task never completes through the handler.
+    auto set_cont(std::coroutine_handle<>) noexcept -> void {}
+
+    template<typename Output>
+    auto set_output(Output&) noexcept -> void {}
+
+private:
+    std::pmr::memory_resource* resource_;
+    evidence const* evidence_{};
+};
+
+// Creates a handler entry for `lock`, `acquire` or `wait_latch`.
+template<effect E>
+[[nodiscard]]
+auto sync_handler_of() noexcept -> sync_handler<E> {
+    return sync_handler<E>{};
+}
+
+} // namespace corofx
@@ -4,9 +4,16 @@
 #include "detail/type_set.hpp"
 #include "effect.hpp"
 #include "handler.hpp"
+#include "instrument.hpp"
 #include "promise.hpp"
+#include "tracing.hpp"
 
+#include <array>
+#include <concepts>
 #include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <tuple>
 #include <type_traits>
@@ -17,13 +24,32 @@ namespace corofx {
 template<typename Task>
 class task_awaiter;
 
+template<typename T, effect... Es>
+class generator;
+
+// Returns a value from `co_await` without suspending.
+template<typename T>
+class ready_awaiter : public std::suspend_never {
+public:
+    explicit ready_awaiter(T value) noexcept : value_{std::move(value)} {}
+
+    [[nodiscard]]
+    auto await_resume() noexcept -> T {
+        return std::move(value_);
+    }
+
+private:
+    T value_;
+};
+
 template<typename Task, typename... Hs>
 class handled_task {
 public:
     using task_type = Task;
     using value_type = task_type::value_type;
     using effect_types = task_type::effect_types::template subtract<
-        typename Hs::effect_type...>::template add<typename Hs::task_type::effect_types...>;
+        typename Hs::effect_type...,
+        bound<Hs>...>::template add<typename Hs::effect_types...>;
 
     handled_task(Task task, Hs... handlers) noexcept
         : task_{std::move(task)}, handlers_{std::move(handlers)...} {
@@ -33,7 +59,7 @@ public:
     handled_task(handled_task const&) = delete;
 
     handled_task(handled_task&& that) noexcept
-        : task_{std::move(that.task_)}, handlers_{std::move(that.handlers_)} {
+        : task_{std::move(that.task_)}, handlers_{std::move(that.handlers_)}, outer_{that.outer_} {
         bind_handlers();
     }
 
@@ -62,6 +88,7 @@ public:
         using std::swap;
         swap(left.task_, right.task_);
         swap(left.handlers_, right.handlers_);
+        swap(left.outer_, right.outer_);
     }
 
 private:
@@ -69,18 +96,25 @@ private:
     friend class task;
     friend class task_awaiter<handled_task>;
 
+    // Links the evidence of each handler to the one installed before it, innermost last.
     auto bind_handlers() noexcept -> void {
+        auto ev = outer_;
         std::apply(
-            [&](auto&... hs) { (task_.frame_->promise().set_handler(&hs), ...); }, handlers_);
+            [&](auto&... hs) {
+                auto i = std::size_t{};
+                ((evidence_[i] =
+                      evidence{static_cast<handler<typename Hs::effect_type>*>(&hs), ev},
+                  ev = &evidence_[i++]),
+                 ...);
+            },
+            handlers_);
+        task_.frame_->promise().set_evidence(ev);
     }
 
-    template<typename Task2>
-    auto copy_handlers(Task2& t) noexcept -> void {
-        task_type::effect_types::template subtract<typename Hs::effect_type...>::apply(
-            [&]<effect... Es>() {
-                (task_.frame_->promise().set_handler(t.template get_handler<Es>()), ...);
-            });
-        std::apply([&](auto&... hs) { (hs.copy_handlers(t), ...); }, handlers_);
+    auto set_evidence(evidence const* outer) noexcept -> void {
+        outer_ = outer;
+        bind_handlers();
+        std::apply([=](auto&... hs) { (hs.set_evidence(outer), ...); }, handlers_);
     }
 
     auto set_cont(std::coroutine_handle<> cont) noexcept -> void {
@@ -100,6 +134,8 @@ private:
 
     task_type task_;
     std::tuple<Hs...> handlers_;
+    evidence const* outer_{};
+    std::array<evidence, sizeof...(Hs)> evidence_;
 };
 
 // Represents a unit of computation that is potentially effectful.
@@ -129,13 +165,19 @@ public:
     [[nodiscard]]
     auto with(Hs... handlers) && noexcept -> handled_task<task, Hs...>
         requires(
-            effect_types::template contains<detail::type_set<typename Hs::effect_type...>> and
-            (std::same_as<T, typename Hs::task_type::value_type> and ...))
+            ((effect_types::template contains<typename Hs::effect_type> or
+              effect_types::template contains<bound<Hs>>) and
+             ...) and
+            (handler_returning<Hs, T> and ...))
     {
         return handled_task{std::move(*this), std::move(handlers)...};
     }
 
 private:
+    template<typename, effect...>
+    friend class task;
+    template<typename, effect...>
+    friend class generator;
     template<effect, typename>
     friend class handler_impl;
     template<typename, typename...>
@@ -156,6 +198,7 @@ private:
     auto call_unchecked(std::optional<value_holder<T>>& output) noexcept -> void {
         check(not frame_->done());
         set_output(output);
+        tracing::detail::record(tracing::event_kind::task_resume, frame_->address());
         frame_->resume();
     }
 
@@ -179,6 +222,7 @@ public:
     auto await_suspend(std::coroutine_handle<> frame) const noexcept -> std::coroutine_handle<> {
         auto h = task_.get_frame();
         h.promise().set_cont(frame);
+        tracing::detail::record(tracing::event_kind::task_resume, h.address());
         return h;
     }
 
@@ -194,59 +238,123 @@ private:
 
 template<typename T, effect... Es>
 class task<T, Es...>::promise_type : public promise_impl<T> {
+    template<typename S>
+    static constexpr bool handles_all = S::apply(
+        []<effect... Gs>() { return evidence_context<Es...>::template handles<Gs...>; });
+
 public:
+#ifdef COROFX_ENABLE_INSTRUMENTATION
+    [[nodiscard]]
+    static auto operator new(std::size_t size) -> void* {
+        return instrument::detail::allocate_frame<task>(
+            size, [](std::size_t n) { return promise_base::operator new(n); });
+    }
+
+    // Every overload adds the header that the instrumented `operator delete` removes.
+    template<typename Alloc, typename... Args>
+        requires std::convertible_to<Alloc const&, std::pmr::polymorphic_allocator<>>
+    [[nodiscard]]
+    static auto operator new(std::size_t size,
+                             std::allocator_arg_t tag,
+                             Alloc const& alloc,
+                             Args const&... args) -> void* {
+        return instrument::detail::allocate_frame<task>(size, [&](std::size_t n) {
+            return promise_base::operator new(n, tag, alloc, args...);
+        });
+    }
+
+    static auto operator delete(void* ptr, std::size_t size) noexcept -> void {
+        instrument::detail::deallocate_frame<task>(ptr, size, [](void* p, std::size_t n) {
+            promise_base::operator delete(p, n);
+        });
+    }
+#endif
+
     [[nodiscard]]
     auto get_return_object() noexcept -> task {
-        return task{handle_type::from_promise(*this)};
+        auto h = handle_type::from_promise(*this);
+        tracing::detail::record(
+            tracing::event_kind::task_create, h.address(), &tracing::detail::label_of<task>);
+        return task{h};
     }
 
     template<typename U, effect... Gs>
     [[nodiscard]]
     auto await_transform(task<U, Gs...> t) noexcept -> task_awaiter<decltype(t)>
-        requires(effect_types::template contains<typename decltype(t)::effect_types>)
+        requires(evidence_context<Es...>::template handles<Gs...>)
     {
-        auto& p = t.frame_->promise();
-        p.copy_handlers(*this);
+        t.frame_->promise().set_evidence(evidence_.get());
         return task_awaiter{std::move(t)};
     }
 
+    // Binds a generator to the handlers of this task.
+    template<typename U, effect... Gs>
+    [[nodiscard]]
+    auto await_transform(generator<U, Gs...> g) noexcept -> ready_awaiter<decltype(g)>
+        requires(evidence_context<Es...>::template handles<Gs...>)
+    {
+        g.set_evidence(evidence_.get());
+        return ready_awaiter{std::move(g)};
+    }
+
     template<typename Task, typename... Hs>
     [[nodiscard]]
     auto await_transform(handled_task<Task, Hs...> t) noexcept -> task_awaiter<decltype(t)>
-        requires(effect_types::template contains<typename decltype(t)::effect_types>)
+        requires(handles_all<typename decltype(t)::effect_types>)
     {
-        t.copy_handlers(*this);
+        t.set_evidence(evidence_.get());
         t.set_cont(handle_type::from_promise(*this));
         return task_awaiter{std::move(t)};
     }
 
+    // Lowers combinators such as `when_all` to a task according to the effects of this task.
+    template<typename A>
+        requires requires(A a) { std::move(a).template lower<detail::type_set<Es...>>(); }
+    [[nodiscard]]
+    auto await_transform(A a) noexcept {
+        return await_transform(std::move(a).template lower<detail::type_set<Es...>>());
+    }
+
+    // Effects are passed to their handler in place.
     template<effect E>
     [[nodiscard]]
-    auto await_transform(E eff) noexcept -> effect_awaiter<E>
-        requires(effect_types::template contains<E>)
+    auto await_transform(E&& eff) noexcept
+        -> effect_awaiter<E, detail::handler_type_t<evidence_context<Es...>, E>>
+        requires(evidence_context<Es...>::template handles<E>)
     {
-        return effect_awaiter<E>{
-            ev_vec_.template get_handler<E>(), handle_type::from_promise(*this), std::move(eff)};
+        tracing::detail::record(
+            tracing::event_kind::effect_perform,
+            handle_type::from_promise(*this).address(),
+            &tracing::detail::label_of<E>);
+        return effect_awaiter<E, detail::handler_type_t<evidence_context<Es...>, E>>{
+            get_handler<E>(), eff};
     }
 
+    // Effects performed through an lvalue are copied first.
     template<effect E>
-    auto set_handler(handler<E>* h) noexcept -> void {
-        ev_vec_.set_handler(h);
+    [[nodiscard]]
+    auto await_transform(E const& eff) noexcept
+        -> effect_copy_awaiter<E, detail::handler_type_t<evidence_context<Es...>, E>>
+        requires(evidence_context<Es...>::template handles<E>)
+    {
+        tracing::detail::record(
+            tracing::event_kind::effect_perform,
+            handle_type::from_promise(*this).address(),
+            &tracing::detail::label_of<E>);
+        return effect_copy_awaiter<E, detail::handler_type_t<evidence_context<Es...>, E>>{
+            get_handler<E>(), eff};
     }
 
     template<effect E>
     [[nodiscard]]
-    auto get_handler() const noexcept -> handler<E>* {
-        return ev_vec_.template get_handler<E>();
+    auto get_handler() const noexcept {
+        return evidence_.template get_handler<E>();
     }
 
-    template<typename Task>
-    auto copy_handlers(Task& t) noexcept -> void {
-        (set_handler(t.template get_handler<Es>()), ...);
-    }
+    auto set_evidence(evidence const* ev) noexcept -> void { evidence_.set(ev); }
 
 private:
-    evidence_vec<Es...> ev_vec_;
+    evidence_context<Es...> evidence_;
 };
 
 } // namespace corofx
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "config.hpp"
+#include "detail/timer_wheel.hpp"
+#include "scheduler.hpp"
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+
+namespace corofx {
+
+namespace detail {
+
+class reactor_state;
+
+// The timer of a sleeping task, embedded in the effect so that sleeping does not allocate.
+struct sleeper : timer_node {
+    std::chrono::steady_clock::time_point due;
+    void* owner{};
+    std::coroutine_handle<> resume;
+};
+
+} // namespace detail
+
+// Suspends the task for at least `duration`.
+struct COROFX_PUBLIC sleep_for {
+    using return_type = void;
+
+    explicit sleep_for(std::chrono::steady_clock::duration d) noexcept : duration{d} {}
+
+    std::chrono::steady_clock::duration duration;
+
+private:
+    friend class detail::reactor_state;
+
+    detail::sleeper sleeper_;
+};
+
+// Suspends the task until `deadline`.
+struct COROFX_PUBLIC sleep_until {
+    using return_type = void;
+
+    explicit sleep_until(std::chrono::steady_clock::time_point tp) noexcept : deadline{tp} {}
+
+    std::chrono::steady_clock::time_point deadline;
+
+private:
+    friend class detail::reactor_state;
+
+    detail::sleeper sleeper_;
+};
+
+template<>
+inline constexpr bool spawnable<sleep_for> = true;
+
+template<>
+inline constexpr bool spawnable<sleep_until> = true;
+
+// How late sleeping tasks were woken up.
+struct timer_stats {
+    std::size_t fired{};
+    std::chrono::nanoseconds total_slack{};
+    std::chrono::nanoseconds max_slack{};
+
+    [[nodiscard]]
+    auto mean_slack() const noexcept -> std::chrono::nanoseconds {
+        if (fired == 0) return {};
+        return total_slack / static_cast<std::chrono::nanoseconds::rep>(fired);
+    }
+};
+
+} // namespace corofx
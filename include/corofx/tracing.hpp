@@ -0,0 +1,162 @@
+#pragma once
+
+#include "config.hpp"
+#include "instrument.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Effect lifecycle tracing.
+// Events are recorded with `COROFX_ENABLE_TRACING` into a ring buffer per thread, which keeps the
+// most recent events. Otherwise nothing is recorded and the hooks compile to nothing.
+namespace corofx::tracing {
+
+enum class event_kind : std::uint8_t {
+    // A task frame was created.
+    task_create,
+    // A task started, or resumed after its handler resumed it.
+    task_resume,
+    // A task returned and is about to resume its continuation.
+    task_complete,
+    // A task performed an effect.
+    effect_perform,
+    // A handler started handling an effect.
+    handler_enter,
+    // A handler resumed, or prepared to resume, the task that performed an effect.
+    handler_resume,
+    // A coroutine frame was destroyed.
+    frame_destroy,
+};
+
+struct event {
+    // Nanoseconds since tracing started.
+    std::uint64_t time;
+    // The recording thread, numbered from 0 in the order threads recorded their first event.
+    std::uint32_t thread;
+    event_kind kind;
+    // The frame of the task the event is about, if known.
+    void const* frame;
+    // The task type for `task_create`, and the effect type for effect and handler events.
+    std::string_view name;
+};
+
+// Sets the number of events kept per thread, rounded up to a power of two.
+// Applies to threads that record their first event afterwards.
+COROFX_PUBLIC auto set_buffer_capacity(std::size_t events) noexcept -> void;
+
+// Returns the events of every thread in time order.
+// Events recorded concurrently with the snapshot may be missing.
+[[nodiscard]]
+COROFX_PUBLIC auto snapshot() -> std::vector<event>;
+
+// Writes the events of every thread to a binary file.
+// `tools/trace_to_json.py` converts it to the Chrome trace event format.
+[[nodiscard]]
+COROFX_PUBLIC auto dump(char const* path) -> bool;
+
+namespace detail {
+
+// Names a task or effect type in events.
+struct label {
+    std::string_view name;
+};
+
+template<typename T>
+inline constexpr auto label_of = label{instrument::detail::type_name<T>()};
+
+[[nodiscard]]
+inline auto now() noexcept -> std::uint64_t {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+    auto ticks = std::uint64_t{};
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+struct slot {
+    std::atomic<std::uint64_t> time;
+    std::atomic<void const*> frame;
+    std::atomic<label const*> name;
+    std::atomic<event_kind> kind;
+};
+
+// A single-producer ring buffer owned by one thread.
+// The oldest events are overwritten once it is full.
+class ring {
+public:
+    COROFX_PUBLIC ring(std::size_t capacity, std::uint32_t thread);
+
+    ring(ring const&) = delete;
+    ring(ring&&) = delete;
+    ~ring() = default;
+    auto operator=(ring const&) -> ring& = delete;
+    auto operator=(ring&&) -> ring& = delete;
+
+    auto push(event_kind kind, void const* frame, label const* name) noexcept -> void {
+        auto head = head_.load(std::memory_order_relaxed);
+        auto& s = slots_[head & mask_];
+        s.time.store(now(), std::memory_order_relaxed);
+        s.frame.store(frame, std::memory_order_relaxed);
+        s.name.store(name, std::memory_order_relaxed);
+        s.kind.store(kind, std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    [[nodiscard]]
+    auto capacity() const noexcept -> std::size_t {
+        return mask_ + 1;
+    }
+
+    // Empties the ring for another thread. No thread may be recording into it.
+    auto reset(std::uint32_t thread) noexcept -> void {
+        head_.store(0, std::memory_order_relaxed);
+        thread_ = thread;
+    }
+
+private:
+    friend auto tracing::snapshot() -> std::vector<event>;
+
+    std::unique_ptr<slot[]> slots_;
+    std::size_t mask_;
+    std::atomic<std::uint64_t> head_;
+    std::uint32_t thread_;
+};
+
+// Returns the ring of the calling thread, creating it on first use.
+// The ring is returned to a free list after the thread exits and a snapshot has read it.
+[[nodiscard]]
+COROFX_PUBLIC auto attach() -> ring*;
+
+inline constinit thread_local ring* local_ring{};
+
+// Records an event whether or not tracing is enabled.
+inline auto emit(event_kind kind, void const* frame, label const* name = nullptr) noexcept
+    -> void {
+    auto r = local_ring;
+    if (not r) [[unlikely]] {
+        r = local_ring = attach();
+    }
+    r->push(kind, frame, name);
+}
+
+// Records an event if tracing is enabled.
+inline auto record(
+    [[maybe_unused]] event_kind kind, [[maybe_unused]] void const* frame,
+    [[maybe_unused]] label const* name = nullptr) noexcept -> void {
+#ifdef COROFX_ENABLE_TRACING
+    emit(kind, frame, name);
+#endif
+}
+
+} // namespace detail
+
+} // namespace corofx::tracing
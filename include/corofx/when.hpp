@@ -0,0 +1,355 @@
+#pragma once
+
+#include "check.hpp"
+#include "detail/type_set.hpp"
+#include "effect.hpp"
+#include "scheduler.hpp"
+#include "task.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace corofx {
+
+namespace detail {
+
+template<typename T>
+inline constexpr bool is_task = false;
+
+template<typename T, effect... Es>
+inline constexpr bool is_task<task<T, Es...>> = true;
+
+// Tasks whose effects are all handled by executors, so that they can be spawned.
+template<typename Task>
+inline constexpr bool spawnable_task =
+    Task::effect_types::apply([]<typename... Es>() { return (spawnable<Es> and ...); });
+
+template<typename T, typename S>
+struct task_of;
+
+template<typename T, typename... Es>
+struct task_of<T, type_set<Es...>> {
+    using type = task<T, Es...>;
+};
+
+template<typename T, typename S>
+using task_of_t = task_of<T, S>::type;
+
+template<typename Task>
+using result_of = value_holder<typename Task::value_type>;
+
+// Runs a task and stores its result.
+template<typename T, effect... Es>
+auto store(task<T, Es...> t, std::optional<value_holder<T>>* out) -> task<void, Es...> {
+    if constexpr (std::is_void_v<T>) {
+        co_await std::move(t);
+        out->emplace();
+    } else {
+        out->emplace(co_await std::move(t));
+    }
+    co_return {};
+}
+
+// The outcome of a race between spawned tasks, shared with the losers that may outlive it.
+template<typename R>
+class race {
+public:
+    explicit race(std::size_t refs) noexcept : refs_{refs} {}
+
+    [[nodiscard]]
+    auto decided() const noexcept -> bool {
+        return won_.load(std::memory_order_acquire);
+    }
+
+    // Only the first caller wins.
+    [[nodiscard]]
+    auto claim() noexcept -> bool {
+        return not won_.exchange(true, std::memory_order_acq_rel);
+    }
+
+    // Publishes the result of the winner and wakes up the awaiting task if it is parked.
+    auto finish(R result) noexcept -> void {
+        result_.emplace(std::move(result));
+        if (state_.exchange(state::done, std::memory_order_acq_rel) == state::parked) {
+            waker_.wake();
+        }
+    }
+
+    // A `suspend` callback parking the awaiting task until there is a winner.
+    static auto park(waker w, void* arg) noexcept -> void {
+        auto& r = *static_cast<race*>(arg);
+        r.waker_ = w;
+        auto s = state::pending;
+        if (not r.state_.compare_exchange_strong(s, state::parked, std::memory_order_acq_rel)) {
+            w.wake();
+        }
+    }
+
+    [[nodiscard]]
+    auto take() noexcept -> R {
+        return std::move(*result_);
+    }
+
+    auto release() noexcept -> void {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+private:
+    enum class state : std::uint8_t {
+        pending,
+        parked,
+        done,
+    };
+
+    std::atomic<std::size_t> refs_;
+    std::atomic<bool> won_{};
+    std::atomic<state> state_{state::pending};
+    waker waker_;
+    std::optional<R> result_;
+};
+
+// Runs a task unless the race is already decided.
+template<typename R, typename Make, typename T, effect... Es>
+auto race_child(task<T, Es...> t, race<R>* r, Make make) -> task<void, Es...> {
+    if (not r->decided()) {
+        auto value = std::optional<value_holder<T>>{};
+        co_await store(std::move(t), &value);
+        if (r->claim()) r->finish(make(std::move(*value)));
+    }
+    r->release();
+    co_return {};
+}
+
+template<typename Row, std::size_t... Is, typename... Tasks>
+auto all_sequential(std::index_sequence<Is...>, Tasks... ts)
+    -> task_of_t<std::tuple<result_of<Tasks>...>, Row> {
+    auto results = std::tuple<std::optional<result_of<Tasks>>...>{};
+    (co_await store(std::move(ts), &std::get<Is>(results)), ...);
+    co_return std::tuple<result_of<Tasks>...>{std::move(*std::get<Is>(results))...};
+}
+
+// The first task runs inline while the others are spawned.
+template<typename Row, std::size_t... Is, typename First, typename... Rest>
+auto all_concurrent(std::index_sequence<Is...>, First first, Rest... rest)
+    -> task_of_t<std::tuple<result_of<First>, result_of<Rest>...>, Row> {
+    auto results = std::tuple<std::optional<result_of<First>>, std::optional<result_of<Rest>>...>{};
+    auto handles = std::array<job_handle, sizeof...(Rest)>{};
+    ((handles[Is] = co_await spawn{store(std::move(rest), &std::get<Is + 1>(results))}), ...);
+    co_await store(std::move(first), &std::get<0>(results));
+    for (auto& h : handles) co_await join{h};
+    co_return std::tuple<result_of<First>, result_of<Rest>...>{
+        std::move(*std::get<0>(results)), std::move(*std::get<Is + 1>(results))...};
+}
+
+// Without an executor, the first task always wins and the others never start.
+template<typename Row, typename First, typename... Rest>
+auto any_sequential(First first, Rest... rest)
+    -> task_of_t<std::variant<result_of<First>, result_of<Rest>...>, Row> {
+    using result_type = std::variant<result_of<First>, result_of<Rest>...>;
+    {
+        auto losers = std::tuple<Rest...>{std::move(rest)...};
+    }
+    auto value = std::optional<result_of<First>>{};
+    co_await store(std::move(first), &value);
+    co_return result_type{std::in_place_index<0>, std::move(*value)};
+}
+
+template<typename Row, std::size_t... Is, typename... Tasks>
+auto any_concurrent(std::index_sequence<Is...>, Tasks... ts)
+    -> task_of_t<std::variant<result_of<Tasks>...>, Row> {
+    using result_type = std::variant<result_of<Tasks>...>;
+    auto r = new race<result_type>{sizeof...(Tasks) + 1};
+    (co_await spawn{race_child(std::move(ts), r, [](auto&& value) {
+         return result_type{std::in_place_index<Is>, std::move(value)};
+     })},
+     ...);
+    co_await suspend{&race<result_type>::park, r};
+    auto result = r->take();
+    r->release();
+    co_return result;
+}
+
+template<typename Row, typename T, effect... Es>
+auto all_range_sequential(std::vector<task<T, Es...>> ts)
+    -> task_of_t<std::vector<value_holder<T>>, Row> {
+    auto results = std::vector<value_holder<T>>{};
+    results.reserve(ts.size());
+    for (auto& t : ts) {
+        auto value = std::optional<value_holder<T>>{};
+        co_await store(std::move(t), &value);
+        results.push_back(std::move(*value));
+    }
+    co_return results;
+}
+
+template<typename Row, typename T, effect... Es>
+auto all_range_concurrent(std::vector<task<T, Es...>> ts)
+    -> task_of_t<std::vector<value_holder<T>>, Row> {
+    auto values = std::vector<std::optional<value_holder<T>>>(ts.size());
+    auto handles = std::vector<job_handle>{};
+    handles.reserve(ts.size());
+    for (auto i = std::size_t{1}; i < ts.size(); ++i) {
+        handles.push_back(co_await spawn{store(std::move(ts[i]), &values[i])});
+    }
+    co_await store(std::move(ts[0]), &values[0]);
+    for (auto& h : handles) co_await join{h};
+    auto results = std::vector<value_holder<T>>{};
+    results.reserve(values.size());
+    for (auto& v : values) results.push_back(std::move(*v));
+    co_return results;
+}
+
+template<typename Row, typename T, effect... Es>
+auto any_range_sequential(std::vector<task<T, Es...>> ts)
+    -> task_of_t<std::pair<std::size_t, value_holder<T>>, Row> {
+    auto first = std::move(ts[0]);
+    ts.clear();
+    auto value = std::optional<value_holder<T>>{};
+    co_await store(std::move(first), &value);
+    co_return std::pair<std::size_t, value_holder<T>>{0, std::move(*value)};
+}
+
+template<typename Row, typename T, effect... Es>
+auto any_range_concurrent(std::vector<task<T, Es...>> ts)
+    -> task_of_t<std::pair<std::size_t, value_holder<T>>, Row> {
+    using result_type = std::pair<std::size_t, value_holder<T>>;
+    auto r = new race<result_type>{ts.size() + 1};
+    for (auto i = std::size_t{}; i < ts.size(); ++i) {
+        co_await spawn{race_child(std::move(ts[i]), r, [i](value_holder<T>&& value) {
+            return result_type{i, std::move(value)};
+        })};
+    }
+    ts.clear();
+    co_await suspend{&race<result_type>::park, r};
+    auto result = r->take();
+    r->release();
+    co_return result;
+}
+
+enum class when_kind : std::uint8_t {
+    all,
+    any,
+};
+
+// Awaiting combinators lowers them to a task according to the effects of the awaiting task.
+// Children run concurrently only if it can spawn them.
+template<when_kind Kind, typename... Tasks>
+class when_op {
+public:
+    explicit when_op(Tasks... ts) noexcept : tasks_{std::move(ts)...} {}
+
+    template<typename Outer>
+    [[nodiscard]]
+    auto lower() && {
+        using row = type_set<>::add<typename Tasks::effect_types...>;
+        constexpr auto concurrent = (spawnable_task<Tasks> and ...);
+        return std::apply(
+            [](Tasks&... ts) {
+                using seq = std::index_sequence_for<Tasks...>;
+                if constexpr (Kind == when_kind::all) {
+                    using executor_row = type_set<spawn, join>;
+                    if constexpr (concurrent and Outer::template contains<executor_row>) {
+                        return all_concurrent<typename executor_row::template add<row>>(
+                            std::make_index_sequence<sizeof...(Tasks) - 1>{}, std::move(ts)...);
+                    } else {
+                        return all_sequential<row>(seq{}, std::move(ts)...);
+                    }
+                } else {
+                    using executor_row = type_set<spawn, suspend>;
+                    if constexpr (concurrent and Outer::template contains<executor_row>) {
+                        return any_concurrent<typename executor_row::template add<row>>(
+                            seq{}, std::move(ts)...);
+                    } else {
+                        return any_sequential<row>(std::move(ts)...);
+                    }
+                }
+            },
+            tasks_);
+    }
+
+private:
+    std::tuple<Tasks...> tasks_;
+};
+
+template<when_kind Kind, typename T, effect... Es>
+class when_range_op {
+public:
+    explicit when_range_op(std::vector<task<T, Es...>> ts) noexcept : tasks_{std::move(ts)} {
+        check(not tasks_.empty());
+    }
+
+    template<typename Outer>
+    [[nodiscard]]
+    auto lower() && {
+        using row = type_set<Es...>;
+        constexpr auto concurrent = (spawnable<Es> and ...);
+        if constexpr (Kind == when_kind::all) {
+            using executor_row = type_set<spawn, join>;
+            if constexpr (concurrent and Outer::template contains<executor_row>) {
+                return all_range_concurrent<typename executor_row::template add<row>>(
+                    std::move(tasks_));
+            } else {
+                return all_range_sequential<row>(std::move(tasks_));
+            }
+        } else {
+            using executor_row = type_set<spawn, suspend>;
+            if constexpr (concurrent and Outer::template contains<executor_row>) {
+                return any_range_concurrent<typename executor_row::template add<row>>(
+                    std::move(tasks_));
+            } else {
+                return any_range_sequential<row>(std::move(tasks_));
+            }
+        }
+    }
+
+private:
+    std::vector<task<T, Es...>> tasks_;
+};
+
+} // namespace detail
+
+// Awaits every task and returns their results in order, with `std::monostate` for `void`.
+// The tasks run concurrently if the awaiting task performs `spawn` and `join` and they only
+// perform spawnable effects; otherwise they run one after the other.
+template<typename... Tasks>
+    requires(sizeof...(Tasks) != 0 and (detail::is_task<Tasks> and ...))
+[[nodiscard]]
+auto when_all(Tasks... ts) noexcept -> detail::when_op<detail::when_kind::all, Tasks...> {
+    return detail::when_op<detail::when_kind::all, Tasks...>{std::move(ts)...};
+}
+
+template<typename T, effect... Es>
+[[nodiscard]]
+auto when_all(std::vector<task<T, Es...>> ts) noexcept
+    -> detail::when_range_op<detail::when_kind::all, T, Es...> {
+    return detail::when_range_op<detail::when_kind::all, T, Es...>{std::move(ts)};
+}
+
+// Awaits the first task to complete and returns its result, tagged with its index.
+// The tasks run concurrently if the awaiting task performs `spawn` and `suspend` and they only
+// perform spawnable effects. Losers that have not started by then are destroyed without running;
+// those already running are left to complete on their own, and their results are dropped.
+// Otherwise the first task runs alone and the others are destroyed right away.
+template<typename... Tasks>
+    requires(sizeof...(Tasks) != 0 and (detail::is_task<Tasks> and ...))
+[[nodiscard]]
+auto when_any(Tasks... ts) noexcept -> detail::when_op<detail::when_kind::any, Tasks...> {
+    return detail::when_op<detail::when_kind::any, Tasks...>{std::move(ts)...};
+}
+
+template<typename T, effect... Es>
+[[nodiscard]]
+auto when_any(std::vector<task<T, Es...>> ts) noexcept
+    -> detail::when_range_op<detail::when_kind::any, T, Es...> {
+    return detail::when_range_op<detail::when_kind::any, T, Es...>{std::move(ts)};
+}
+
+} // namespace corofx
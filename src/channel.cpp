@@ -0,0 +1,112 @@
+#include "corofx/channel.hpp"
+
+#include "corofx/check.hpp"
+
+namespace corofx::detail {
+
+auto chan_list::push_back(chan_node& n) noexcept -> void {
+    check(not n.linked);
+    n.prev = tail_;
+    n.next = nullptr;
+    n.linked = true;
+    if (tail_) {
+        tail_->next = &n;
+    } else {
+        head_ = &n;
+    }
+    tail_ = &n;
+}
+
+auto chan_list::remove(chan_node& n) noexcept -> void {
+    check(n.linked);
+    if (n.prev) {
+        n.prev->next = n.next;
+    } else {
+        head_ = n.next;
+    }
+    if (n.next) {
+        n.next->prev = n.prev;
+    } else {
+        tail_ = n.prev;
+    }
+    n.prev = nullptr;
+    n.next = nullptr;
+    n.linked = false;
+}
+
+auto chan_list::pop_front() noexcept -> chan_node* {
+    auto n = head_;
+    if (n) remove(*n);
+    return n;
+}
+
+auto channel_state::close() noexcept -> void {
+    closed_.store(true, std::memory_order_seq_cst);
+    auto lock = std::lock_guard{mutex_};
+    for (auto dir : {chan_dir::recv, chan_dir::send}) {
+        while (auto n = parked(dir).pop_front()) {
+            waiting(dir).fetch_sub(1, std::memory_order_relaxed);
+            if (n->wait->claim() == chan_wait::state::waiting) n->wait->w.wake();
+        }
+    }
+}
+
+auto channel_state::park(chan_node& n, chan_dir dir) noexcept -> bool {
+    auto lock = std::lock_guard{mutex_};
+    parked(dir).push_back(n);
+    waiting(dir).fetch_add(1, std::memory_order_seq_cst);
+    if (closed()) return true;
+    return dir == chan_dir::recv ? not ring_->empty() : not ring_->full();
+}
+
+auto channel_state::unpark(chan_node& n, chan_dir dir) noexcept -> void {
+    auto lock = std::lock_guard{mutex_};
+    if (not n.linked) return;
+    parked(dir).remove(n);
+    waiting(dir).fetch_sub(1, std::memory_order_relaxed);
+}
+
+auto channel_state::notify_slow(chan_dir dir) noexcept -> void {
+    auto winner = static_cast<chan_wait*>(nullptr);
+    {
+        auto lock = std::lock_guard{mutex_};
+        while (auto n = parked(dir).pop_front()) {
+            waiting(dir).fetch_sub(1, std::memory_order_relaxed);
+            // Tasks parked on several channels may have been claimed by another one already.
+            auto prev = n->wait->claim();
+            if (prev == chan_wait::state::claimed) continue;
+            if (prev == chan_wait::state::waiting) winner = n->wait;
+            break;
+        }
+    }
+    // The winner cannot go away before it is woken up.
+    if (winner) winner->w.wake();
+}
+
+auto park_on(waker w, void* arg) noexcept -> void {
+    auto& park = *static_cast<chan_park*>(arg);
+    park.wait.w = w;
+    auto ready = false;
+    for (auto i = std::size_t{}; i < park.states.size(); ++i) {
+        if (not park.states[i]) continue;
+        park.nodes[i].wait = &park.wait;
+        ready = park.states[i]->park(park.nodes[i], park.dir) or ready;
+    }
+    // The task stays `registering` until it is parked on every channel, so that it cannot be
+    // woken up, and resumed on another thread, while still being parked. It may be gone as soon
+    // as it is `waiting`.
+    auto s = chan_wait::state::registering;
+    auto next = ready ? chan_wait::state::claimed : chan_wait::state::waiting;
+    if (not park.wait.current.compare_exchange_strong(s, next, std::memory_order_seq_cst) or
+        ready) {
+        w.wake();
+    }
+}
+
+auto unpark_all(chan_park& park) noexcept -> void {
+    for (auto i = std::size_t{}; i < park.states.size(); ++i) {
+        if (park.states[i]) park.states[i]->unpark(park.nodes[i], park.dir);
+    }
+}
+
+} // namespace corofx::detail
@@ -0,0 +1,105 @@
+#include "corofx/detail/frame_pool.hpp"
+
+#include <array>
+#include <cstddef>
+#include <new>
+
+namespace corofx::detail {
+
+namespace {
+
+struct free_block {
+    free_block* next;
+};
+
+struct size_class {
+    free_block* head;
+    std::size_t count;
+};
+
+// Trivially destructible so that frames freed during thread teardown never touch a dead object.
+struct thread_cache {
+    std::array<size_class, frame_pool::num_classes> classes;
+    bool registered;
+    bool retired;
+};
+
+constinit thread_local thread_cache cache{};
+
+auto release(size_class& c) noexcept -> void {
+    while (auto b = c.head) {
+        c.head = b->next;
+        ::operator delete(b);
+    }
+    c.count = 0;
+}
+
+class thread_cache_guard {
+public:
+    thread_cache_guard() noexcept = default;
+    thread_cache_guard(thread_cache_guard const&) = delete;
+    thread_cache_guard(thread_cache_guard&&) = delete;
+    auto operator=(thread_cache_guard const&) -> thread_cache_guard& = delete;
+    auto operator=(thread_cache_guard&&) -> thread_cache_guard& = delete;
+
+    ~thread_cache_guard() {
+        for (auto& c : cache.classes) release(c);
+        cache.retired = true;
+    }
+};
+
+auto register_cache() noexcept -> void {
+    thread_local thread_cache_guard guard;
+    cache.registered = true;
+}
+
+[[nodiscard]]
+constexpr auto class_index(std::size_t size) noexcept -> std::size_t {
+    return (size - 1) / frame_pool::granularity;
+}
+
+[[nodiscard]]
+constexpr auto class_size(std::size_t index) noexcept -> std::size_t {
+    return (index + 1) * frame_pool::granularity;
+}
+
+} // namespace
+
+auto frame_pool::allocate(std::size_t size) -> void* {
+    if (size == 0 or size > max_pooled_size) return ::operator new(size);
+    auto i = class_index(size);
+    auto& c = cache.classes[i];
+    if (auto b = c.head) {
+        c.head = b->next;
+        --c.count;
+        return b;
+    }
+    return ::operator new(class_size(i));
+}
+
+auto frame_pool::deallocate(void* ptr, std::size_t size) noexcept -> void {
+    if (size == 0 or size > max_pooled_size or cache.retired) {
+        ::operator delete(ptr);
+        return;
+    }
+    if (not cache.registered) register_cache();
+    auto& c = cache.classes[class_index(size)];
+    if (c.count == max_cached_blocks) {
+        ::operator delete(ptr);
+        return;
+    }
+    c.head = ::new (ptr) free_block{c.head};
+    ++c.count;
+}
+
+auto frame_pool::trim() noexcept -> void {
+    for (auto& c : cache.classes) release(c);
+}
+
+auto frame_pool::cached_blocks() noexcept -> std::size_t {
+    auto n = std::size_t{};
+    for (auto const& c : cache.classes) n += c.count;
+    return n;
+}
+
+} // namespace corofx::detail
@@ -0,0 +1,84 @@
+#include "corofx/file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+
+namespace corofx {
+
+namespace {
+
+// Applies `advice` to the pages holding `bytes`. Advice is best effort.
+auto advise(std::span<std::byte const> bytes, int advice) noexcept -> void {
+    static auto const page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    auto first = reinterpret_cast<std::uintptr_t>(bytes.data()) & ~(page - 1);
+    auto last = reinterpret_cast<std::uintptr_t>(bytes.data() + bytes.size());
+    static_cast<void>(::madvise(reinterpret_cast<void*>(first), last - first, advice));
+}
+
+} // namespace
+
+auto mapped_file::open(char const* path) -> std::optional<mapped_file> {
+    auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return std::nullopt;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    // Empty files cannot be mapped.
+    if (size == 0) {
+        ::close(fd);
+        return mapped_file{nullptr, 0};
+    }
+    auto* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return std::nullopt;
+    // Reads ahead aggressively and frees pages soon after they are read.
+    static_cast<void>(::madvise(data, size, MADV_SEQUENTIAL));
+    return mapped_file{static_cast<std::byte const*>(data), size};
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)}, size_{std::exchange(other.size_, 0)} {}
+
+mapped_file::~mapped_file() {
+    if (data_) ::munmap(const_cast<std::byte*>(data_), size_);
+}
+
+auto mapped_file::operator=(mapped_file&& other) noexcept -> mapped_file& {
+    auto tmp = std::move(other);
+    std::swap(data_, tmp.data_);
+    std::swap(size_, tmp.size_);
+    return *this;
+}
+
+auto mapped_reader::handle_tail(read_chunk&&) noexcept -> std::span<std::byte const> {
+    auto chunk = rest_.first(std::min(chunk_size_, rest_.size()));
+    rest_ = rest_.subspan(chunk.size());
+    // Starts reading the next chunk from disk while this one is processed.
+    if (not rest_.empty()) advise(rest_.first(std::min(chunk_size_, rest_.size())), MADV_WILLNEED);
+    return chunk;
+}
+
+auto streaming_reader::handle_tail(read_chunk&&) noexcept -> std::span<std::byte const> {
+    while (true) {
+        auto n = ::read(fd_, buffer_.data(), buffer_.size());
+        if (n >= 0) return std::span{buffer_}.first(static_cast<std::size_t>(n));
+        if (errno == EINTR) continue;
+        if (error_) *error_ = errno;
+        return {};
+    }
+}
+
+} // namespace corofx
@@ -0,0 +1,74 @@
+#include "corofx/frame_resource.hpp"
+
+#include "corofx/detail/frame_pool.hpp"
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace corofx::detail {
+
+namespace {
+
+using resource_ptr = std::pmr::memory_resource*;
+
+constinit thread_local resource_ptr current{};
+
+constexpr auto frame_alignment = std::size_t{__STDCPP_DEFAULT_NEW_ALIGNMENT__};
+
+// The trailer follows the frame, aligned for a pointer.
+[[nodiscard]]
+constexpr auto trailer_offset(std::size_t size) noexcept -> std::size_t {
+    return (size + alignof(resource_ptr) - 1) & ~(alignof(resource_ptr) - 1);
+}
+
+[[nodiscard]]
+constexpr auto allocation_size(std::size_t size) noexcept -> std::size_t {
+    return trailer_offset(size) + sizeof(resource_ptr);
+}
+
+[[nodiscard]]
+auto trailer(void* ptr, std::size_t size) noexcept -> resource_ptr* {
+    return std::launder(
+        reinterpret_cast<resource_ptr*>(static_cast<std::byte*>(ptr) + trailer_offset(size)));
+}
+
+} // namespace
+
+auto allocate_frame(std::size_t size, std::pmr::memory_resource* resource) -> void* {
+    auto n = allocation_size(size);
+    void* ptr = nullptr;
+    if (resource) {
+        ptr = resource->allocate(n, frame_alignment);
+    } else {
+#ifdef COROFX_ENABLE_FRAME_POOL
+        ptr = frame_pool::allocate(n);
+#else
+        ptr = ::operator new(n);
+#endif
+    }
+    ::new (static_cast<std::byte*>(ptr) + trailer_offset(size)) resource_ptr{resource};
+    return ptr;
+}
+
+auto deallocate_frame(void* ptr, std::size_t size) noexcept -> void {
+    auto n = allocation_size(size);
+    if (auto resource = *trailer(ptr, size)) {
+        resource->deallocate(ptr, n, frame_alignment);
+        return;
+    }
+#ifdef COROFX_ENABLE_FRAME_POOL
+    frame_pool::deallocate(ptr, n);
+#else
+    ::operator delete(ptr, n);
+#endif
+}
+
+auto current_frame_resource() noexcept -> std::pmr::memory_resource* { return current; }
+
+auto exchange_frame_resource(std::pmr::memory_resource* resource) noexcept
+    -> std::pmr::memory_resource* {
+    return std::exchange(current, resource);
+}
+
+} // namespace corofx::detail
@@ -1 +1,17 @@
-#include "corofx/handler.hpp" // IWYU pragma: keep
+#include "corofx/handler.hpp"
+
+#include <utility>
+
+namespace corofx::detail {
+
+namespace {
+
+constinit thread_local drop_hook* current_drop{};
+
+} // namespace
+
+auto exchange_drop_hook(drop_hook* hook) noexcept -> drop_hook* {
+    return std::exchange(current_drop, hook);
+}
+
+} // namespace corofx::detail
@@ -0,0 +1,120 @@
+#include "corofx/instrument.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace corofx::instrument {
+
+namespace {
+
+struct global_counters_t {
+    std::atomic<std::uint64_t> allocated;
+    std::atomic<std::uint64_t> freed;
+    std::atomic<std::uint64_t> allocated_bytes;
+    std::atomic<std::uint64_t> freed_bytes;
+    std::atomic<std::uint64_t> peak_live;
+};
+
+constinit global_counters_t global{};
+constinit thread_local frame_counters local{};
+constinit std::atomic<detail::site*> sites{};
+constinit thread_local detail::site* current{};
+
+auto update_peak(std::atomic<std::uint64_t>& peak, std::uint64_t live) noexcept -> void {
+    auto prev = peak.load(std::memory_order_relaxed);
+    while (prev < live and
+           not peak.compare_exchange_weak(prev, live, std::memory_order_relaxed)) {}
+}
+
+} // namespace
+
+namespace detail {
+
+site::site(site_kind kind, std::string_view name) noexcept
+    : kind_{kind}, name_{name}, allocated_{}, freed_{}, allocated_bytes_{}, freed_bytes_{},
+      peak_live_{}, next_{sites.load(std::memory_order_relaxed)} {
+    while (not sites.compare_exchange_weak(
+        next_, this, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+auto record_allocation(site* task, site* effect, std::size_t size) noexcept -> void {
+    ++local.allocated;
+    local.allocated_bytes += size;
+    local.peak_live = std::max(local.peak_live, local.live());
+
+    auto n = global.allocated.fetch_add(1, std::memory_order_relaxed) + 1;
+    global.allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    update_peak(global.peak_live, n - global.freed.load(std::memory_order_relaxed));
+
+    for (auto s : {task, effect}) {
+        if (not s) continue;
+        auto m = s->allocated_.fetch_add(1, std::memory_order_relaxed) + 1;
+        s->allocated_bytes_.fetch_add(size, std::memory_order_relaxed);
+        update_peak(s->peak_live_, m - s->freed_.load(std::memory_order_relaxed));
+    }
+}
+
+auto record_free(site* task, site* effect, std::size_t size) noexcept -> void {
+    ++local.freed;
+    local.freed_bytes += size;
+
+    global.freed.fetch_add(1, std::memory_order_relaxed);
+    global.freed_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    for (auto s : {task, effect}) {
+        if (not s) continue;
+        s->freed_.fetch_add(1, std::memory_order_relaxed);
+        s->freed_bytes_.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+auto current_effect() noexcept -> site*& { return current; }
+
+} // namespace detail
+
+auto thread_counters() noexcept -> frame_counters { return local; }
+
+auto global_counters() noexcept -> frame_counters {
+    return {
+        .allocated = global.allocated.load(std::memory_order_relaxed),
+        .freed = global.freed.load(std::memory_order_relaxed),
+        .allocated_bytes = global.allocated_bytes.load(std::memory_order_relaxed),
+        .freed_bytes = global.freed_bytes.load(std::memory_order_relaxed),
+        .peak_live = global.peak_live.load(std::memory_order_relaxed),
+    };
+}
+
+auto site_snapshot() -> std::vector<site_counters> {
+    auto res = std::vector<site_counters>{};
+    for (auto s = sites.load(std::memory_order_acquire); s; s = s->next_) {
+        res.push_back({
+            .kind = s->kind_,
+            .name = s->name_,
+            .counters =
+                {
+                    .allocated = s->allocated_.load(std::memory_order_relaxed),
+                    .freed = s->freed_.load(std::memory_order_relaxed),
+                    .allocated_bytes = s->allocated_bytes_.load(std::memory_order_relaxed),
+                    .freed_bytes = s->freed_bytes_.load(std::memory_order_relaxed),
+                    .peak_live = s->peak_live_.load(std::memory_order_relaxed),
+                },
+        });
+    }
+    return res;
+}
+
+auto reset_peaks() noexcept -> void {
+    local.peak_live = local.live();
+    auto g = global_counters();
+    global.peak_live.store(g.live(), std::memory_order_relaxed);
+    for (auto s = sites.load(std::memory_order_acquire); s; s = s->next_) {
+        auto live = s->allocated_.load(std::memory_order_relaxed) -
+                    s->freed_.load(std::memory_order_relaxed);
+        s->peak_live_.store(live, std::memory_order_relaxed);
+    }
+}
+
+} // namespace corofx::instrument
@@ -0,0 +1,134 @@
+#include "corofx/instrumented.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace corofx::instrument {
+
+namespace {
+
+constinit std::atomic<detail::latency_site*> sites{};
+constinit std::atomic<std::size_t> num_sites{};
+
+// The counters of the calling thread, indexed by site.
+thread_local std::vector<detail::thread_latencies*> local_latencies;
+
+struct quantile {
+    char const* label;
+    double q;
+};
+
+constexpr quantile quantiles[] = {{"0.5", 0.5}, {"0.99", 0.99}, {"0.999", 0.999}};
+
+auto write_escaped(std::FILE* file, std::string_view s) -> void {
+    for (auto c : s) {
+        if (c == '\\' or c == '"') {
+            std::fputc('\\', file);
+        } else if (c == '\n') {
+            std::fputs("\\n", file);
+            continue;
+        }
+        std::fputc(c, file);
+    }
+}
+
+} // namespace
+
+auto latency_histogram::percentile(double q) const noexcept -> std::uint64_t {
+    if (count_ == 0) return 0;
+    auto rank = static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(count_)));
+    if (rank == 0) rank = 1;
+    auto seen = std::uint64_t{};
+    for (auto i = std::size_t{}; i < num_buckets; ++i) {
+        seen += counts_[i];
+        if (seen >= rank) return highest_of(i);
+    }
+    return highest_of(num_buckets - 1);
+}
+
+namespace detail {
+
+latency_site::latency_site(std::string_view name) noexcept
+    : name_{name}, index_{num_sites.fetch_add(1, std::memory_order_relaxed)},
+      next_{sites.load(std::memory_order_relaxed)} {
+    while (not sites.compare_exchange_weak(
+        next_, this, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+auto latency_site::local() noexcept -> thread_latencies& {
+    if (index_ >= local_latencies.size()) local_latencies.resize(index_ + 1);
+    auto& l = local_latencies[index_];
+    if (not l) {
+        auto lock = std::lock_guard{mutex_};
+        l = threads_.emplace_back(std::make_unique<thread_latencies>()).get();
+    }
+    return *l;
+}
+
+auto latency_site::merged() -> effect_latency {
+    auto res = effect_latency{.name = name_, .invocations = 0, .histogram = {}};
+    auto lock = std::lock_guard{mutex_};
+    for (auto const& t : threads_) {
+        res.invocations += t->invocations.load(std::memory_order_relaxed);
+        auto& h = res.histogram;
+        for (auto i = std::size_t{}; i < latency_histogram::num_buckets; ++i) {
+            h.counts_[i] += t->counts[i].load(std::memory_order_relaxed);
+        }
+        h.count_ += t->count.load(std::memory_order_relaxed);
+        h.sum_ += t->sum.load(std::memory_order_relaxed);
+    }
+    return res;
+}
+
+} // namespace detail
+
+auto latency_snapshot() -> std::vector<effect_latency> {
+    auto res = std::vector<effect_latency>{};
+    for (auto s = sites.load(std::memory_order_acquire); s; s = s->next_) {
+        res.push_back(s->merged());
+    }
+    return res;
+}
+
+auto write_prometheus(std::vector<effect_latency> const& latencies, char const* path) -> bool {
+    using file_ptr = std::unique_ptr<std::FILE, int (*)(std::FILE*)>;
+    auto file = file_ptr{std::fopen(path, "w"), std::fclose};
+    if (not file) return false;
+    auto f = file.get();
+    std::fputs("# HELP corofx_effect_latency_seconds "
+               "Latency of effects from perform to resume.\n",
+               f);
+    std::fputs("# TYPE corofx_effect_latency_seconds summary\n", f);
+    for (auto const& l : latencies) {
+        auto const& h = l.histogram;
+        for (auto [label, q] : quantiles) {
+            std::fputs("corofx_effect_latency_seconds{effect=\"", f);
+            write_escaped(f, l.name);
+            std::fprintf(f, "\",quantile=\"%s\"} %.9f\n", label,
+                         static_cast<double>(h.percentile(q)) * 1e-9);
+        }
+        std::fputs("corofx_effect_latency_seconds_sum{effect=\"", f);
+        write_escaped(f, l.name);
+        std::fprintf(f, "\"} %.9f\n", static_cast<double>(h.sum()) * 1e-9);
+        std::fputs("corofx_effect_latency_seconds_count{effect=\"", f);
+        write_escaped(f, l.name);
+        std::fprintf(f, "\"} %llu\n", static_cast<unsigned long long>(h.count()));
+    }
+    std::fputs("# HELP corofx_effect_invocations_total Effects handled.\n", f);
+    std::fputs("# TYPE corofx_effect_invocations_total counter\n", f);
+    for (auto const& l : latencies) {
+        std::fputs("corofx_effect_invocations_total{effect=\"", f);
+        write_escaped(f, l.name);
+        std::fprintf(f, "\"} %llu\n", static_cast<unsigned long long>(l.invocations));
+    }
+    return std::fclose(file.release()) == 0;
+}
+
+} // namespace corofx::instrument
@@ -0,0 +1,518 @@
+#include "corofx/log.hpp"
+
+#include "corofx/check.hpp"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace corofx {
+
+namespace detail {
+
+// Tells loggers that the thread owning a buffer has exited, so that the buffer can be released
+// once drained. Shared by the thread and its buffers, which a logger may destroy first.
+class log_thread {
+public:
+    log_thread() noexcept = default;
+
+    log_thread(log_thread const&) = delete;
+    log_thread(log_thread&&) = delete;
+    ~log_thread() = default;
+    auto operator=(log_thread const&) -> log_thread& = delete;
+    auto operator=(log_thread&&) -> log_thread& = delete;
+
+    auto acquire() noexcept -> log_thread* {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+        return this;
+    }
+
+    auto release() noexcept -> void {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    [[nodiscard]]
+    auto exited() const noexcept -> bool {
+        return exited_.load(std::memory_order_acquire);
+    }
+
+    auto exit() noexcept -> void { exited_.store(true, std::memory_order_release); }
+
+private:
+    std::atomic<std::size_t> refs_{1};
+    std::atomic<bool> exited_;
+};
+
+// The bytes pending in a buffer, in at most two pieces.
+struct log_pending {
+    std::array<iovec, 2> iov;
+    std::size_t count;
+    std::size_t size;
+};
+
+// A single-producer, single-consumer ring of bytes.
+// The owning thread appends records. Whoever holds the drain flag, usually the writer, writes out
+// and consumes them.
+class log_buffer {
+public:
+    // Takes ownership of `data`, which holds `capacity` bytes.
+    log_buffer(char* data, std::size_t capacity, log_thread* owner) noexcept
+        : data_{data}, mask_{capacity - 1}, owner_{owner->acquire()} {}
+
+    log_buffer(log_buffer const&) = delete;
+    log_buffer(log_buffer&&) = delete;
+    ~log_buffer() { owner_->release(); }
+    auto operator=(log_buffer const&) -> log_buffer& = delete;
+    auto operator=(log_buffer&&) -> log_buffer& = delete;
+
+    [[nodiscard]]
+    auto owner() const noexcept -> log_thread* {
+        return owner_;
+    }
+
+    [[nodiscard]]
+    auto empty() const noexcept -> bool {
+        return head_.load(std::memory_order_seq_cst) == tail_.load(std::memory_order_acquire);
+    }
+
+    // Checks if the owner has exited and every record was written out. Requires the mutex of the
+    // logger, so that no other thread drains it.
+    [[nodiscard]]
+    auto released() const noexcept -> bool {
+        return owner_->exited() and empty();
+    }
+
+    // Appends a record if there is room for it. Only called by the owner.
+    [[nodiscard]]
+    auto try_push(std::string_view record) noexcept -> bool {
+        auto head = head_.load(std::memory_order_relaxed);
+        auto tail = tail_.load(std::memory_order_acquire);
+        if (mask_ + 1 - (head - tail) < record.size()) return false;
+        auto offset = head & mask_;
+        auto first = std::min(record.size(), mask_ + 1 - offset);
+        std::memcpy(data_.get() + offset, record.data(), first);
+        std::memcpy(data_.get(), record.data() + first, record.size() - first);
+        // Ordered before the owner checks `sleeping`, which the writer sets before `empty`.
+        head_.store(head + record.size(), std::memory_order_seq_cst);
+        return true;
+    }
+
+    // Returns the pending bytes. Requires the drain flag.
+    [[nodiscard]]
+    auto pending() const noexcept -> log_pending {
+        auto res = log_pending{};
+        auto tail = tail_.load(std::memory_order_relaxed);
+        res.size = head_.load(std::memory_order_acquire) - tail;
+        if (res.size == 0) return res;
+        auto offset = tail & mask_;
+        auto first = std::min(res.size, mask_ + 1 - offset);
+        res.iov[res.count++] = {data_.get() + offset, first};
+        if (first < res.size) res.iov[res.count++] = {data_.get(), res.size - first};
+        return res;
+    }
+
+    // Makes room for the owner. Requires the drain flag.
+    auto consume(std::size_t n) noexcept -> void {
+        tail_.store(tail_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    [[nodiscard]]
+    auto try_lock() noexcept -> bool {
+        return not draining_.test_and_set(std::memory_order_acquire);
+    }
+
+    auto lock() noexcept -> void {
+        while (not try_lock()) std::this_thread::yield();
+    }
+
+    auto unlock() noexcept -> void { draining_.clear(std::memory_order_release); }
+
+    // Only updated by the owner.
+    std::atomic<std::uint64_t> records;
+    std::atomic<std::uint64_t> dropped;
+    // Set while the writer sleeps until a record is pushed.
+    std::atomic<bool> sleeping;
+
+private:
+    std::unique_ptr<char[]> data_;
+    std::size_t mask_;
+    log_thread* owner_;
+    alignas(64) std::atomic<std::size_t> head_;
+    alignas(64) std::atomic<std::size_t> tail_;
+    std::atomic_flag draining_;
+
+public:
+    // The next buffer of the logger. Guarded by its mutex.
+    std::unique_ptr<log_buffer> next;
+};
+
+} // namespace detail
+
+namespace {
+
+struct cached_buffer {
+    std::uint64_t logger;
+    detail::log_buffer* buffer;
+};
+
+constexpr auto cache_size = std::size_t{8};
+
+// The buffers of the calling thread, indexed by logger id.
+constinit thread_local std::array<cached_buffer, cache_size> local_buffers{};
+
+// Marks the buffers of the calling thread for release when it exits.
+class thread_owner {
+public:
+    constexpr thread_owner() noexcept = default;
+
+    thread_owner(thread_owner const&) = delete;
+    thread_owner(thread_owner&&) = delete;
+    auto operator=(thread_owner const&) -> thread_owner& = delete;
+    auto operator=(thread_owner&&) -> thread_owner& = delete;
+
+    ~thread_owner();
+
+    // Returns the token of the calling thread, or null if it could not be allocated or the thread
+    // is exiting.
+    [[nodiscard]]
+    auto get() noexcept -> detail::log_thread*;
+
+private:
+    detail::log_thread* thread_{};
+};
+
+// Set once the buffers of the thread are marked for release. Records written afterwards, by
+// destructors of other thread-local objects, are written directly.
+constinit thread_local bool exiting{};
+
+constinit thread_local thread_owner owner{};
+
+thread_owner::~thread_owner() {
+    exiting = true;
+    local_buffers = {};
+    if (not thread_) return;
+    thread_->exit();
+    thread_->release();
+}
+
+auto thread_owner::get() noexcept -> detail::log_thread* {
+    if (not thread_) thread_ = new (std::nothrow) detail::log_thread{};
+    return thread_;
+}
+
+std::atomic<std::uint64_t> next_logger_id{1};
+
+constexpr std::string_view level_names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+// A blocked thread yields this many times before it sleeps, since the writer usually makes room
+// within one write.
+constexpr auto block_spins = 16;
+
+// The longest a blocked thread sleeps between attempts.
+constexpr auto max_block_backoff = std::chrono::microseconds{1000};
+
+// Rounds the buffer size up to a power of two that fits the longest record.
+auto normalized(log_options options) noexcept -> log_options {
+    options.buffer_size = std::bit_ceil(std::max(options.buffer_size, logger::max_record_size));
+    return options;
+}
+
+auto increment(std::atomic<std::uint64_t>& counter) noexcept -> void {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Writes `value` with at least `width` digits.
+auto write_padded(detail::log_writer& out, std::uint64_t value, int width) noexcept -> void {
+    auto digits = std::array<char, 20>{};
+    auto end = std::to_chars(digits.data(), digits.data() + digits.size(), value).ptr;
+    for (auto n = end - digits.data(); n < width; ++n) out.append("0");
+    out.append({digits.data(), end});
+}
+
+// Writes every byte of `iov` and returns the number of bytes that could not be written.
+auto write_all(int fd, iovec* iov, std::size_t count) noexcept -> std::size_t {
+    while (count > 0) {
+        auto n = ::writev(fd, iov, static_cast<int>(std::min<std::size_t>(count, IOV_MAX)));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            auto lost = std::size_t{};
+            for (auto i = std::size_t{}; i < count; ++i) lost += iov[i].iov_len;
+            return lost;
+        }
+        auto written = static_cast<std::size_t>(n);
+        while (count > 0 and written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+    return 0;
+}
+
+// Writes out the pending bytes of `buffers` with one `writev` and returns how many there were.
+// Buffers being drained by another thread are skipped unless `wait` is set.
+auto drain(
+    int fd, detail::log_buffer* buffers, bool wait, std::atomic<std::uint64_t>& failed_bytes)
+    -> std::size_t {
+    auto iov = std::vector<iovec>{};
+    auto taken = std::vector<std::pair<detail::log_buffer*, std::size_t>>{};
+    auto total = std::size_t{};
+    for (auto* b = buffers; b; b = b->next.get()) {
+        if (wait) {
+            b->lock();
+        } else if (not b->try_lock()) {
+            continue;
+        }
+        auto pending = b->pending();
+        if (pending.size == 0) {
+            b->unlock();
+            continue;
+        }
+        iov.insert(iov.end(), pending.iov.begin(), pending.iov.begin() + pending.count);
+        taken.emplace_back(b, pending.size);
+        total += pending.size;
+    }
+    if (total == 0) return 0;
+    if (auto lost = write_all(fd, iov.data(), iov.size()); lost > 0) {
+        failed_bytes.fetch_add(lost, std::memory_order_relaxed);
+    }
+    for (auto [b, n] : taken) {
+        b->consume(n);
+        b->unlock();
+    }
+    return total;
+}
+
+} // namespace
+
+logger::logger(int fd, log_options const& options)
+    : fd_{fd},
+      options_{normalized(options)},
+      id_{next_logger_id.fetch_add(1, std::memory_order_relaxed)} {
+    check(fd >= 0);
+    writer_ = std::thread{[this] { run(); }};
+}
+
+logger::~logger() {
+    {
+        auto lock = std::lock_guard{mutex_};
+        stop_.store(true, std::memory_order_release);
+    }
+    cv_.notify_one();
+    writer_.join();
+    // Frees the buffers one at a time rather than recursively.
+    while (buffers_) buffers_ = std::move(buffers_->next);
+    if (owned_) ::close(fd_);
+}
+
+auto logger::open(char const* path, log_options const& options) -> std::unique_ptr<logger> {
+    auto fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) return nullptr;
+    auto l = std::make_unique<logger>(fd, options);
+    l->owned_ = true;
+    return l;
+}
+
+auto logger::write(log_message const& msg) noexcept -> void {
+    std::array<char, max_record_size> line; // NOLINT(cppcoreguidelines-pro-type-member-init)
+    // Leaves room for the newline.
+    auto out = detail::log_writer{line.data(), line.data() + line.size() - 1};
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    out.write(micros / 1'000'000);
+    out.append(".");
+    write_padded(out, static_cast<std::uint64_t>(micros % 1'000'000), 6);
+    out.append(" ");
+    out.append(level_names[static_cast<std::size_t>(msg.level())]);
+    out.append(" ");
+    msg.format_to(out);
+    *out.pos() = '\n';
+    auto record = std::string_view{line.data(), out.pos() + 1};
+
+    auto* b = buffer();
+    if (not b) [[unlikely]] {
+        // Out of memory, or the thread is exiting.
+        auto iov = iovec{line.data(), record.size()};
+        if (auto lost = write_all(fd_, &iov, 1); lost > 0) {
+            failed_bytes_.fetch_add(lost, std::memory_order_relaxed);
+        }
+        return;
+    }
+    increment(b->records);
+    if (not b->try_push(record)) [[unlikely]] {
+        overflow(*b, record);
+    }
+    if (b->sleeping.load(std::memory_order_seq_cst)) [[unlikely]] {
+        if (b->sleeping.exchange(false, std::memory_order_relaxed)) wake();
+    }
+}
+
+auto logger::flush() noexcept -> void {
+    // Keeps the writer from releasing buffers while they are drained.
+    auto lock = std::lock_guard{mutex_};
+    drain(fd_, buffers_.get(), true, failed_bytes_);
+}
+
+auto logger::stats() const -> log_stats {
+    auto s = log_stats{.failed_bytes = failed_bytes_.load(std::memory_order_relaxed)};
+    auto lock = std::lock_guard{mutex_};
+    s.records = released_.records;
+    s.dropped = released_.dropped;
+    for (auto* b = buffers_.get(); b; b = b->next.get()) {
+        s.records += b->records.load(std::memory_order_relaxed);
+        s.dropped += b->dropped.load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+auto logger::buffer() noexcept -> detail::log_buffer* {
+    auto& slot = local_buffers[id_ % cache_size];
+    if (slot.logger == id_) [[likely]] {
+        return slot.buffer;
+    }
+    // The first record of the thread, or another logger took the slot.
+    if (exiting) return nullptr;
+    auto* self = owner.get();
+    if (not self) return nullptr;
+    auto lock = std::lock_guard{mutex_};
+    auto* b = static_cast<detail::log_buffer*>(nullptr);
+    for (auto* it = buffers_.get(); it and not b; it = it->next.get()) {
+        if (it->owner() == self) b = it;
+    }
+    if (not b) {
+        auto* data = new (std::nothrow) char[options_.buffer_size];
+        if (not data) return nullptr;
+        auto* created = new (std::nothrow) detail::log_buffer{data, options_.buffer_size, self};
+        if (not created) {
+            delete[] data;
+            return nullptr;
+        }
+        b = created;
+        b->sleeping.store(idle_, std::memory_order_relaxed);
+        b->next = std::move(buffers_);
+        buffers_.reset(b);
+    }
+    slot = {.logger = id_, .buffer = b};
+    return b;
+}
+
+auto logger::overflow(detail::log_buffer& b, std::string_view record) noexcept -> void {
+    switch (options_.overflow) {
+    case log_overflow::drop:
+        increment(b.dropped);
+        return;
+    case log_overflow::block: {
+        // Backs off so that a slow file does not keep the thread spinning.
+        auto backoff = std::chrono::microseconds{1};
+        for (auto spins = 0; not b.try_push(record); ++spins) {
+            wake();
+            if (spins < block_spins) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(backoff);
+                backoff = std::min(backoff * 2, max_block_backoff);
+            }
+        }
+        return;
+    }
+    case log_overflow::sync: {
+        b.lock();
+        auto pending = b.pending();
+        auto iov = std::array<iovec, 3>{};
+        std::copy_n(pending.iov.begin(), pending.count, iov.begin());
+        iov[pending.count] = {const_cast<char*>(record.data()), record.size()};
+        if (auto lost = write_all(fd_, iov.data(), pending.count + 1); lost > 0) {
+            failed_bytes_.fetch_add(lost, std::memory_order_relaxed);
+        }
+        b.consume(pending.size);
+        b.unlock();
+        return;
+    }
+    }
+    check_unreachable();
+}
+
+auto logger::run() -> void {
+    auto polls = 0;
+    while (true) {
+        auto stopping = stop_.load(std::memory_order_acquire);
+        auto* buffers = release_exited();
+        // Once stopping, waits for threads flushing their own buffers so that nothing is left.
+        auto written = drain(fd_, buffers, stopping, failed_bytes_);
+        if (stopping) return;
+        if (written > 0) {
+            polls = 0;
+            continue;
+        }
+        auto lock = std::unique_lock{mutex_};
+        auto woken = [&] {
+            return stop_.load(std::memory_order_relaxed)
+                   or wake_.exchange(false, std::memory_order_relaxed);
+        };
+        // Polls once more after the buffers run empty, then sleeps until a record is written.
+        if (polls++ == 0) {
+            cv_.wait_for(lock, options_.flush_interval, woken);
+            continue;
+        }
+        // Each owner wakes the writer after its next push, unless the push is seen here.
+        idle_ = true;
+        auto empty = true;
+        for (auto* b = buffers_.get(); b; b = b->next.get()) {
+            b->sleeping.store(true, std::memory_order_seq_cst);
+            empty = empty and b->empty();
+        }
+        if (empty) cv_.wait(lock, woken);
+        idle_ = false;
+        for (auto* b = buffers_.get(); b; b = b->next.get()) {
+            b->sleeping.store(false, std::memory_order_relaxed);
+        }
+        polls = 0;
+    }
+}
+
+auto logger::release_exited() -> detail::log_buffer* {
+    auto lock = std::lock_guard{mutex_};
+    for (auto* link = &buffers_; *link;) {
+        auto& b = **link;
+        if (not b.released()) {
+            link = &b.next;
+            continue;
+        }
+        released_.records += b.records.load(std::memory_order_relaxed);
+        released_.dropped += b.dropped.load(std::memory_order_relaxed);
+        *link = std::move(b.next);
+    }
+    return buffers_.get();
+}
+
+auto logger::wake() noexcept -> void {
+    {
+        auto lock = std::lock_guard{mutex_};
+        wake_.store(true, std::memory_order_relaxed);
+    }
+    cv_.notify_one();
+}
+
+} // namespace corofx
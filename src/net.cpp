@@ -0,0 +1,420 @@
+#include "corofx/net.hpp"
+
+#include "corofx/check.hpp"
+#include "corofx/detail/job.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace corofx::detail {
+
+namespace {
+
+constexpr auto max_events = 64;
+
+using clock = std::chrono::steady_clock;
+
+// Runs a system call until it is not interrupted.
+// Returns `std::nullopt` if it would block and `-errno` on other errors.
+template<typename F>
+[[nodiscard]]
+auto retry(F f) noexcept -> std::optional<std::ptrdiff_t> {
+    while (true) {
+        auto r = static_cast<std::ptrdiff_t>(f());
+        if (r >= 0) return r;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN or errno == EWOULDBLOCK) return std::nullopt;
+        return -errno;
+    }
+}
+
+[[nodiscard]]
+auto attempt(net_accept const& eff) noexcept -> std::optional<int> {
+    auto r = retry(
+        [&] { return ::accept4(eff.fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC); });
+    if (not r) return std::nullopt;
+    return static_cast<int>(*r);
+}
+
+[[nodiscard]]
+auto attempt(net_read const& eff) noexcept -> std::optional<std::ptrdiff_t> {
+    return retry([&] { return ::recv(eff.fd, eff.buffer.data(), eff.buffer.size(), 0); });
+}
+
+[[nodiscard]]
+auto attempt(net_write const& eff) noexcept -> std::optional<std::ptrdiff_t> {
+    return retry(
+        [&] { return ::send(eff.fd, eff.buffer.data(), eff.buffer.size(), MSG_NOSIGNAL); });
+}
+
+// A task parked until its socket becomes ready.
+struct waiter {
+    job* owner;
+    void* eff;
+    void* resume;
+    // Retries the operation and, on success, prepares the owner to resume.
+    auto (*complete)(waiter& w) noexcept -> bool;
+};
+
+template<effect E>
+auto complete(waiter& w) noexcept -> bool {
+    auto result = attempt(*static_cast<E*>(w.eff));
+    if (not result) return false;
+    w.owner->next_ = static_cast<resumer<E>*>(w.resume)->set_value(*result);
+    return true;
+}
+
+struct fd_waiters {
+    std::optional<waiter> in;
+    std::optional<waiter> out;
+};
+
+// What the loop does with the current job once it stops running.
+enum class post_action : std::uint8_t {
+    complete,
+    requeue,
+    park,
+    suspend,
+};
+
+constinit thread_local reactor_state const* running{};
+
+} // namespace
+
+class reactor_state final
+    : public handler<spawn>
+    , public handler<yield_thread>
+    , public handler<join>
+    , public handler<net_accept>
+    , public handler<net_read>
+    , public handler<net_write>
+    , public handler<sleep_for>
+    , public handler<sleep_until>
+    , public handler<suspend>
+    , public executor {
+public:
+    reactor_state()
+        : epoll_{::epoll_create1(EPOLL_CLOEXEC)},
+          event_{::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)},
+          start_{clock::now()} {
+        check(epoll_ >= 0 and event_ >= 0);
+        auto ev = epoll_event{};
+        ev.events = EPOLLIN;
+        ev.data.fd = event_;
+        check(::epoll_ctl(epoll_, EPOLL_CTL_ADD, event_, &ev) == 0);
+    }
+
+    reactor_state(reactor_state const&) = delete;
+    reactor_state(reactor_state&&) = delete;
+    auto operator=(reactor_state const&) -> reactor_state& = delete;
+    auto operator=(reactor_state&&) -> reactor_state& = delete;
+
+    ~reactor_state() {
+        ::close(event_);
+        ::close(epoll_);
+    }
+
+    auto run_root(frame<> root, bind_fn bind, void* output) -> void {
+        check(live_ == 0);
+        running = this;
+        auto j = new job{std::move(root), 1, this};
+        check(bind(*j->root_, &evidence_.back(), output));
+        ++live_;
+        ready_.push_back(j);
+        while (live_ != 0) {
+            // Only the tasks that are ready now run, so that yielding tasks cannot starve timers.
+            for (auto n = ready_.size(); n != 0; --n) {
+                auto next = ready_.front();
+                ready_.pop_front();
+                execute(next);
+            }
+            if (live_ == 0) break;
+            take_remote();
+            auto idle = ready_.empty();
+            // Tasks that remain are either waiting for sockets, timers, wakers or each other.
+            check(not idle or parked_ != 0 or suspended_ != 0 or timers_.size() != 0);
+            if (parked_ != 0 or suspended_ != 0) {
+                poll(idle ? timeout() : 0);
+            } else if (idle) {
+                std::this_thread::sleep_until(start_ + *timers_.next_expiry() * timer_resolution);
+            }
+            expire();
+        }
+        running = nullptr;
+    }
+
+    [[nodiscard]]
+    auto timer_slack() const noexcept -> timer_stats {
+        return stats_;
+    }
+
+    auto handle(spawn&& eff, resumer<spawn>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        auto j = new job{std::move(eff.frame_), 2, this};
+        check(eff.bind_(*j->root_, &evidence_.back(), &j->output_));
+        ++live_;
+        ready_.push_back(j);
+        return resume.set_value(job_handle{j});
+    }
+
+    auto handle(yield_thread&&, resumer<yield_thread>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        current_->next_ = resume.set_value();
+        action_ = post_action::requeue;
+        return std::noop_coroutine();
+    }
+
+    auto handle(join&& eff, resumer<join>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        auto target = eff.job.job_;
+        check(target != nullptr and target != current_);
+        if (target->done()) return resume.set_value();
+        current_->next_ = resume.set_value();
+        check(target->add_waiter(current_));
+        action_ = post_action::park;
+        return std::noop_coroutine();
+    }
+
+    auto handle(suspend&& eff, resumer<suspend>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        current_->next_ = resume.set_value();
+        parked_suspend_ = &eff;
+        action_ = post_action::suspend;
+        return std::noop_coroutine();
+    }
+
+    auto wake(job* j) noexcept -> void override {
+        if (running == this) {
+            --suspended_;
+            ready_.push_back(j);
+            return;
+        }
+        {
+            auto lock = std::lock_guard{remote_mutex_};
+            remote_.push_back(j);
+            remote_pending_.store(true, std::memory_order_relaxed);
+        }
+        auto one = std::uint64_t{1};
+        check(::write(event_, &one, sizeof(one)) == sizeof(one));
+    }
+
+    auto handle(net_accept&& eff, resumer<net_accept>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        return perform(eff, resume, &fd_waiters::in);
+    }
+
+    auto handle(net_read&& eff, resumer<net_read>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        return perform(eff, resume, &fd_waiters::in);
+    }
+
+    auto handle(net_write&& eff, resumer<net_write>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        return perform(eff, resume, &fd_waiters::out);
+    }
+
+    auto handle(sleep_for&& eff, resumer<sleep_for>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        return sleep(eff.sleeper_, clock::now() + eff.duration, resume);
+    }
+
+    auto handle(sleep_until&& eff, resumer<sleep_until>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        return sleep(eff.sleeper_, eff.deadline, resume);
+    }
+
+private:
+    static constexpr auto timer_resolution = reactor::timer_resolution;
+
+    template<effect E>
+    auto sleep(sleeper& s, clock::time_point due, resumer<E>& resume) noexcept
+        -> std::coroutine_handle<> {
+        if (due <= clock::now()) return resume.set_value();
+        s.due = due;
+        s.owner = current_;
+        s.resume = resume.set_value();
+        // Rounded up so that the task is not woken up early.
+        auto ticks = (due - start_ + timer_resolution - clock::duration{1}) / timer_resolution;
+        timers_.insert(s, static_cast<std::uint64_t>(ticks));
+        action_ = post_action::park;
+        return std::noop_coroutine();
+    }
+
+    // Moves jobs woken by other threads to the ready queue.
+    auto take_remote() noexcept -> void {
+        if (not remote_pending_.load(std::memory_order_acquire)) return;
+        auto lock = std::lock_guard{remote_mutex_};
+        suspended_ -= remote_.size();
+        ready_.insert(ready_.end(), remote_.begin(), remote_.end());
+        remote_.clear();
+        remote_pending_.store(false, std::memory_order_relaxed);
+    }
+
+    // Wakes up every task whose deadline has passed.
+    auto expire() noexcept -> void {
+        if (timers_.size() == 0) return;
+        auto now = clock::now();
+        auto ticks = static_cast<std::uint64_t>((now - start_) / timer_resolution);
+        timers_.advance(ticks, [&](timer_node& node) {
+            auto& s = static_cast<sleeper&>(node);
+            auto slack = std::chrono::duration_cast<std::chrono::nanoseconds>(now - s.due);
+            ++stats_.fired;
+            stats_.total_slack += slack;
+            stats_.max_slack = std::max(stats_.max_slack, slack);
+            auto j = static_cast<job*>(s.owner);
+            j->next_ = s.resume;
+            ready_.push_back(j);
+        });
+    }
+
+    // Returns the epoll timeout in milliseconds until the next timer, or -1 without timers.
+    [[nodiscard]]
+    auto timeout() const noexcept -> int {
+        auto next = timers_.next_expiry();
+        if (not next) return -1;
+        auto remaining = start_ + *next * timer_resolution - clock::now();
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+        return static_cast<int>(std::max<decltype(ms)>(ms, 0));
+    }
+
+    // Completes the operation in place if possible, and parks the current job otherwise.
+    template<effect E>
+    auto perform(E& eff, resumer<E>& resume, std::optional<waiter> fd_waiters::* slot) noexcept
+        -> std::coroutine_handle<> {
+        if (auto result = attempt(eff)) return resume.set_value(*result);
+        check(eff.fd >= 0);
+        auto index = static_cast<std::size_t>(eff.fd);
+        if (index >= waiters_.size()) waiters_.resize(index + 1);
+        auto& waiters = waiters_[index];
+        if (waiters.*slot) return resume.set_value(static_cast<typename E::return_type>(-EBUSY));
+        waiters.*slot = waiter{current_, &eff, &resume, &complete<E>};
+        ++parked_;
+        arm(eff.fd, waiters);
+        action_ = post_action::park;
+        return std::noop_coroutine();
+    }
+
+    auto arm(int fd, fd_waiters const& waiters) noexcept -> void {
+        auto ev = epoll_event{};
+        ev.events = EPOLLONESHOT | (waiters.in ? EPOLLIN : 0u) | (waiters.out ? EPOLLOUT : 0u);
+        ev.data.fd = fd;
+        if (::epoll_ctl(epoll_, EPOLL_CTL_MOD, fd, &ev) == 0) return;
+        check(errno == ENOENT);
+        check(::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &ev) == 0);
+    }
+
+    auto poll(int timeout) noexcept -> void {
+        auto events = std::array<epoll_event, max_events>{};
+        auto n = ::epoll_wait(epoll_, events.data(), max_events, timeout);
+        if (n < 0) {
+            check(errno == EINTR);
+            return;
+        }
+        for (auto& ev : std::span{events.data(), static_cast<std::size_t>(n)}) {
+            if (ev.data.fd == event_) {
+                auto count = std::uint64_t{};
+                check(::read(event_, &count, sizeof(count)) == sizeof(count));
+                continue;
+            }
+            auto& waiters = waiters_[static_cast<std::size_t>(ev.data.fd)];
+            // Errors and hang-ups are reported to whichever operation is waiting.
+            auto failed = (ev.events & (EPOLLERR | EPOLLHUP)) != 0;
+            if ((failed or (ev.events & EPOLLIN)) and waiters.in) wake(waiters.in);
+            if ((failed or (ev.events & EPOLLOUT)) and waiters.out) wake(waiters.out);
+            if (waiters.in or waiters.out) arm(ev.data.fd, waiters);
+        }
+    }
+
+    auto wake(std::optional<waiter>& w) noexcept -> void {
+        if (not w->complete(*w)) return;
+        ready_.push_back(w->owner);
+        w.reset();
+        --parked_;
+    }
+
+    auto execute(job* j) -> void {
+        current_ = j;
+        action_ = post_action::complete;
+        j->next_.resume();
+        switch (action_) {
+        case post_action::complete: finish(j); break;
+        case post_action::requeue: ready_.push_back(j); break;
+        case post_action::park: break;
+        case post_action::suspend:
+            ++suspended_;
+            parked_suspend_->fn(waker{j}, parked_suspend_->arg);
+            break;
+        }
+        current_ = nullptr;
+    }
+
+    auto finish(job* j) -> void {
+        check((*j->root_).done());
+        j->root_ = {};
+        for (auto w = j->close(); w;) {
+            auto next = w->next_waiter_;
+            ready_.push_back(w);
+            w = next;
+        }
+        j->release();
+        --live_;
+    }
+
+    std::array<evidence, 9> evidence_{
+        evidence{static_cast<handler<spawn>*>(this), nullptr},
+        evidence{static_cast<handler<yield_thread>*>(this), &evidence_[0]},
+        evidence{static_cast<handler<join>*>(this), &evidence_[1]},
+        evidence{static_cast<handler<net_accept>*>(this), &evidence_[2]},
+        evidence{static_cast<handler<net_read>*>(this), &evidence_[3]},
+        evidence{static_cast<handler<net_write>*>(this), &evidence_[4]},
+        evidence{static_cast<handler<sleep_for>*>(this), &evidence_[5]},
+        evidence{static_cast<handler<sleep_until>*>(this), &evidence_[6]},
+        evidence{static_cast<handler<suspend>*>(this), &evidence_[7]},
+    };
+    int epoll_;
+    int event_;
+    clock::time_point start_;
+    timer_wheel timers_;
+    timer_stats stats_;
+    std::deque<job*> ready_;
+    // Indexed by file descriptor.
+    std::vector<fd_waiters> waiters_;
+    std::mutex remote_mutex_;
+    std::vector<job*> remote_;
+    std::atomic<bool> remote_pending_{};
+    job* current_{};
+    suspend const* parked_suspend_{};
+    post_action action_{};
+    std::size_t live_{};
+    std::size_t parked_{};
+    std::size_t suspended_{};
+};
+
+} // namespace corofx::detail
+
+namespace corofx {
+
+reactor::reactor() : state_{std::make_unique<detail::reactor_state>()} {}
+
+reactor::~reactor() = default;
+
+auto reactor::timer_slack() const noexcept -> timer_stats { return state_->timer_slack(); }
+
+auto reactor::run_root(frame<> root, detail::bind_fn bind, void* output) -> void {
+    state_->run_root(std::move(root), bind, output);
+}
+
+} // namespace corofx
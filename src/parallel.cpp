@@ -0,0 +1,198 @@
+#include "corofx/parallel.hpp"
+
+#include "corofx/check.hpp"
+#include "corofx/detail/work_deque.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace corofx::detail {
+
+namespace {
+
+constexpr auto deque_capacity = std::size_t{256};
+// Splits made by one thread in one run. Further ranges run without splitting.
+constexpr auto max_splits = std::size_t{4096};
+constexpr auto max_grain = std::size_t{4096};
+
+struct range {
+    std::size_t first;
+    std::size_t last;
+};
+
+struct participant {
+    work_deque<range, deque_capacity> deque;
+    // Storage for the ranges pushed in the current run, which are never reused during it, so
+    // that a thief never reads a range that was overwritten.
+    std::unique_ptr<range[]> splits{std::make_unique<range[]>(max_splits)};
+    std::size_t used{};
+};
+
+// The run that workers join.
+struct work {
+    parallel_pool::chunk_fn fn;
+    void* ctx;
+    std::size_t grain;
+};
+
+} // namespace
+
+class parallel_state {
+public:
+    explicit parallel_state(std::size_t threads)
+        : participants_(std::max<std::size_t>(threads, 1)) {
+        for (auto& p : participants_) p = std::make_unique<participant>();
+        for (auto i = std::size_t{}; i + 1 < participants_.size(); ++i) {
+            workers_.emplace_back([this, i] { work_loop(i); });
+        }
+    }
+
+    parallel_state(parallel_state const&) = delete;
+    parallel_state(parallel_state&&) = delete;
+    auto operator=(parallel_state const&) -> parallel_state& = delete;
+    auto operator=(parallel_state&&) -> parallel_state& = delete;
+
+    ~parallel_state() {
+        {
+            auto lock = std::lock_guard{mutex_};
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (auto& w : workers_) w.join();
+    }
+
+    auto run(std::size_t first, std::size_t last, parallel_pool::chunk_fn fn, void* ctx) -> void {
+        if (first >= last) return;
+        auto turn = std::lock_guard{run_mutex_};
+        auto self = participants_.size() - 1;
+        auto n = last - first;
+        auto w = work{
+            .fn = fn,
+            .ctx = ctx,
+            .grain = std::clamp<std::size_t>(n / (participants_.size() * 8), 1, max_grain),
+        };
+        if (workers_.empty() or n <= w.grain) {
+            fn(ctx, self, first, last);
+            return;
+        }
+        {
+            auto lock = std::unique_lock{mutex_};
+            // Workers still in the previous run would see this one's ranges with its function.
+            idle_.wait(lock, [&] { return busy_ == 0; });
+            work_ = w;
+            remaining_.store(n, std::memory_order_relaxed);
+            ++epoch_;
+        }
+        start_.notify_all();
+        participants_[self]->used = 0;
+        run_range(self, w, {.first = first, .last = last});
+        help(self, w);
+    }
+
+    [[nodiscard]]
+    auto threads() const noexcept -> std::size_t {
+        return participants_.size();
+    }
+
+private:
+    auto work_loop(std::size_t self) -> void {
+        auto seen = std::uint64_t{};
+        while (true) {
+            auto w = work{};
+            {
+                auto lock = std::unique_lock{mutex_};
+                start_.wait(lock, [&] { return stop_ or epoch_ != seen; });
+                if (stop_) return;
+                seen = epoch_;
+                w = work_;
+                ++busy_;
+            }
+            participants_[self]->used = 0;
+            help(self, w);
+            {
+                auto lock = std::lock_guard{mutex_};
+                --busy_;
+            }
+            idle_.notify_all();
+        }
+    }
+
+    // Runs ranges from the own deque or stolen from others until the run is over.
+    auto help(std::size_t self, work const& w) -> void {
+        auto& me = *participants_[self];
+        while (remaining_.load(std::memory_order_acquire) > 0) {
+            auto* r = me.deque.pop();
+            for (auto i = std::size_t{1}; r == nullptr and i < participants_.size(); ++i) {
+                r = participants_[(self + i) % participants_.size()]->deque.steal();
+            }
+            if (r) {
+                run_range(self, w, *r);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Runs a range chunk by chunk, giving half of what is left away whenever the own deque is
+    // empty.
+    auto run_range(std::size_t self, work const& w, range r) -> void {
+        auto& me = *participants_[self];
+        while (r.first < r.last) {
+            auto n = r.last - r.first;
+            if (n > w.grain and me.used < max_splits and me.deque.empty()) {
+                auto mid = r.first + n / 2;
+                auto& half = me.splits[me.used];
+                half = {.first = mid, .last = r.last};
+                if (me.deque.push(&half)) {
+                    ++me.used;
+                    r.last = mid;
+                    continue;
+                }
+            }
+            auto chunk = std::min(n, w.grain);
+            w.fn(w.ctx, self, r.first, r.first + chunk);
+            r.first += chunk;
+            remaining_.fetch_sub(chunk, std::memory_order_acq_rel);
+        }
+    }
+
+    std::vector<std::unique_ptr<participant>> participants_;
+    std::vector<std::thread> workers_;
+    std::mutex run_mutex_;
+
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable idle_;
+    bool stop_{};
+    std::uint64_t epoch_{};
+    std::size_t busy_{};
+    work work_{};
+
+    std::atomic<std::size_t> remaining_;
+};
+
+} // namespace corofx::detail
+
+namespace corofx {
+
+parallel_pool::parallel_pool(std::size_t threads)
+    : state_{std::make_unique<detail::parallel_state>(threads)} {}
+
+parallel_pool::~parallel_pool() = default;
+
+auto parallel_pool::run(std::size_t first, std::size_t last, chunk_fn fn, void* ctx) -> void {
+    state_->run(first, last, fn, ctx);
+}
+
+auto parallel_pool::threads() const noexcept -> std::size_t {
+    return state_->threads();
+}
+
+} // namespace corofx
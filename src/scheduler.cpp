@@ -0,0 +1,299 @@
+#include "corofx/scheduler.hpp"
+
+#include "corofx/check.hpp"
+#include "corofx/detail/job.hpp"
+#include "corofx/detail/work_deque.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace corofx::detail {
+
+namespace {
+
+constexpr auto deque_capacity = std::size_t{4096};
+constexpr auto spin_rounds = 32;
+
+struct worker {
+    work_deque<job, deque_capacity> deque;
+    std::uint64_t rng;
+};
+
+// What a worker does with the current job once it stops running.
+enum class post_action : std::uint8_t {
+    complete,
+    requeue,
+    wait,
+    suspend,
+};
+
+struct worker_context {
+    scheduler_state const* owner;
+    worker* self;
+    job* current;
+    job* target;
+    suspend const* parked;
+    post_action action;
+};
+
+constinit thread_local worker_context context{};
+
+[[nodiscard]]
+auto next_random(std::uint64_t& state) noexcept -> std::uint64_t {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+} // namespace
+
+class scheduler_state final
+    : public handler<spawn>
+    , public handler<yield_thread>
+    , public handler<join>
+    , public handler<suspend>
+    , public executor {
+public:
+    explicit scheduler_state(std::size_t threads) {
+        workers_.reserve(threads);
+        for (auto i = std::size_t{}; i < threads; ++i) {
+            workers_.push_back(std::make_unique<worker>());
+            workers_.back()->rng = (i + 1) * 0x9e3779b97f4a7c15;
+        }
+        threads_.reserve(threads);
+        for (auto i = std::size_t{}; i < threads; ++i) {
+            threads_.emplace_back([this, i] { work(*workers_[i]); });
+        }
+    }
+
+    scheduler_state(scheduler_state const&) = delete;
+    scheduler_state(scheduler_state&&) = delete;
+    auto operator=(scheduler_state const&) -> scheduler_state& = delete;
+    auto operator=(scheduler_state&&) -> scheduler_state& = delete;
+
+    ~scheduler_state() {
+        stop_.store(true, std::memory_order_release);
+        epoch_.fetch_add(1, std::memory_order_release);
+        epoch_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    [[nodiscard]]
+    auto threads() const noexcept -> std::size_t {
+        return threads_.size();
+    }
+
+    auto run_root(frame<> root, bind_fn bind, void* output) -> void {
+        check(context.owner != this);
+        auto j = new job{std::move(root), 1, this};
+        check(bind(*j->root_, &evidence_.back(), output));
+        live_.fetch_add(1, std::memory_order_relaxed);
+        inject(j);
+        for (auto n = live_.load(std::memory_order_acquire); n != 0;
+             n = live_.load(std::memory_order_acquire)) {
+            live_.wait(n, std::memory_order_acquire);
+        }
+    }
+
+    auto handle(spawn&& eff, resumer<spawn>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        auto j = new job{std::move(eff.frame_), 2, this};
+        check(eff.bind_(*j->root_, &evidence_.back(), &j->output_));
+        live_.fetch_add(1, std::memory_order_relaxed);
+        auto handle = job_handle{j};
+        schedule(j);
+        return resume.set_value(std::move(handle));
+    }
+
+    auto handle(yield_thread&&, resumer<yield_thread>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        context.current->next_ = resume.set_value();
+        context.action = post_action::requeue;
+        return std::noop_coroutine();
+    }
+
+    auto handle(join&& eff, resumer<join>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        auto target = eff.job.job_;
+        check(target != nullptr and target != context.current);
+        if (target->done()) return resume.set_value();
+        // The waiter is registered only after the job has fully suspended, so that it cannot be
+        // resumed on another worker while still running on this one.
+        context.current->next_ = resume.set_value();
+        context.target = target;
+        context.action = post_action::wait;
+        return std::noop_coroutine();
+    }
+
+    auto handle(suspend&& eff, resumer<suspend>& resume, frame<>&) noexcept
+        -> std::coroutine_handle<> override {
+        // The effect stays alive in the suspended frame until the job is woken.
+        context.current->next_ = resume.set_value();
+        context.parked = &eff;
+        context.action = post_action::suspend;
+        return std::noop_coroutine();
+    }
+
+    auto wake(job* j) noexcept -> void override { schedule(j); }
+
+private:
+    auto work(worker& self) -> void {
+        context = {
+            .owner = this,
+            .self = &self,
+            .current = {},
+            .target = {},
+            .parked = {},
+            .action = {},
+        };
+        while (true) {
+            if (auto j = find_work(self)) {
+                execute(j);
+                continue;
+            }
+            auto j = static_cast<job*>(nullptr);
+            for (auto i = 0; i < spin_rounds and not j; ++i) {
+                std::this_thread::yield();
+                j = find_work(self);
+            }
+            if (not j) {
+                sleepers_.fetch_add(1, std::memory_order_seq_cst);
+                auto epoch = epoch_.load(std::memory_order_seq_cst);
+                j = find_work(self);
+                if (not j and not stop_.load(std::memory_order_acquire)) epoch_.wait(epoch);
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            if (j) {
+                execute(j);
+            } else if (stop_.load(std::memory_order_acquire)) {
+                break;
+            }
+        }
+        context = {};
+    }
+
+    [[nodiscard]]
+    auto find_work(worker& self) -> job* {
+        if (auto j = self.deque.pop()) return j;
+        if (injected_size_.load(std::memory_order_relaxed) != 0) {
+            auto lock = std::lock_guard{inject_mutex_};
+            if (not injected_.empty()) {
+                auto j = injected_.front();
+                injected_.pop_front();
+                injected_size_.fetch_sub(1, std::memory_order_relaxed);
+                return j;
+            }
+        }
+        auto n = workers_.size();
+        auto start = static_cast<std::size_t>(next_random(self.rng) % n);
+        for (auto i = std::size_t{}; i < n; ++i) {
+            auto& victim = *workers_[(start + i) % n];
+            if (&victim == &self) continue;
+            if (auto j = victim.deque.steal()) return j;
+        }
+        return nullptr;
+    }
+
+    auto execute(job* j) -> void {
+        context.current = j;
+        context.action = post_action::complete;
+        j->next_.resume();
+        switch (context.action) {
+        case post_action::complete: complete(j); break;
+        // Yielded jobs go to the back of the shared queue, behind every other ready job.
+        case post_action::requeue: inject(j); break;
+        case post_action::wait:
+            if (not context.target->add_waiter(j)) schedule(j);
+            break;
+        case post_action::suspend: context.parked->fn(waker{j}, context.parked->arg); break;
+        }
+        context.current = nullptr;
+    }
+
+    auto complete(job* j) -> void {
+        check((*j->root_).done());
+        j->root_ = {};
+        for (auto w = j->close(); w;) {
+            auto next = w->next_waiter_;
+            schedule(w);
+            w = next;
+        }
+        j->release();
+        if (live_.fetch_sub(1, std::memory_order_acq_rel) == 1) live_.notify_all();
+    }
+
+    auto schedule(job* j) -> void {
+        if (context.owner == this and context.self->deque.push(j)) {
+            wake();
+            return;
+        }
+        inject(j);
+    }
+
+    auto inject(job* j) -> void {
+        {
+            auto lock = std::lock_guard{inject_mutex_};
+            injected_.push_back(j);
+            injected_size_.fetch_add(1, std::memory_order_relaxed);
+        }
+        wake();
+    }
+
+    auto wake() noexcept -> void {
+        // An RMW orders the preceding push before a sleeper's final check for work.
+        if (sleepers_.fetch_add(0, std::memory_order_seq_cst) == 0) return;
+        epoch_.fetch_add(1, std::memory_order_release);
+        epoch_.notify_one();
+    }
+
+    std::array<evidence, 4> evidence_{
+        evidence{static_cast<handler<spawn>*>(this), nullptr},
+        evidence{static_cast<handler<yield_thread>*>(this), &evidence_[0]},
+        evidence{static_cast<handler<join>*>(this), &evidence_[1]},
+        evidence{static_cast<handler<suspend>*>(this), &evidence_[2]},
+    };
+    std::vector<std::unique_ptr<worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::mutex inject_mutex_;
+    std::deque<job*> injected_;
+    std::atomic<std::size_t> injected_size_{};
+    std::atomic<std::uint32_t> epoch_{};
+    std::atomic<std::size_t> sleepers_{};
+    std::atomic<std::size_t> live_{};
+    std::atomic<bool> stop_{};
+};
+
+} // namespace corofx::detail
+
+namespace corofx {
+
+job_handle::job_handle(job_handle const& that) noexcept : job_{that.job_} {
+    if (job_) job_->retain();
+}
+
+job_handle::~job_handle() {
+    if (job_) job_->release();
+}
+
+auto job_handle::done() const noexcept -> bool { return job_ and job_->done(); }
+
+auto waker::wake() const noexcept -> void { job_->owner_->wake(job_); }
+
+scheduler::scheduler(std::size_t threads)
+    : state_{std::make_unique<detail::scheduler_state>(std::max(threads, std::size_t{1}))} {}
+
+scheduler::~scheduler() = default;
+
+auto scheduler::threads() const noexcept -> std::size_t { return state_->threads(); }
+
+auto scheduler::run_root(frame<> root, detail::bind_fn bind, void* output) -> void {
+    state_->run_root(std::move(root), bind, output);
+}
+
+} // namespace corofx
@@ -0,0 +1,106 @@
+#include "corofx/sync.hpp"
+
+#include "corofx/check.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace corofx::detail {
+
+namespace {
+
+// Reverses a stack of waiters into the order they started waiting.
+[[nodiscard]]
+auto oldest_first(sync_waiter* stack) noexcept -> sync_waiter* {
+    auto fifo = static_cast<sync_waiter*>(nullptr);
+    while (stack) {
+        auto next = stack->next;
+        stack->next = fifo;
+        fifo = stack;
+        stack = next;
+    }
+    return fifo;
+}
+
+} // namespace
+
+auto sync_queue::park(waker w, void* waiter) noexcept -> void {
+    auto& self = *static_cast<sync_waiter*>(waiter);
+    auto& q = *static_cast<sync_queue*>(self.target);
+    self.w = w;
+    auto s = q.state_.load(std::memory_order_relaxed);
+    while (true) {
+        // A permit was returned since the task failed to take one.
+        if (s & 1 and s != tag(0)) {
+            if (q.state_.compare_exchange_weak(
+                    s, s - 2, std::memory_order_acquire, std::memory_order_relaxed)) {
+                w.wake();
+                return;
+            }
+            continue;
+        }
+        self.next = s & 1 ? nullptr : reinterpret_cast<sync_waiter*>(s);
+        // The task may be woken and gone as soon as it is pushed.
+        if (q.state_.compare_exchange_weak(
+                s,
+                reinterpret_cast<std::uintptr_t>(&self),
+                std::memory_order_release,
+                std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+auto sync_queue::release_one() noexcept -> void {
+    if (not fifo_) {
+        auto s = state_.load(std::memory_order_relaxed);
+        while (s & 1) {
+            if (state_.compare_exchange_weak(
+                    s, s + 2, std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        // Only releases add permits, so the state stays a stack until it is taken.
+        s = state_.exchange(tag(0), std::memory_order_acquire);
+        check((s & 1) == 0);
+        fifo_ = oldest_first(reinterpret_cast<sync_waiter*>(s));
+    }
+    auto next = fifo_;
+    fifo_ = next->next;
+    next->w.wake();
+}
+
+auto latch_state::park(waker w, void* waiter) noexcept -> void {
+    auto& self = *static_cast<sync_waiter*>(waiter);
+    auto& l = *static_cast<latch_state*>(self.target);
+    self.w = w;
+    auto s = l.waiters_.load(std::memory_order_acquire);
+    while (true) {
+        if (s == released) {
+            w.wake();
+            return;
+        }
+        self.next = reinterpret_cast<sync_waiter*>(s);
+        if (l.waiters_.compare_exchange_weak(
+                s,
+                reinterpret_cast<std::uintptr_t>(&self),
+                std::memory_order_release,
+                std::memory_order_acquire)) {
+            return;
+        }
+    }
+}
+
+auto latch_state::release_all() noexcept -> void {
+    auto s = waiters_.exchange(released, std::memory_order_acq_rel);
+    // `count_down(0)` on a latch at zero releases it again.
+    if (s == released) return;
+    for (auto w = oldest_first(reinterpret_cast<sync_waiter*>(s)); w;) {
+        // A woken task may be gone before the next one is woken.
+        auto next = w->next;
+        w->w.wake();
+        w = next;
+    }
+}
+
+} // namespace corofx::detail
@@ -0,0 +1,223 @@
+#include "corofx/tracing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace corofx::tracing {
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+constexpr auto default_capacity = std::size_t{1} << 16;
+
+// Relates ticks of `detail::now()` to the steady clock.
+struct clock_point {
+    std::uint64_t ticks;
+    clock::time_point time;
+
+    [[nodiscard]]
+    static auto now() noexcept -> clock_point {
+        return {.ticks = detail::now(), .time = clock::now()};
+    }
+};
+
+// Rings are kept after their thread exits until a snapshot has collected their events, and are
+// then reused by threads that start recording later.
+struct registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<detail::ring>> rings;
+    // Rings of exited threads that are still to be collected.
+    std::vector<detail::ring*> exited;
+    std::vector<std::unique_ptr<detail::ring>> free;
+    std::uint32_t threads{};
+    clock_point start{clock_point::now()};
+};
+
+constinit std::atomic<std::size_t> capacity{default_capacity};
+
+[[nodiscard]]
+auto get_registry() -> registry& {
+    static auto r = registry{};
+    return r;
+}
+
+} // namespace
+
+namespace detail {
+
+ring::ring(std::size_t capacity, std::uint32_t thread)
+    : slots_{std::make_unique<slot[]>(capacity)}, mask_{capacity - 1}, head_{}, thread_{thread} {}
+
+namespace {
+
+// Set once the thread has handed its ring back. Events recorded afterwards, by destructors of other
+// thread-local objects, go to a ring that is never reused.
+constinit thread_local bool exiting{};
+
+// Hands the ring of the calling thread back to the registry when the thread exits.
+class ring_owner {
+public:
+    constexpr ring_owner() noexcept = default;
+
+    ring_owner(ring_owner const&) = delete;
+    ring_owner(ring_owner&&) = delete;
+    auto operator=(ring_owner const&) -> ring_owner& = delete;
+    auto operator=(ring_owner&&) -> ring_owner& = delete;
+
+    ~ring_owner() {
+        exiting = true;
+        if (not ring_) return;
+        auto& r = get_registry();
+        auto lock = std::lock_guard{r.mutex};
+        r.exited.push_back(ring_);
+        local_ring = nullptr;
+    }
+
+    [[nodiscard]]
+    auto get() const noexcept -> ring* {
+        return ring_;
+    }
+
+    auto set(ring* ring) noexcept -> void { ring_ = ring; }
+
+private:
+    ring* ring_{};
+};
+
+constinit thread_local ring_owner owner{};
+
+} // namespace
+
+auto attach() -> ring* {
+    if (not exiting and owner.get()) return owner.get();
+    auto& r = get_registry();
+    auto lock = std::lock_guard{r.mutex};
+    auto id = r.threads++;
+    auto size = capacity.load();
+    while (not r.free.empty() and r.free.back()->capacity() != size) r.free.pop_back();
+    auto& mine = r.rings.emplace_back();
+    if (r.free.empty()) {
+        mine = std::make_unique<ring>(size, id);
+    } else {
+        mine = std::move(r.free.back());
+        r.free.pop_back();
+        mine->reset(id);
+    }
+    if (not exiting) owner.set(mine.get());
+    return mine.get();
+}
+
+} // namespace detail
+
+auto set_buffer_capacity(std::size_t events) noexcept -> void {
+    capacity.store(std::bit_ceil(std::max(events, std::size_t{2})));
+}
+
+auto snapshot() -> std::vector<event> {
+    auto& r = get_registry();
+    auto lock = std::lock_guard{r.mutex};
+    auto end = clock_point::now();
+    auto elapsed = std::chrono::duration<double, std::nano>{end.time - r.start.time}.count();
+    auto ns_per_tick = end.ticks > r.start.ticks
+                           ? elapsed / static_cast<double>(end.ticks - r.start.ticks)
+                           : 1.0;
+    auto res = std::vector<event>{};
+    for (auto const& ring : r.rings) {
+        auto capacity = ring->mask_ + 1;
+        auto head = ring->head_.load(std::memory_order_acquire);
+        auto first = head > capacity ? head - capacity : 0;
+        auto begin = res.size();
+        for (auto i = first; i < head; ++i) {
+            auto const& s = ring->slots_[i & ring->mask_];
+            auto ticks = s.time.load(std::memory_order_relaxed);
+            auto name = s.name.load(std::memory_order_relaxed);
+            res.push_back({
+                .time = ticks > r.start.ticks ? static_cast<std::uint64_t>(
+                                                    static_cast<double>(ticks - r.start.ticks) *
+                                                    ns_per_tick)
+                                              : 0,
+                .thread = ring->thread_,
+                .kind = s.kind.load(std::memory_order_relaxed),
+                .frame = s.frame.load(std::memory_order_relaxed),
+                .name = name ? name->name : std::string_view{},
+            });
+        }
+        // Drops the events that were overwritten while they were read.
+        auto last = ring->head_.load(std::memory_order_acquire);
+        if (last > first + capacity) {
+            auto overwritten = std::min<std::size_t>(last - first - capacity, res.size() - begin);
+            res.erase(res.begin() + static_cast<std::ptrdiff_t>(begin),
+                      res.begin() + static_cast<std::ptrdiff_t>(begin + overwritten));
+        }
+    }
+    // The events of exited threads are only collected once.
+    for (auto* exited : r.exited) {
+        auto it = std::find_if(r.rings.begin(), r.rings.end(), [&](auto const& ring) {
+            return ring.get() == exited;
+        });
+        r.free.push_back(std::move(*it));
+        r.rings.erase(it);
+    }
+    r.exited.clear();
+    std::stable_sort(res.begin(), res.end(), [](auto const& a, auto const& b) {
+        return a.time < b.time;
+    });
+    return res;
+}
+
+// The file starts with the magic `corofx-trace-v1\0`, followed by the names and the events:
+//   u32 name count, then for each name: u32 size and its bytes,
+//   u64 event count, then for each event: u64 time (ns), u64 frame, u32 thread,
+//   u32 name index (0xffffffff for none), u8 kind and 7 bytes of padding.
+// All integers are in the byte order of the machine that recorded them.
+auto dump(char const* path) -> bool {
+    auto events = snapshot();
+    auto names = std::vector<std::string_view>{};
+    auto indices = std::unordered_map<std::string_view, std::uint32_t>{};
+    for (auto const& e : events) {
+        if (e.name.empty()) continue;
+        auto index = static_cast<std::uint32_t>(names.size());
+        if (indices.try_emplace(e.name, index).second) names.push_back(e.name);
+    }
+
+    using file_ptr = std::unique_ptr<std::FILE, int (*)(std::FILE*)>;
+    auto file = file_ptr{std::fopen(path, "wb"), std::fclose};
+    if (not file) return false;
+    auto ok = true;
+    auto write = [&](void const* data, std::size_t size) {
+        ok = ok and std::fwrite(data, 1, size, file.get()) == size;
+    };
+    auto write_int = [&](auto value) { write(&value, sizeof(value)); };
+
+    constexpr char magic[16] = "corofx-trace-v1";
+    write(magic, sizeof(magic));
+    write_int(static_cast<std::uint32_t>(names.size()));
+    for (auto name : names) {
+        write_int(static_cast<std::uint32_t>(name.size()));
+        write(name.data(), name.size());
+    }
+    write_int(static_cast<std::uint64_t>(events.size()));
+    for (auto const& e : events) {
+        constexpr char padding[7] = {};
+        write_int(e.time);
+        write_int(static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(e.frame)));
+        write_int(e.thread);
+        write_int(e.name.empty() ? ~std::uint32_t{} : indices[e.name]);
+        write_int(static_cast<std::uint8_t>(e.kind));
+        write(padding, sizeof(padding));
+    }
+    return std::fclose(file.release()) == 0 and ok;
+}
+
+} // namespace corofx::tracing
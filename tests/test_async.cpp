@@ -0,0 +1,56 @@
+#include "corofx/check.hpp"
+#include "corofx/task.hpp"
+
+#include <coroutine>
+#include <utility>
+
+using namespace corofx;
+
+struct ask {
+    using return_type = int;
+
+    int x{};
+};
+
+struct stop {
+    using return_type = void;
+};
+
+auto producer() -> task<int, ask> {
+    auto a = co_await ask{1};
+    auto b = co_await ask{2};
+    co_return a + b;
+}
+
+auto main() -> int {
+    auto parked = std::coroutine_handle<>{};
+    auto result = 0;
+    auto stopped = false;
+    auto consumer = [&]() -> task<void, stop> {
+        result = co_await producer().with(
+            async_handler_of<ask>([&](ask&& e, resumer<ask>& resume) -> std::coroutine_handle<> {
+                parked = resume.set_value(e.x * 10);
+                return std::noop_coroutine();
+            }));
+        co_await stop{};
+        co_return {};
+    };
+
+    // The producer is parked on every effect and resumed from outside.
+    // The consumer is never resumed after `stop`, and is destroyed while parked.
+    auto t = consumer().with(
+        async_handler_of<stop>([&](stop&&, resumer<stop>&) -> std::coroutine_handle<> {
+            stopped = true;
+            return std::noop_coroutine();
+        }));
+    std::move(t)();
+    auto resumes = 0;
+    while (auto k = std::exchange(parked, {})) {
+        check(result == 0);
+        ++resumes;
+        k.resume();
+    }
+    check(resumes == 2);
+    check(result == 30);
+    check(stopped);
+}
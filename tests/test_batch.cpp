@@ -0,0 +1,99 @@
+#include "corofx/batch.hpp"
+#include "corofx/check.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+using namespace corofx;
+
+struct fetch {
+    using return_type = int;
+
+    int key{};
+};
+
+auto fetch_twice(int key) -> task<int, fetch> {
+    auto a = co_await fetch{key};
+    auto b = co_await fetch{a};
+    co_return b;
+}
+
+template<typename H>
+auto worker(int key, H batcher, int* out) -> task<void, yield_thread, suspend> {
+    *out = co_await fetch_twice(key).with(batcher);
+    co_return {};
+}
+
+template<typename H>
+auto fan_out(H batcher, std::vector<int>* out) -> task<void, spawn, yield_thread, join> {
+    auto handles = std::vector<job_handle>{};
+    for (auto i = std::size_t{}; i < out->size(); ++i) {
+        handles.push_back(
+            co_await spawn{worker(static_cast<int>(i), batcher, &(*out)[i])});
+    }
+    for (auto& h : handles) co_await join{h};
+    co_return {};
+}
+
+auto calls = std::atomic<int>{};
+
+auto bulk = [](std::span<fetch const> effects) {
+    ++calls;
+    auto results = std::vector<int>{};
+    for (auto const& e : effects) results.push_back(e.key + 1);
+    return results;
+};
+
+auto check_results(std::vector<int> const& out) -> void {
+    for (auto i = std::size_t{}; i < out.size(); ++i) check(out[i] == static_cast<int>(i) + 2);
+}
+
+auto main() -> int {
+    {
+        // Tasks spawned together share one bulk call per round of effects.
+        calls = 0;
+        auto sched = scheduler{1};
+        auto batcher = batch_handler_of<fetch>(bulk);
+        auto out = std::vector<int>(10);
+        sched.run(fan_out(batcher, &out));
+        check_results(out);
+        check(calls == 2);
+        check(batcher.stats().batches == 2 and batcher.stats().effects == 20);
+    }
+
+    {
+        // Full batches are sent right away.
+        calls = 0;
+        auto sched = scheduler{1};
+        auto batcher = batch_handler_of<fetch>(bulk, {.max_size = 4});
+        auto out = std::vector<int>(10);
+        sched.run(fan_out(batcher, &out));
+        check_results(out);
+        check(calls == 6);
+    }
+
+    {
+        // A task on its own sends a batch of one.
+        calls = 0;
+        auto sched = scheduler{1};
+        auto batcher = batch_handler_of<fetch>(bulk);
+        auto out = std::vector<int>(1);
+        sched.run(fan_out(batcher, &out));
+        check(out[0] == 2 and calls == 2);
+    }
+
+    for (auto threads : {2, 4}) {
+        // Results reach the right tasks when batches are filled from several threads.
+        calls = 0;
+        auto sched = scheduler{static_cast<std::size_t>(threads)};
+        auto batcher = batch_handler_of<fetch>(bulk);
+        auto out = std::vector<int>(100);
+        sched.run(fan_out(batcher, &out));
+        check_results(out);
+        check(batcher.stats().effects == 200);
+    }
+}
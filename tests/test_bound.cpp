@@ -0,0 +1,68 @@
+#include "corofx/check.hpp"
+#include "corofx/task.hpp"
+
+#include <type_traits>
+#include <utility>
+
+using namespace corofx;
+
+struct get {
+    using return_type = int;
+};
+
+struct bar {
+    using return_type = int;
+
+    int x{};
+};
+
+constexpr auto marker0 = __LINE__;
+constexpr auto marker1 = __LINE__;
+constexpr auto marker2 = __LINE__;
+
+auto get_handler = tail_handler_of<get>([](get&&) { return marker0; });
+auto bar_handler = handler_of<bar>([](auto&& e, auto&& resume) -> task<int> {
+    co_return resume(e.x + marker1);
+});
+
+using get_handler_type = decltype(get_handler);
+using bar_handler_type = decltype(bar_handler);
+
+// Effects through bound entries are dispatched to the concrete handler type.
+static_assert(std::is_same_v<
+              decltype(std::declval<task<int, bound<get_handler_type>>::promise_type&>()
+                           .await_transform(get{})),
+              effect_awaiter<get, get_handler_type>>);
+static_assert(std::is_same_v<
+              decltype(std::declval<task<int, get>::promise_type&>().await_transform(get{})),
+              effect_awaiter<get>>);
+
+auto do_get() -> task<int, get> { co_return co_await get{}; }
+
+auto do_bound() -> task<int, bound<get_handler_type>, bound<bar_handler_type>> {
+    auto x = co_await get{};
+    auto y = co_await bar{x};
+    // Tasks with unbound entries are handled through the same handlers.
+    auto z = co_await do_get();
+    co_return x + y + z;
+}
+
+auto do_bound_outer() -> task<int, bound<get_handler_type>, bound<bar_handler_type>> {
+    co_return co_await do_bound();
+}
+
+auto do_mixed() -> task<int, bound<get_handler_type>, bar> {
+    co_return co_await get{} + co_await bar{marker2};
+}
+
+auto main() -> int {
+    constexpr auto expected = marker0 + (marker0 + marker1) + marker0;
+    check(do_bound().with(get_handler, bar_handler)() == expected);
+    check(do_bound_outer().with(bar_handler, get_handler)() == expected);
+
+    auto mixed = []() -> task<int, bar> { co_return co_await do_mixed().with(get_handler); };
+    auto res = mixed().with(handler_of<bar>([](auto&& e, auto&& resume) -> task<int> {
+        co_return resume(e.x);
+    }));
+    check(std::move(res)() == marker0 + marker2);
+}
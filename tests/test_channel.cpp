@@ -0,0 +1,168 @@
+#include "corofx/channel.hpp"
+#include "corofx/check.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <variant>
+#include <vector>
+
+using namespace corofx;
+
+auto produce(channel<int>& ch, int first, int count) -> task<void, suspend> {
+    for (auto i = first; i < first + count; ++i) check(co_await send(ch, i));
+    co_return {};
+}
+
+auto consume(channel<int>& ch, std::int64_t* sum, int* received) -> task<void, suspend> {
+    while (auto value = co_await recv(ch)) {
+        *sum += *value;
+        ++*received;
+    }
+    co_return {};
+}
+
+// Producers and consumers share a channel much smaller than the number of values, so that both
+// sides park repeatedly.
+auto exchange(channel<int>& ch, int producers, int consumers, int per_producer)
+    -> task<void, spawn, join, suspend> {
+    auto sums = std::vector<std::int64_t>(static_cast<std::size_t>(consumers));
+    auto counts = std::vector<int>(static_cast<std::size_t>(consumers));
+    auto consuming = std::vector<job_handle>{};
+    for (auto i = std::size_t{}; i < sums.size(); ++i) {
+        consuming.push_back(co_await spawn{consume(ch, &sums[i], &counts[i])});
+    }
+    auto producing = std::vector<job_handle>{};
+    for (auto i = 0; i < producers; ++i) {
+        producing.push_back(co_await spawn{produce(ch, i * per_producer, per_producer)});
+    }
+    for (auto& h : producing) co_await join{h};
+    ch.close();
+    for (auto& h : consuming) co_await join{h};
+
+    auto n = static_cast<std::int64_t>(producers) * per_producer;
+    auto sum = std::int64_t{};
+    auto received = 0;
+    for (auto s : sums) sum += s;
+    for (auto c : counts) received += c;
+    check(received == n);
+    check(sum == n * (n - 1) / 2);
+    co_return {};
+}
+
+auto select_both(channel<int>& ints, channel<std::unique_ptr<int>>& ptrs, int* total)
+    -> task<void, suspend> {
+    while (auto value = co_await select(ints, ptrs)) {
+        if (value->index() == 0) {
+            *total += std::get<0>(*value);
+        } else {
+            *total += *std::get<1>(*value);
+        }
+    }
+    co_return {};
+}
+
+auto feed(channel<int>& ints, channel<std::unique_ptr<int>>& ptrs)
+    -> task<void, spawn, join, suspend> {
+    auto total = 0;
+    auto selecting = co_await spawn{select_both(ints, ptrs, &total)};
+    for (auto i = 1; i <= 100; ++i) {
+        check(co_await send(ints, i));
+        check(co_await send(ptrs, std::make_unique<int>(i * 1000)));
+    }
+    ints.close();
+    ptrs.close();
+    co_await join{selecting};
+    check(total == 5050 * 1001);
+    co_return {};
+}
+
+auto select_once(channel<int>& a, channel<int>& b, bool* parked, int* got) -> task<void, suspend> {
+    *parked = true;
+    auto value = co_await select(a, b);
+    check(value.has_value());
+    *got = value->index() == 0 ? std::get<0>(*value) : std::get<1>(*value);
+    co_return {};
+}
+
+auto recv_once(channel<int>& ch, bool* parked, int* got) -> task<void, suspend> {
+    *parked = true;
+    auto value = co_await recv(ch);
+    check(value.has_value());
+    *got = *value;
+    co_return {};
+}
+
+// A value sent to `b` wakes the selector parked first, which then takes the value from `a`
+// instead. The receiver parked on `b` must still get the value left there.
+auto competing_receivers() -> task<void, spawn, join, yield_thread, suspend> {
+    auto a = channel<int>{2};
+    auto b = channel<int>{2};
+    auto selector_parked = false;
+    auto receiver_parked = false;
+    auto selected = 0;
+    auto received = 0;
+    auto selecting = co_await spawn{select_once(a, b, &selector_parked, &selected)};
+    while (not selector_parked) co_await yield_thread{};
+    auto receiving = co_await spawn{recv_once(b, &receiver_parked, &received)};
+    while (not receiver_parked) co_await yield_thread{};
+    auto one = 1;
+    auto two = 2;
+    check(b.try_send(two) == send_status::sent);
+    check(a.try_send(one) == send_status::sent);
+    co_await join{selecting};
+    co_await join{receiving};
+    check(selected == 1);
+    check(received == 2);
+    co_return {};
+}
+
+auto main() -> int {
+    {
+        // Non-blocking operations.
+        auto ch = channel<int>{3};
+        check(ch.capacity() == 4);
+        check(not ch.try_recv());
+        for (auto i = 0; i < 4; ++i) {
+            auto value = i;
+            check(ch.try_send(value) == send_status::sent);
+        }
+        auto value = 4;
+        check(ch.try_send(value) == send_status::full);
+        check(ch.try_recv() == 0);
+        ch.close();
+        check(ch.try_send(value) == send_status::closed);
+        // Values sent before closing can still be received.
+        check(ch.try_recv() == 1);
+        check(ch.try_recv() == 2);
+        check(ch.try_recv() == 3);
+        check(not ch.try_recv());
+    }
+
+    {
+        // Values left in the channel are destroyed with it.
+        auto ch = channel<std::unique_ptr<int>>{2};
+        auto value = std::make_unique<int>(1);
+        check(ch.try_send(value) == send_status::sent);
+        check(not value);
+    }
+
+    {
+        auto sched = scheduler{1};
+        sched.run(competing_receivers());
+    }
+
+    for (auto threads : {1, 2, 4}) {
+        auto sched = scheduler{static_cast<std::size_t>(threads)};
+        for (auto [producers, consumers] : {std::pair{1, 1}, {4, 1}, {4, 4}}) {
+            auto ch = channel<int>{4};
+            sched.run(exchange(ch, producers, consumers, 10'000));
+        }
+
+        auto ints = channel<int>{2};
+        auto ptrs = channel<std::unique_ptr<int>>{2};
+        sched.run(feed(ints, ptrs));
+    }
+}
@@ -0,0 +1,90 @@
+#include "corofx/check.hpp"
+#include "corofx/file.hpp"
+#include "corofx/task.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+
+using namespace corofx;
+
+struct summary {
+    std::size_t bytes{};
+    std::size_t lines{};
+    std::size_t chunks{};
+};
+
+// A parser that only sees the chunks.
+auto summarize() -> task<summary, read_chunk> {
+    auto s = summary{};
+    for (auto chunk = co_await read_chunk{}; not chunk.empty(); chunk = co_await read_chunk{}) {
+        s.bytes += chunk.size();
+        for (auto b : chunk) s.lines += b == std::byte{'\n'} ? 1 : 0;
+        ++s.chunks;
+    }
+    co_return s;
+}
+
+auto write_file(std::size_t lines) -> std::string {
+    auto path = (std::filesystem::temp_directory_path() / "corofx_test_file_XXXXXX").string();
+    auto fd = ::mkstemp(path.data());
+    check(fd >= 0);
+    ::close(fd);
+    auto out = std::ofstream{path};
+    for (auto i = std::size_t{}; i < lines; ++i) out << "line " << i << '\n';
+    return path;
+}
+
+auto test_file(std::size_t lines, std::size_t chunk_size) -> void {
+    auto path = write_file(lines);
+    auto size = static_cast<std::size_t>(std::filesystem::file_size(path));
+
+    auto file = mapped_file::open(path.c_str());
+    check(file.has_value());
+    check(file->bytes().size() == size);
+    auto mapped = summarize().with(mapped_handler_of(*file, chunk_size))();
+    check(mapped.bytes == size);
+    check(mapped.lines == lines);
+    check(mapped.chunks == (size + chunk_size - 1) / chunk_size);
+
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    check(fd >= 0);
+    auto error = 0;
+    auto streamed = summarize().with(read_handler_of(fd, chunk_size, &error))();
+    ::close(fd);
+    check(streamed.bytes == size);
+    check(streamed.lines == lines);
+    check(error == 0);
+
+    // The mapping outlives a moved-from file.
+    auto moved = std::move(*file);
+    check(moved.bytes().size() == size);
+    check(file->bytes().empty());
+    std::filesystem::remove(path);
+}
+
+auto main() -> int {
+    static_assert(decltype(summarize().with(
+        mapped_handler_of(std::declval<mapped_file const&>())))::effect_types::empty);
+
+    check(not mapped_file::open("/nonexistent/corofx.txt").has_value());
+
+    // A failed read ends the input like the end of the file, but records the error.
+    auto error = 0;
+    auto failed = summarize().with(read_handler_of(-1, default_chunk_size, &error))();
+    check(failed.chunks == 0);
+    check(error == EBADF);
+    test_file(0, 4096);
+    test_file(1, 4096);
+    test_file(10'000, 1000);
+    test_file(10'000, 4096);
+    test_file(10'000, default_chunk_size);
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "corofx/check.hpp"
+#include "corofx/frame_resource.hpp"
+#include "corofx/task.hpp"
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <memory_resource>
+
+using namespace corofx;
+
+struct small {
+    using return_type = int;
+};
+
+// A large effect that counts how often it is copied or moved.
+struct payload {
+    using return_type = int;
+
+    static inline auto copies = 0;
+
+    explicit payload(int x) noexcept : x{x} {}
+    payload(payload const& that) noexcept : x{that.x}, data{that.data} { ++copies; }
+    payload(payload&& that) noexcept : x{that.x}, data{that.data} { ++copies; }
+    ~payload() = default;
+    auto operator=(payload const&) -> payload& = default;
+    auto operator=(payload&&) -> payload& = default;
+
+    int x;
+    std::array<std::byte, 4096> data{};
+};
+
+// The cost of a suspension point does not depend on the size of the effect.
+static_assert(sizeof(effect_awaiter<payload>) == sizeof(effect_awaiter<small>));
+static_assert(sizeof(effect_awaiter<small>) <= 5 * sizeof(void*));
+static_assert(sizeof(resumer<small>) <= 2 * sizeof(void*));
+static_assert(sizeof(task_awaiter<task<int>>) <= 2 * sizeof(void*));
+static_assert(sizeof(task<int, small>::promise_type) <= 3 * sizeof(void*));
+static_assert(sizeof(task<void, small>::promise_type) <= 3 * sizeof(void*));
+
+// Records the size of the last allocation.
+class size_resource : public std::pmr::memory_resource {
+public:
+    std::size_t last{};
+
+private:
+    auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override {
+        last = bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    auto do_deallocate(void* p, std::size_t bytes, std::size_t alignment) -> void override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    [[nodiscard]]
+    auto do_is_equal(std::pmr::memory_resource const& that) const noexcept -> bool override {
+        return this == &that;
+    }
+};
+
+auto perform(int x) -> task<int, payload> { co_return co_await payload{x}; }
+
+auto perform_lvalue(int x) -> task<int, payload> {
+    auto p = payload{x};
+    co_return co_await p;
+}
+
+auto main() -> int {
+    {
+        // Handlers taking the effect by reference see it in place.
+        payload::copies = 0;
+        auto result = perform(1).with(
+            handler_of<payload>([](payload const& e, auto& resume) -> task<int> {
+                co_return resume(e.x + 1);
+            }))();
+        check(result == 2);
+        check(payload::copies == 0);
+    }
+
+    {
+        payload::copies = 0;
+        auto result =
+            perform(2).with(tail_handler_of<payload>([](payload&& e) { return e.x + 1; }))();
+        check(result == 3);
+        check(payload::copies == 0);
+    }
+
+    {
+        payload::copies = 0;
+        auto result = perform(3).with(async_handler_of<payload>(
+            [](payload&& e, resumer<payload>& resume) -> std::coroutine_handle<> {
+                return resume.set_value(e.x + 1);
+            }))();
+        check(result == 4);
+        check(payload::copies == 0);
+    }
+
+    {
+        // Effects performed through an lvalue are copied once.
+        payload::copies = 0;
+        auto result = perform_lvalue(4).with(
+            tail_handler_of<payload>([](payload&& e) { return e.x + 1; }))();
+        check(result == 5);
+        check(payload::copies == 1);
+    }
+
+    {
+        // The producer frame holds a single copy of the effect.
+        auto sizes = size_resource{};
+        auto scope = frame_resource_scope{&sizes};
+        auto t = perform(5);
+        check(sizes.last >= sizeof(payload));
+        check(sizes.last < 2 * sizeof(payload));
+    }
+}
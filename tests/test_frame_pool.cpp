@@ -0,0 +1,66 @@
+#include "corofx/check.hpp"
+#include "corofx/detail/frame_pool.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+using namespace corofx;
+using detail::frame_pool;
+
+struct bar {
+    using return_type = int;
+
+    int x{};
+};
+
+constexpr auto small_size = std::size_t{100};
+constexpr auto large_size = frame_pool::max_pooled_size + 1;
+constexpr auto iterations = 1'000;
+
+auto do_bar() -> task<int, bar> {
+    auto sum = 0;
+    for (auto i = 0; i < iterations; ++i) sum += co_await bar{i};
+    co_return sum;
+}
+
+auto main() -> int {
+    frame_pool::trim();
+    check(frame_pool::cached_blocks() == 0);
+
+    // Blocks of the same size class are recycled.
+    auto p = frame_pool::allocate(small_size);
+    frame_pool::deallocate(p, small_size);
+    check(frame_pool::cached_blocks() == 1);
+    auto q = frame_pool::allocate(small_size - 1);
+    check(p == q);
+    check(frame_pool::cached_blocks() == 0);
+
+    // Oversized blocks bypass the pool.
+    auto r = frame_pool::allocate(large_size);
+    frame_pool::deallocate(r, large_size);
+    check(frame_pool::cached_blocks() == 0);
+
+    // A block allocated here can be freed on another thread and recycled there.
+    auto freed_remotely = std::size_t{};
+    std::thread{[&] {
+        frame_pool::deallocate(q, small_size);
+        freed_remotely = frame_pool::cached_blocks();
+        check(frame_pool::allocate(small_size) == q);
+        frame_pool::deallocate(q, small_size);
+    }}.join();
+    check(freed_remotely == 1);
+    check(frame_pool::cached_blocks() == 0);
+
+    // Handler frames are created and destroyed on every effect.
+    auto res = do_bar().with(handler_of<bar>([](auto&& e, auto&& resume) -> task<int> {
+        co_return resume(e.x);
+    }));
+    check(std::move(res)() == iterations * (iterations - 1) / 2);
+#ifdef COROFX_ENABLE_FRAME_POOL
+    check(frame_pool::cached_blocks() > 0);
+#endif
+    frame_pool::trim();
+    check(frame_pool::cached_blocks() == 0);
+}
@@ -0,0 +1,114 @@
+#include "corofx/check.hpp"
+#include "corofx/frame_resource.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+using namespace corofx;
+
+// Counts live allocations made through it.
+class counting_resource : public std::pmr::memory_resource {
+public:
+    std::size_t allocated{};
+    std::size_t live{};
+
+private:
+    auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override {
+        ++allocated;
+        ++live;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    auto do_deallocate(void* p, std::size_t bytes, std::size_t alignment) -> void override {
+        --live;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    [[nodiscard]]
+    auto do_is_equal(std::pmr::memory_resource const& that) const noexcept -> bool override {
+        return this == &that;
+    }
+};
+
+struct ask {
+    using return_type = int;
+};
+
+auto leaf() -> task<int, ask> { co_return co_await ask{}; }
+
+auto tree(int depth) -> task<int, ask> {
+    if (depth == 0) co_return co_await leaf();
+    co_return co_await tree(depth - 1) + co_await tree(depth - 1);
+}
+
+// GCC < 14 wrongly reports a templated `operator new` as mismatched with `operator delete`
+// (GCC bug 109224).
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ < 14
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+auto explicit_resource(std::allocator_arg_t, std::pmr::memory_resource*, int x) -> task<int> {
+    co_return x + 1;
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ < 14
+#pragma GCC diagnostic pop
+#endif
+
+auto main() -> int {
+    {
+        // Task and handler frames come from the resource in scope.
+        auto counter = counting_resource{};
+        auto scope = frame_resource_scope{&counter};
+        auto result = tree(3).with(handler_of<ask>([](ask&&, auto& resume) -> task<int> {
+            co_return resume(1);
+        }))();
+        check(result == 8);
+        // 15 `tree` frames, 8 `leaf` frames and 8 handler frames.
+        check(counter.allocated == 31);
+        check(counter.live == 0);
+    }
+
+    {
+        // Frames created outside of a scope use the default allocator.
+        auto counter = counting_resource{};
+        auto t = tree(1);
+        {
+            auto scope = frame_resource_scope{&counter};
+            auto inner = frame_resource_scope{nullptr};
+            auto u = leaf();
+        }
+        check(counter.allocated == 0);
+    }
+
+    {
+        // A leading allocator argument selects the resource of a single frame.
+        auto counter = counting_resource{};
+        check(explicit_resource(std::allocator_arg, &counter, 1)() == 2);
+        check(counter.allocated == 1 and counter.live == 0);
+    }
+
+    {
+        // Frames outliving their scope are still freed to their resource.
+        auto counter = counting_resource{};
+        auto t = std::unique_ptr<task<int, ask>>{};
+        {
+            auto scope = frame_resource_scope{&counter};
+            t = std::make_unique<task<int, ask>>(leaf());
+        }
+        check(counter.live == 1);
+        t.reset();
+        check(counter.live == 0);
+    }
+
+    {
+        // A whole request in a monotonic arena.
+        auto arena = std::pmr::monotonic_buffer_resource{};
+        auto scope = frame_resource_scope{&arena};
+        auto result = tree(4).with(handler_of<ask>([](ask&&, auto& resume) -> task<int> {
+            co_return resume(2);
+        }))();
+        check(result == 32);
+    }
+}
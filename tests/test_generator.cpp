@@ -0,0 +1,80 @@
+#include "corofx/check.hpp"
+#include "corofx/generator.hpp"
+#include "corofx/task.hpp"
+
+#include <iterator>
+#include <ranges>
+#include <utility>
+
+using namespace corofx;
+
+struct scale {
+    using return_type = int;
+
+    int x{};
+};
+
+static_assert(std::ranges::input_range<generator<int>>);
+static_assert(std::input_iterator<generator<int, scale>::iterator>);
+
+auto iota(int n) -> generator<int> {
+    for (auto i = 0; i < n; ++i) co_yield i;
+}
+
+auto twice(int x) -> task<int, scale> { co_return 2 * co_await scale{x}; }
+
+auto scaled(int n) -> generator<int, scale> {
+    for (auto i = 1; i <= n; ++i) {
+        co_yield co_await scale{i};
+        co_yield co_await twice(i);
+    }
+}
+
+auto sum_scaled(int n) -> task<int, scale> {
+    auto sum = 0;
+    for (auto x : co_await scaled(n)) sum += x;
+    co_return sum;
+}
+
+auto doubled(int n) -> generator<int, scale> {
+    for (auto i = 1; i <= n; ++i) co_yield co_await twice(i);
+}
+
+auto sum_doubled(int n) -> task<int, scale> {
+    auto sum = 0;
+    for (auto x : co_await doubled(n)) sum += x;
+    co_return sum;
+}
+
+auto first_scaled() -> task<int, scale> {
+    auto g = co_await scaled(100);
+    auto it = g.begin();
+    co_return *it;
+}
+
+auto main() -> int {
+    auto sum = 0;
+    for (auto x : iota(5)) sum += x;
+    check(sum == 10);
+    check(std::ranges::distance(iota(7)) == 7);
+
+    // Effects are handled by the binding task, inline or through a handler frame.
+    auto tail = sum_scaled(3).with(tail_handler_of<scale>([](scale&& e) { return e.x * 10; }))();
+    check(tail == (10 + 20 + 30) * 3);
+    auto framed = sum_scaled(3).with(handler_of<scale>([](auto&& e, auto&& resume) -> task<int> {
+        co_return resume(e.x * 10);
+    }))();
+    check(framed == tail);
+
+    // A handler that does not resume the generator ends it, and the binding task goes on.
+    auto until_three = [](auto&& e, auto&& resume) -> task<int> {
+        if (e.x == 3) co_return -1;
+        co_return resume(e.x);
+    };
+    check(sum_scaled(10).with(handler_of<scale>(until_three))() == 1 + 2 + 2 + 4);
+    check(sum_doubled(10).with(handler_of<scale>(until_three))() == 2 + 4);
+
+    // Generators can be abandoned before they finish.
+    auto first = first_scaled().with(tail_handler_of<scale>([](scale&& e) { return e.x; }))();
+    check(first == 1);
+}
@@ -0,0 +1,75 @@
+#include "corofx/check.hpp"
+#include "corofx/instrument.hpp"
+#include "corofx/task.hpp"
+
+#include <string_view>
+#include <utility>
+
+using namespace corofx;
+
+struct bar {
+    using return_type = int;
+
+    int x{};
+};
+
+struct raise {
+    using return_type = int;
+};
+
+constexpr auto marker = __LINE__;
+constexpr auto iterations = 10;
+
+auto do_bar() -> task<int, bar> {
+    auto sum = 0;
+    for (auto i = 0; i < iterations; ++i) sum += co_await bar{i};
+    co_return sum;
+}
+
+auto do_raise() -> task<int, raise> {
+    co_await raise{};
+    check_unreachable();
+}
+
+auto find(instrument::site_kind kind, std::string_view name) -> instrument::frame_counters {
+    for (auto const& s : instrument::site_snapshot()) {
+        if (s.kind == kind and s.name == name) return s.counters;
+    }
+    return {};
+}
+
+auto main() -> int {
+    static_assert(instrument::detail::type_name<bar>() == "bar");
+
+    check(do_bar().with(handler_of<bar>([](auto&& e, auto&& resume) -> task<int> {
+        co_return resume(e.x);
+    }))() == iterations * (iterations - 1) / 2);
+
+    // One handler frame per effect, all of them freed.
+    auto effect = find(instrument::site_kind::effect, "bar");
+    check(effect.allocated == iterations);
+    check(effect.live() == 0);
+    check(effect.allocated_bytes > 0 and effect.allocated_bytes == effect.freed_bytes);
+
+    auto producer = find(instrument::site_kind::task, "corofx::task<int, bar>");
+    check(producer.allocated == 1);
+    check(producer.live() == 0);
+
+    // A handler that abandons its continuation does not leak the producer frame.
+    auto before = instrument::global_counters();
+    {
+        auto aborted = do_raise().with(handler_of<raise>([](auto&&, auto&&) -> task<int> {
+            co_return marker;
+        }));
+        check(std::move(aborted)() == marker);
+        // The suspended producer still owns its frame and the handler frame.
+        check(instrument::global_counters().live() == before.live() + 2);
+    }
+    check(instrument::global_counters().live() == before.live());
+
+    auto global = instrument::global_counters();
+    check(global.allocated == instrument::thread_counters().allocated);
+    check(global.peak_live >= 2);
+    instrument::reset_peaks();
+    check(instrument::global_counters().peak_live == global.live());
+}
@@ -0,0 +1,116 @@
+#include "corofx/check.hpp"
+#include "corofx/instrumented.hpp"
+#include "corofx/task.hpp"
+
+#include <coroutine>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace corofx;
+
+struct bar {
+    using return_type = int;
+
+    int x{};
+};
+
+struct get {
+    using return_type = int;
+};
+
+struct poll {
+    using return_type = int;
+};
+
+struct raise {
+    using return_type = int;
+};
+
+constexpr auto marker = __LINE__;
+constexpr auto iterations = 10;
+
+auto do_bar() -> task<int, bar> {
+    auto sum = 0;
+    for (auto i = 0; i < iterations; ++i) sum += co_await bar{i};
+    co_return sum;
+}
+
+auto do_get() -> task<int, get> { co_return co_await get{}; }
+
+auto do_poll() -> task<int, poll> { co_return co_await poll{}; }
+
+auto do_raise() -> task<int, raise> {
+    co_await raise{};
+    check_unreachable();
+}
+
+auto find(std::string_view name) -> instrument::effect_latency {
+    for (auto const& l : instrument::latency_snapshot()) {
+        if (l.name == name) return l;
+    }
+    return {};
+}
+
+auto main() -> int {
+    using instrument::latency_histogram;
+
+    // Buckets cover every latency with a bounded relative error.
+    for (auto ns = std::uint64_t{1}; ns < (std::uint64_t{1} << 62); ns = ns * 3 + 1) {
+        auto highest = latency_histogram::highest_of(latency_histogram::bucket_of(ns));
+        check(highest >= ns and highest - ns <= ns / latency_histogram::sub_buckets);
+    }
+    auto h = latency_histogram{};
+    for (auto ns = std::uint64_t{1}; ns <= 1000; ++ns) h.record(ns);
+    check(h.count() == 1000 and h.sum() == 500'500);
+    check(h.percentile(0.5) >= 500 and h.percentile(0.5) <= 500 + 500 / 16);
+    check(h.percentile(0.999) >= 999 and h.percentile(0.999) <= 1000 + 1000 / 16);
+
+    check(do_bar().with(instrumented(handler_of<bar>([](bar&& e, auto& resume) -> task<int> {
+        co_return resume(e.x);
+    })))() == iterations * (iterations - 1) / 2);
+    auto b = find("bar");
+    check(b.invocations == iterations);
+    check(b.histogram.count() == iterations);
+
+    // Tail-resumptive handlers are timed inline.
+    check(do_get().with(instrumented(tail_handler_of<get>([](get&&) { return marker; })))() ==
+          marker);
+    check(find("get").histogram.count() == 1);
+
+    // Handlers that resume the producer later are timed until they do.
+    auto t = std::thread{[] {
+        auto result = do_poll().with(instrumented(async_handler_of<poll>(
+            [](poll&&, resumer<poll>& resume) -> std::coroutine_handle<> {
+                return resume.set_value(marker);
+            })))();
+        check(result == marker);
+    }};
+    t.join();
+    check(find("poll").histogram.count() == 1);
+
+    // Effects whose producer is never resumed are only counted as invocations.
+    check(do_raise().with(instrumented(handler_of<raise>([](raise&&, auto&) -> task<int> {
+        co_return marker;
+    })))() == marker);
+    auto r = find("raise");
+    check(r.invocations == 1 and r.histogram.count() == 0);
+
+    constexpr auto path = "test_instrumented.prom";
+    check(instrument::write_prometheus(instrument::latency_snapshot(), path));
+    auto file = std::fopen(path, "r");
+    check(file != nullptr);
+    auto text = std::string{};
+    for (auto c = std::fgetc(file); c != EOF; c = std::fgetc(file)) {
+        text.push_back(static_cast<char>(c));
+    }
+    std::fclose(file);
+    std::remove(path);
+    check(text.find("# TYPE corofx_effect_latency_seconds summary\n") != text.npos);
+    check(text.find("corofx_effect_latency_seconds{effect=\"bar\",quantile=\"0.999\"} ") !=
+          text.npos);
+    check(text.find("corofx_effect_latency_seconds_count{effect=\"bar\"} 10\n") != text.npos);
+    check(text.find("corofx_effect_invocations_total{effect=\"raise\"} 1\n") != text.npos);
+}
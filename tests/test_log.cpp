@@ -0,0 +1,148 @@
+#include "corofx/check.hpp"
+#include "corofx/log.hpp"
+#include "corofx/task.hpp"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace corofx;
+using namespace std::chrono_literals;
+
+constexpr auto records = 1000;
+
+auto greet(std::string name) -> task<void, log_message> {
+    co_await log_message::info("hello ", name, ' ', 42, ' ', true, ' ', 1.5);
+    co_await log_message::error("bye");
+    co_return {};
+}
+
+auto count_up(int thread, int n) -> task<void, log_message> {
+    for (auto i = 0; i < n; ++i) co_await log_message::debug("thread ", thread, " record ", i);
+    co_return {};
+}
+
+auto temp_path() -> std::string {
+    auto path = (std::filesystem::temp_directory_path() / "corofx_test_log_XXXXXX").string();
+    auto fd = ::mkstemp(path.data());
+    check(fd >= 0);
+    ::close(fd);
+    return path;
+}
+
+auto read_lines(std::string const& path) -> std::vector<std::string> {
+    auto lines = std::vector<std::string>{};
+    auto in = std::ifstream{path};
+    for (auto line = std::string{}; std::getline(in, line);) lines.push_back(line);
+    return lines;
+}
+
+auto ends_with(std::string const& s, std::string const& suffix) -> bool {
+    return s.size() >= suffix.size()
+           and s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+auto test_format() -> void {
+    auto path = temp_path();
+    auto l = logger::open(path.c_str());
+    check(l != nullptr);
+    greet("corofx").with(log_handler_of(*l))();
+    l->flush();
+    auto lines = read_lines(path);
+    check(lines.size() == 2);
+    check(ends_with(lines[0], " INFO hello corofx 42 true 1.5"));
+    check(ends_with(lines[1], " ERROR bye"));
+    check(l->stats().records == 2);
+    l.reset();
+    std::filesystem::remove(path);
+}
+
+// Records from each thread are written in order.
+auto test_threads() -> void {
+    constexpr auto threads = 4;
+    auto path = temp_path();
+    auto l = logger::open(path.c_str(), {.buffer_size = 4096, .overflow = log_overflow::block});
+    check(l != nullptr);
+    {
+        auto workers = std::vector<std::jthread>{};
+        for (auto t = 0; t < threads; ++t) {
+            workers.emplace_back([&l, t] { count_up(t, records).with(log_handler_of(*l))(); });
+        }
+    }
+    check(l->stats().records == threads * records);
+    check(l->stats().dropped == 0);
+    l.reset();
+
+    auto next = std::vector<int>(threads);
+    auto lines = read_lines(path);
+    check(lines.size() == std::size_t{threads} * records);
+    for (auto const& line : lines) {
+        auto at = line.find(" DEBUG thread ");
+        check(at != std::string::npos);
+        auto t = std::stoi(line.substr(at + 14));
+        auto i = std::stoi(line.substr(line.rfind(' ') + 1));
+        check(i == next[static_cast<std::size_t>(t)]++);
+    }
+    std::filesystem::remove(path);
+}
+
+// The buffers of exited threads are released once written, and their records still counted.
+auto test_exited() -> void {
+    constexpr auto threads = 16;
+    auto path = temp_path();
+    auto l = logger::open(path.c_str(), {.flush_interval = 10us});
+    check(l != nullptr);
+    for (auto t = 0; t < threads; ++t) {
+        std::jthread{[&l, t] { count_up(t, 10).with(log_handler_of(*l))(); }}.join();
+        // Lets the writer go idle, so that the next thread wakes it.
+        std::this_thread::sleep_for(1ms);
+    }
+    l->flush();
+    check(read_lines(path).size() == std::size_t{threads} * 10);
+    check(l->stats().records == threads * 10);
+    l.reset();
+    std::filesystem::remove(path);
+}
+
+// The writer sleeps through the test, so the buffer overflows.
+auto test_overflow(log_overflow policy) -> void {
+    auto path = temp_path();
+    auto l = logger::open(
+        path.c_str(), {.buffer_size = 4096, .overflow = policy, .flush_interval = 1h});
+    check(l != nullptr);
+    std::this_thread::sleep_for(10ms);
+    count_up(0, records).with(log_handler_of(*l))();
+    auto stats = l->stats();
+    check(stats.records == records);
+    if (policy == log_overflow::drop) {
+        check(stats.dropped > 0);
+    } else {
+        check(stats.dropped == 0);
+    }
+    l.reset();
+    check(read_lines(path).size() == records - stats.dropped);
+    std::filesystem::remove(path);
+}
+
+auto main() -> int {
+    using handled = decltype(greet("").with(log_handler_of(std::declval<logger&>())));
+    static_assert(handled::effect_types::empty);
+
+    check(logger::open("/nonexistent/corofx.log") == nullptr);
+    test_format();
+    test_threads();
+    test_exited();
+    test_overflow(log_overflow::drop);
+    test_overflow(log_overflow::block);
+    test_overflow(log_overflow::sync);
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "corofx/check.hpp"
+#include "corofx/memoize.hpp"
+#include "corofx/task.hpp"
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <functional>
+#include <thread>
+
+using namespace corofx;
+
+struct lookup {
+    using return_type = int;
+
+    int key{};
+
+    friend auto operator==(lookup const&, lookup const&) -> bool = default;
+};
+
+template<>
+struct std::hash<lookup> {
+    auto operator()(lookup const& e) const noexcept -> std::size_t {
+        return std::hash<int>{}(e.key);
+    }
+};
+
+// Looks up each key in turn.
+template<std::size_t N>
+auto lookup_all(int const (&keys)[N]) -> task<int, lookup> {
+    auto sum = 0;
+    for (auto key : keys) sum += co_await lookup{key};
+    co_return sum;
+}
+
+auto calls = 0;
+
+auto counted = [](lookup&& e, auto& resume) -> task<int> {
+    ++calls;
+    co_return resume(e.key * 10);
+};
+
+auto main() -> int {
+    {
+        // Repeated effects are answered from the cache.
+        calls = 0;
+        auto memo = memoize<lookup>(handler_of<lookup>(counted));
+        int const keys[] = {1, 2, 1, 1, 2, 3};
+        check(lookup_all(keys).with(memo)() == 100);
+        check(calls == 3);
+        auto stats = memo.stats();
+        check(stats.hits == 3 and stats.misses == 3 and stats.evictions == 0);
+
+        // Copies of the handler share the cache.
+        check(lookup_all(keys).with(memo)() == 100);
+        check(calls == 3);
+        check(memo.cache()->size() == 3);
+    }
+
+    {
+        // LRU evicts the least recently used result.
+        calls = 0;
+        auto memo = memoize<lookup>(handler_of<lookup>(counted), {.capacity = 2});
+        int const keys[] = {1, 2, 1, 3, 1, 2};
+        check(lookup_all(keys).with(memo)() == 100);
+        check(calls == 4);
+        check(memo.stats().evictions == 2);
+    }
+
+    {
+        // CLOCK spares results used since the hand last passed them.
+        calls = 0;
+        auto memo = memoize<lookup>(
+            handler_of<lookup>(counted), {.capacity = 2, .policy = eviction::clock});
+        int const keys[] = {1, 2, 1, 3, 1};
+        check(lookup_all(keys).with(memo)() == 80);
+        check(calls == 3);
+        check(memo.stats().evictions == 1 and memo.stats().hits == 2);
+    }
+
+    {
+        // Results expire after their time to live.
+        calls = 0;
+        auto memo = memoize<lookup>(
+            handler_of<lookup>(counted), {.ttl = std::chrono::milliseconds{1}});
+        int const keys[] = {1, 1};
+        check(lookup_all(keys).with(memo)() == 20);
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+        check(lookup_all(keys).with(memo)() == 20);
+        check(calls == 2);
+        check(memo.stats().expirations == 1);
+    }
+
+    {
+        // Tail-resumptive handlers stay inline.
+        calls = 0;
+        auto memo = memoize<lookup>(tail_handler_of<lookup>([](lookup&& e) {
+            ++calls;
+            return e.key;
+        }));
+        static_assert(decltype(memo)::tail_resumptive);
+        int const keys[] = {4, 4, 4};
+        check(lookup_all(keys).with(memo)() == 12);
+        check(calls == 1);
+    }
+
+    {
+        // Results given later through `set_value` are cached too.
+        calls = 0;
+        auto memo = memoize<lookup>(async_handler_of<lookup>(
+            [](lookup&& e, resumer<lookup>& resume) -> std::coroutine_handle<> {
+                ++calls;
+                return resume.set_value(e.key + 1);
+            }));
+        int const keys[] = {5, 5};
+        check(lookup_all(keys).with(memo)() == 12);
+        check(calls == 1);
+    }
+}
@@ -0,0 +1,133 @@
+#include "corofx/channel.hpp"
+#include "corofx/check.hpp"
+#include "corofx/net.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <thread>
+
+using namespace corofx;
+
+auto as_bytes(char const* s) -> std::span<std::byte const> {
+    return std::as_bytes(std::span{s, std::strlen(s)});
+}
+
+auto read_all(int fd, std::span<std::byte> buffer) -> task<std::size_t, net_read> {
+    auto total = std::size_t{};
+    while (total < buffer.size()) {
+        auto n = co_await net_read{fd, buffer.subspan(total)};
+        if (n <= 0) break;
+        total += static_cast<std::size_t>(n);
+    }
+    co_return total;
+}
+
+auto reader(int fd, std::array<std::byte, 5>* out) -> task<void, net_read> {
+    check(co_await read_all(fd, *out) == out->size());
+    co_return {};
+}
+
+auto parked_read(int a, int b) -> task<bool, spawn, yield_thread, join, net_read, net_write> {
+    auto buffer = std::array<std::byte, 5>{};
+    // The reader finds nothing to read and is parked until the writes below.
+    auto j = co_await spawn{reader(a, &buffer)};
+    co_await yield_thread{};
+    check(co_await net_write{b, as_bytes("he")} == 2);
+    co_await yield_thread{};
+    check(co_await net_write{b, as_bytes("llo")} == 3);
+    co_await join{j};
+    co_return std::memcmp(buffer.data(), "hello", buffer.size()) == 0;
+}
+
+// A second reader of a socket that already has one waiting is turned away.
+auto busy_read(int a, int b) -> task<bool, spawn, yield_thread, join, net_read, net_write> {
+    auto buffer = std::array<std::byte, 5>{};
+    auto j = co_await spawn{reader(a, &buffer)};
+    co_await yield_thread{};
+    auto other = std::array<std::byte, 1>{};
+    check(co_await net_read{a, other} == -EBUSY);
+    check(co_await net_write{b, as_bytes("hello")} == 5);
+    co_await join{j};
+    co_return std::memcmp(buffer.data(), "hello", buffer.size()) == 0;
+}
+
+auto end_of_stream(int fd) -> task<std::ptrdiff_t, net_read> {
+    auto buffer = std::array<std::byte, 1>{};
+    co_return co_await net_read{fd, buffer};
+}
+
+auto acceptor(int listener, int* accepted) -> task<void, net_accept> {
+    *accepted = co_await net_accept{listener};
+    co_return {};
+}
+
+auto accept_connection(int listener, sockaddr_in addr, int* accepted)
+    -> task<void, spawn, yield_thread, join, net_accept> {
+    auto j = co_await spawn{acceptor(listener, accepted)};
+    co_await yield_thread{};
+    check(*accepted == 0);
+    auto client = ::socket(AF_INET, SOCK_STREAM, 0);
+    check(::connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    co_await join{j};
+    ::close(client);
+    co_return {};
+}
+
+auto drain(channel<int>& ch) -> task<int, suspend> {
+    auto sum = 0;
+    while (auto value = co_await recv(ch)) sum += *value;
+    co_return sum;
+}
+
+auto main() -> int {
+    auto r = reactor{};
+
+    auto fds = std::array<int, 2>{};
+    check(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds.data()) == 0);
+    check(r.run(parked_read(fds[0], fds[1])));
+    check(r.run(busy_read(fds[0], fds[1])));
+
+    // A closed peer ends the stream.
+    ::close(fds[1]);
+    check(r.run(end_of_stream(fds[0])) == 0);
+    ::close(fds[0]);
+
+    // Errors are returned as negated error numbers.
+    check(r.run(end_of_stream(fds[0])) == -EBADF);
+
+    auto listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    auto addr = sockaddr_in{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    auto len = socklen_t{sizeof(addr)};
+    check(::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    check(::listen(listener, 1) == 0);
+    check(::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) == 0);
+    auto accepted = 0;
+    r.run(accept_connection(listener, addr, &accepted));
+    check(accepted > 0);
+    ::close(accepted);
+    ::close(listener);
+
+    // Tasks parked on a channel are woken up by another thread.
+    auto ch = channel<int>{2};
+    auto producer = std::thread{[&] {
+        for (auto i = 1; i <= 1000; ++i) {
+            auto value = i;
+            while (ch.try_send(value) == send_status::full) std::this_thread::yield();
+        }
+        ch.close();
+    }};
+    check(r.run(drain(ch)) == 500500);
+    producer.join();
+}
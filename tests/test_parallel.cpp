@@ -0,0 +1,75 @@
+#include "corofx/check.hpp"
+#include "corofx/parallel.hpp"
+#include "corofx/task.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+using namespace corofx;
+
+using sum = parallel_reduce<std::int64_t>;
+
+struct plus {
+    auto operator()(std::int64_t a, std::int64_t b) const -> std::int64_t { return a + b; }
+};
+
+// Squares every element, then adds them up.
+auto sum_of_squares(std::vector<std::int64_t>* xs) -> task<std::int64_t, parallel_for, sum> {
+    co_await parallel_for{0, xs->size(), [xs](std::size_t i) { (*xs)[i] *= (*xs)[i]; }};
+    co_return co_await sum{std::span<std::int64_t const>{*xs}, 0, plus{}};
+}
+
+// Counts how many times each index runs.
+auto visit(std::vector<std::atomic<int>>* seen) -> task<void, parallel_for> {
+    co_await parallel_for{0, seen->size(), [seen](std::size_t i) {
+                              (*seen)[i].fetch_add(1, std::memory_order_relaxed);
+                          }};
+    co_return {};
+}
+
+auto expected(std::size_t n) -> std::int64_t {
+    auto k = static_cast<std::int64_t>(n);
+    return (k - 1) * k * (2 * k - 1) / 6;
+}
+
+auto iota(std::size_t n) -> std::vector<std::int64_t> {
+    auto xs = std::vector<std::int64_t>(n);
+    std::iota(xs.begin(), xs.end(), 0);
+    return xs;
+}
+
+auto test_visit(parallel_pool& pool, std::size_t n) -> void {
+    auto seen = std::vector<std::atomic<int>>(n);
+    visit(&seen).with(parallel_handler_of<parallel_for>(pool))();
+    for (auto const& s : seen) check(s.load() == 1);
+}
+
+auto main() -> int {
+    static_assert(decltype(sum_of_squares(nullptr).with(
+        sequential_handler_of<parallel_for>(),
+        sequential_handler_of<sum>()))::effect_types::empty);
+
+    for (auto threads : {1, 2, 4}) {
+        auto pool = parallel_pool{static_cast<std::size_t>(threads)};
+        check(pool.threads() == static_cast<std::size_t>(threads));
+        for (auto n : {0, 1, 7, 1000, 100'000}) {
+            auto size = static_cast<std::size_t>(n);
+            auto xs = iota(size);
+            auto parallel = sum_of_squares(&xs).with(
+                parallel_handler_of<parallel_for>(pool), parallel_handler_of<sum>(pool))();
+            check(parallel == expected(size));
+            auto ys = iota(size);
+            auto sequential = sum_of_squares(&ys).with(
+                sequential_handler_of<parallel_for>(), sequential_handler_of<sum>())();
+            check(sequential == parallel);
+            test_visit(pool, size);
+        }
+        // Runs one after another reuse the workers.
+        for (auto i = 0; i < 100; ++i) test_visit(pool, 10'000);
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "corofx/check.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+
+#include <atomic>
+#include <vector>
+
+using namespace corofx;
+
+auto fib(int n, int* out) -> task<void, spawn, join> {
+    if (n < 2) {
+        *out = n;
+        co_return {};
+    }
+    auto a = 0;
+    auto b = 0;
+    auto j = co_await spawn{fib(n - 1, &a)};
+    co_await fib(n - 2, &b);
+    co_await join{j};
+    *out = a + b;
+    co_return {};
+}
+
+auto parallel_fib(int n) -> task<int, spawn, join> {
+    auto out = 0;
+    co_await fib(n, &out);
+    co_return out;
+}
+
+auto count(std::atomic<int>* counter, int rounds) -> task<void, yield_thread> {
+    for (auto i = 0; i < rounds; ++i) {
+        counter->fetch_add(1, std::memory_order_relaxed);
+        co_await yield_thread{};
+    }
+    co_return {};
+}
+
+auto fan_out(std::atomic<int>* counter, int jobs, int rounds)
+    -> task<void, spawn, yield_thread, join> {
+    auto handles = std::vector<job_handle>{};
+    for (auto i = 0; i < jobs; ++i) handles.push_back(co_await spawn{count(counter, rounds)});
+    for (auto& h : handles) co_await join{h};
+    for (auto& h : handles) check(h.done());
+    co_return {};
+}
+
+auto detached(std::atomic<int>* counter) -> task<void, spawn> {
+    for (auto i = 0; i < 100; ++i) co_await spawn{count(counter, 1)};
+    co_return {};
+}
+
+auto main() -> int {
+    for (auto threads : {1, 2, 4}) {
+        auto sched = scheduler{static_cast<std::size_t>(threads)};
+        check(sched.threads() == static_cast<std::size_t>(threads));
+
+        check(sched.run(parallel_fib(20)) == 6765);
+
+        // Joining a job that yields repeatedly.
+        auto counter = std::atomic<int>{};
+        sched.run(fan_out(&counter, 64, 10));
+        check(counter.load() == 64 * 10);
+
+        // `run` also waits for tasks that are never joined.
+        counter = 0;
+        sched.run(detached(&counter));
+        check(counter.load() == 100);
+    }
+}
@@ -0,0 +1,69 @@
+#include "corofx/check.hpp"
+#include "corofx/state.hpp"
+#include "corofx/task.hpp"
+
+#include <memory>
+#include <string>
+#include <type_traits>
+
+using namespace corofx;
+
+struct config {
+    int retries{};
+    std::string name;
+};
+
+auto countdown(int depth) -> task<int, state<int>> { // NOLINT(misc-no-recursion)
+    if (depth > 0) co_return co_await countdown(depth - 1);
+    auto steps = 0;
+    for (auto i = co_await state<int>::get(); i > 0; i = co_await state<int>::get()) {
+        co_await state<int>::put(i - 1);
+        ++steps;
+    }
+    co_return steps;
+}
+
+auto swap_in(std::string s) -> task<std::string, state<std::string>> {
+    co_return co_await state<std::string>::put(std::move(s));
+}
+
+auto describe() -> task<std::string, reader<config>, state<int>> {
+    auto c = co_await reader<config>::ask();
+    co_await state<int>::put(c.retries);
+    co_return c.name;
+}
+
+// A move-only value can still be replaced.
+auto swap_box(int x) -> task<int, state<std::unique_ptr<int>>> {
+    auto old = co_await state<std::unique_ptr<int>>::put(std::make_unique<int>(x));
+    co_return *old;
+}
+
+// An inner handler shadows the outer one for the task it handles.
+auto shadowed() -> task<int, state<int>> {
+    co_await state<int>::put(1);
+    auto inner = co_await swap_in("inner").with(state_handler_of(std::string{"outer"}));
+    check(inner == "outer");
+    co_return co_await state<int>::get();
+}
+
+auto main() -> int {
+    // The handler removes the effect from the row.
+    using handled = decltype(countdown(0).with(state_handler_of(0)));
+    static_assert(handled::effect_types::empty);
+    static_assert(std::is_same_v<
+                  decltype(describe().with(reader_handler_of(config{})))::effect_types,
+                  detail::type_set<state<int>>>);
+
+    check(countdown(0).with(state_handler_of(10))() == 10);
+    check(countdown(100).with(state_handler_of(10))() == 10);
+
+    // `put` returns the previous value.
+    check(swap_in("new").with(state_handler_of(std::string{"old"}))() == "old");
+
+    check(swap_box(2).with(state_handler_of(std::make_unique<int>(1)))() == 1);
+
+    check(describe().with(reader_handler_of(config{3, "db"}), state_handler_of(0))() == "db");
+
+    check(shadowed().with(state_handler_of(0))() == 1);
+}
@@ -0,0 +1,112 @@
+#include "corofx/check.hpp"
+#include "corofx/stream.hpp"
+#include "corofx/task.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+using namespace corofx;
+
+struct scale {
+    using return_type = int;
+
+    int x{};
+};
+
+auto iota(int n, int* produced) -> task<void, emit<int>> {
+    for (auto i = 0; i < n; ++i) {
+        ++*produced;
+        if (not co_await emit{i}) break;
+    }
+    co_return {};
+}
+
+auto scaled(int n) -> task<void, emit<int>, scale> {
+    for (auto i = 1; i <= n; ++i) {
+        if (not co_await emit{co_await scale{i}}) break;
+    }
+    co_return {};
+}
+
+auto boxes(int n) -> task<void, emit<std::unique_ptr<int>>> {
+    for (auto i = 0; i < n; ++i) {
+        if (not co_await emit{std::make_unique<int>(i)}) break;
+    }
+    co_return {};
+}
+
+auto squared_odds(int n, int* produced) -> task<int> {
+    return stream<int>{iota(n, produced)}
+        .filter([](int x) { return x % 2 == 1; })
+        .map([](int x) { return x * x; })
+        .fold(0, [](int acc, int x) { return acc + x; });
+}
+
+auto sum_scaled(int n) -> task<int, scale> {
+    co_return co_await stream<int, scale>{scaled(n)}.take(3).fold(
+        0, [](int acc, int x) { return acc + x; });
+}
+
+auto main() -> int {
+    {
+        auto produced = 0;
+        check(squared_odds(6, &produced)() == 1 + 9 + 25);
+        check(produced == 6);
+    }
+
+    {
+        // `take` stops the source once it has enough elements.
+        auto produced = 0;
+        auto first = stream<int>{iota(100, &produced)}.take(4).fold(
+            std::vector<int>{}, [](std::vector<int> acc, int x) {
+                acc.push_back(x);
+                return acc;
+            })();
+        check((first == std::vector<int>{0, 1, 2, 3}));
+        check(produced == 4);
+    }
+
+    {
+        // The last chunk may be short, including when `take` stops the source.
+        auto produced = 0;
+        auto sizes = stream<int>{iota(10, &produced)}
+                         .take(7)
+                         .chunk(3)
+                         .fold(std::vector<std::size_t>{},
+                               [](std::vector<std::size_t> acc, std::vector<int> const& c) {
+                                   acc.push_back(c.size());
+                                   return acc;
+                               })();
+        check((sizes == std::vector<std::size_t>{3, 3, 1}));
+        check(produced == 7);
+
+        using chunks = decltype(stream<int>{iota(1, &produced)}.chunk(2).map(
+            [](std::vector<int> const& c) { return c.size(); }));
+        static_assert(std::is_same_v<chunks::value_type, std::size_t>);
+    }
+
+    {
+        // Move-only elements are moved through every stage.
+        auto total = stream<std::unique_ptr<int>>{boxes(5)}
+                         .filter([](std::unique_ptr<int> const& p) { return *p != 2; })
+                         .map([](std::unique_ptr<int> p) { return *p * 10; })
+                         .fold(0, [](int acc, int x) { return acc + x; })();
+        check(total == (0 + 1 + 3 + 4) * 10);
+    }
+
+    {
+        // Effects of the source other than `emit` stay in the row of the result.
+        auto sum = sum_scaled(10).with(tail_handler_of<scale>([](scale&& e) { return e.x * 2; }))();
+        check(sum == 2 + 4 + 6);
+    }
+
+    {
+        // An empty source folds to the initial value and still flushes nothing.
+        auto produced = 0;
+        auto n = stream<int>{iota(0, &produced)}.chunk(4).fold(
+            0, [](int acc, std::vector<int> const&) { return acc + 1; })();
+        check(n == 0);
+    }
+}
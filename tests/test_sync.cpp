@@ -0,0 +1,224 @@
+#include "corofx/check.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/sync.hpp"
+#include "corofx/task.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+using namespace corofx;
+
+// Holds the mutex across a yield, so that other tasks queue behind it.
+auto increment(async_mutex& m, int* counter, int n) -> task<void, lock, yield_thread> {
+    for (auto i = 0; i < n; ++i) {
+        co_await lock{m};
+        auto value = *counter;
+        if (i % 16 == 0) co_await yield_thread{};
+        *counter = value + 1;
+        m.unlock();
+    }
+    co_return {};
+}
+
+auto increment_all(async_mutex& m, int* counter, int n) -> task<void, yield_thread, suspend> {
+    co_await increment(m, counter, n).with(sync_handler_of<lock>());
+    co_return {};
+}
+
+auto contend(async_mutex& m, int tasks, int n) -> task<void, spawn, join, yield_thread, suspend> {
+    auto counter = 0;
+    auto handles = std::vector<job_handle>{};
+    for (auto i = 0; i < tasks; ++i) {
+        handles.push_back(co_await spawn{increment_all(m, &counter, n)});
+    }
+    for (auto& h : handles) co_await join{h};
+    check(counter == tasks * n);
+    check(m.try_lock());
+    m.unlock();
+    co_return {};
+}
+
+auto record(async_mutex& m, std::vector<int>* arrivals, std::vector<int>* order, int id)
+    -> task<void, lock> {
+    arrivals->push_back(id);
+    co_await lock{m};
+    order->push_back(id);
+    m.unlock();
+    co_return {};
+}
+
+auto record_all(async_mutex& m, std::vector<int>* arrivals, std::vector<int>* order, int id)
+    -> task<void, suspend> {
+    co_await record(m, arrivals, order, id).with(sync_handler_of<lock>());
+    co_return {};
+}
+
+// On one thread, the spawned tasks acquire the mutex in the order they started waiting.
+auto handoff(async_mutex& m) -> task<void, spawn, join, yield_thread, suspend> {
+    auto arrivals = std::vector<int>{};
+    auto order = std::vector<int>{};
+    check(m.try_lock());
+    auto handles = std::vector<job_handle>{};
+    for (auto i = 0; i < 4; ++i) {
+        handles.push_back(co_await spawn{record_all(m, &arrivals, &order, i)});
+    }
+    while (arrivals.size() < handles.size()) co_await yield_thread{};
+    check(order.empty());
+    m.unlock();
+    for (auto& h : handles) co_await join{h};
+    check(order.size() == handles.size());
+    check(order == arrivals);
+    co_return {};
+}
+
+auto limited(async_semaphore& s, std::atomic<int>* inside, std::atomic<int>* peak, int n)
+    -> task<void, acquire, yield_thread> {
+    for (auto i = 0; i < n; ++i) {
+        co_await acquire{s};
+        auto now = inside->fetch_add(1) + 1;
+        for (auto p = peak->load(); now > p and not peak->compare_exchange_weak(p, now);) {}
+        co_await yield_thread{};
+        inside->fetch_sub(1);
+        s.release();
+    }
+    co_return {};
+}
+
+auto limited_all(async_semaphore& s, std::atomic<int>* inside, std::atomic<int>* peak)
+    -> task<void, yield_thread, suspend> {
+    co_await limited(s, inside, peak, 100).with(sync_handler_of<acquire>());
+    co_return {};
+}
+
+auto bounded(async_semaphore& s, std::size_t permits, int tasks)
+    -> task<void, spawn, join, yield_thread, suspend> {
+    auto inside = std::atomic<int>{};
+    auto peak = std::atomic<int>{};
+    auto handles = std::vector<job_handle>{};
+    for (auto i = 0; i < tasks; ++i) {
+        handles.push_back(co_await spawn{limited_all(s, &inside, &peak)});
+    }
+    for (auto& h : handles) co_await join{h};
+    check(peak.load() >= 1);
+    check(peak.load() <= static_cast<int>(permits));
+    // Every permit was returned.
+    for (auto i = std::size_t{}; i < permits; ++i) check(s.try_acquire());
+    check(not s.try_acquire());
+    s.release(permits);
+    co_return {};
+}
+
+auto arrive(async_latch& l, std::atomic<int>* passed) -> task<void, wait_latch> {
+    co_await wait_latch{l};
+    passed->fetch_add(1);
+    co_return {};
+}
+
+auto arrive_all(async_latch& l, std::atomic<int>* passed) -> task<void, suspend> {
+    co_await arrive(l, passed).with(sync_handler_of<wait_latch>());
+    co_return {};
+}
+
+auto gather(int tasks) -> task<void, spawn, join, yield_thread, suspend> {
+    auto l = async_latch{tasks};
+    auto passed = std::atomic<int>{};
+    auto handles = std::vector<job_handle>{};
+    for (auto i = 0; i < tasks; ++i) {
+        handles.push_back(co_await spawn{arrive_all(l, &passed)});
+    }
+    co_await yield_thread{};
+    check(passed.load() == 0);
+    for (auto i = 0; i < tasks; ++i) {
+        check(not l.try_wait());
+        l.count_down();
+    }
+    for (auto& h : handles) co_await join{h};
+    check(passed.load() == tasks);
+    // A released latch lets tasks through without suspending them.
+    co_await arrive_all(l, &passed);
+    check(passed.load() == tasks + 1);
+    co_return {};
+}
+
+auto relock(async_mutex& m, int n) -> task<int, lock> {
+    auto count = 0;
+    for (auto i = 0; i < n; ++i) {
+        co_await lock{m};
+        ++count;
+        m.unlock();
+    }
+    co_return count;
+}
+
+auto relock_bound(async_mutex& m, int n) -> task<int, bound<sync_handler<lock>>> {
+    auto count = 0;
+    for (auto i = 0; i < n; ++i) {
+        co_await lock{m};
+        ++count;
+        m.unlock();
+    }
+    co_return count;
+}
+
+// An uncontended mutex is taken in `await_ready`, without an executor to park the task on.
+auto relock_all(async_mutex& m, bool direct) -> task<int, suspend> {
+    if (direct) co_return co_await relock_bound(m, 3).with(sync_handler_of<lock>());
+    co_return co_await relock(m, 3).with(sync_handler_of<lock>());
+}
+
+auto never_park(suspend&&, resumer<suspend>&) -> task<int> {
+    check_unreachable();
+    co_return 0;
+}
+
+auto main() -> int {
+    static_assert(detail::checks_ready<sync_handler<lock>>);
+    static_assert(not detail::checks_ready<decltype(handler_of<suspend>(&never_park))>);
+
+    {
+        // Non-blocking operations.
+        auto m = async_mutex{};
+        check(m.try_lock());
+        check(not m.try_lock());
+        m.unlock();
+
+        auto s = async_semaphore{2};
+        check(s.try_acquire());
+        check(s.try_acquire());
+        check(not s.try_acquire());
+        s.release(2);
+        check(s.try_acquire());
+
+        // Counting down by zero leaves a released latch released.
+        auto l = async_latch{1};
+        l.count_down();
+        l.count_down(0);
+        check(l.try_wait());
+        auto z = async_latch{0};
+        z.count_down(0);
+        check(z.try_wait());
+    }
+
+    {
+        auto m = async_mutex{};
+        check(relock_all(m, false).with(handler_of<suspend>(&never_park))() == 3);
+        check(relock_all(m, true).with(handler_of<suspend>(&never_park))() == 3);
+        check(m.try_lock());
+    }
+
+    {
+        auto sched = scheduler{1};
+        auto m = async_mutex{};
+        sched.run(handoff(m));
+    }
+
+    for (auto threads : {1, 2, 4}) {
+        auto sched = scheduler{static_cast<std::size_t>(threads)};
+        auto m = async_mutex{};
+        sched.run(contend(m, 8, 1000));
+        auto s = async_semaphore{3};
+        sched.run(bounded(s, 3, 8));
+        sched.run(gather(8));
+    }
+}
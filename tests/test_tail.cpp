@@ -0,0 +1,77 @@
+#include "corofx/check.hpp"
+#include "corofx/task.hpp"
+
+#include <utility>
+
+using namespace corofx;
+
+struct get {
+    using return_type = int;
+};
+
+struct put {
+    using return_type = void;
+
+    int x{};
+};
+
+struct bar {
+    using return_type = int;
+
+    int x{};
+};
+
+constexpr auto marker0 = __LINE__;
+constexpr auto marker1 = __LINE__;
+constexpr auto large_value = 1'000'000;
+
+auto countdown() -> task<int, get, put> {
+    auto n = 0;
+    for (auto i = co_await get{}; i > 0; i = co_await get{}) {
+        co_await put{i - 1};
+        ++n;
+    }
+    co_return n;
+}
+
+auto countdown_outer() -> task<int, get, put> { co_return co_await countdown(); }
+
+auto do_bar() -> task<int, bar> {
+    auto i = 0;
+    for (; i < large_value; ++i) {
+        check(co_await bar{i} == i);
+    }
+    co_return i;
+}
+
+auto mixed() -> task<int, bar, get> {
+    auto x = co_await bar{marker0};
+    co_return x + co_await get{};
+}
+
+auto main() -> int {
+    auto x = marker0;
+    auto state = countdown_outer().with(
+        tail_handler_of<get>([&](get&&) { return x; }), tail_handler_of<put>([&](put&& e) {
+            x = e.x;
+        }));
+    check(std::move(state)() == marker0);
+    check(x == 0);
+
+    // Tail resumption does not grow the stack.
+    auto i = 0;
+    auto res = do_bar().with(tail_handler_of<bar>([&i](bar&& e) {
+        check(e.x == i++);
+        return e.x;
+    }));
+    check(std::move(res)() == large_value);
+
+    // Tail-resumptive and regular handlers can be combined.
+    auto m = mixed().with(
+        handler_of<bar>([](auto&& e, auto&& resume) -> task<int> {
+            check(e.x == marker0);
+            co_return resume(marker1);
+        }),
+        tail_handler_of<get>([](get&&) { return marker0; }));
+    check(std::move(m)() == marker0 + marker1);
+}
@@ -0,0 +1,83 @@
+#include "corofx/check.hpp"
+#include "corofx/detail/timer_wheel.hpp"
+#include "corofx/net.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+#include "corofx/timer.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+using namespace corofx;
+using namespace std::chrono_literals;
+using detail::timer_node;
+using detail::timer_wheel;
+
+struct tagged : timer_node {
+    int id{};
+};
+
+auto test_wheel() -> void {
+    auto wheel = timer_wheel{};
+    // Deadlines on every level, past the last level and in the past.
+    auto deadlines = std::vector<std::uint64_t>{0, 1, 63, 64, 65, 4095, 4096, 300'000, 20'000'000};
+    auto nodes = std::vector<tagged>(deadlines.size());
+    for (auto i = std::size_t{}; i < nodes.size(); ++i) {
+        nodes[i].id = static_cast<int>(i);
+        wheel.insert(nodes[i], deadlines[i]);
+    }
+    auto cancelled = tagged{};
+    wheel.insert(cancelled, 100);
+    wheel.cancel(cancelled);
+    check(not cancelled.linked());
+    check(wheel.size() == nodes.size());
+
+    auto fired = std::vector<std::uint64_t>{};
+    auto on_expire = [&](timer_node& node) {
+        check(node.deadline() < wheel.now() + 1);
+        fired.push_back(node.deadline());
+    };
+    for (auto to : {std::uint64_t{0}, std::uint64_t{64}, std::uint64_t{4095}}) {
+        wheel.advance(to, on_expire);
+        check(not fired.empty() and fired.back() <= to);
+    }
+    check(fired.size() == 6);
+    check(wheel.next_expiry().value() <= 4096);
+    wheel.advance(30'000'000, on_expire);
+    check(fired == deadlines);
+    check(wheel.size() == 0);
+    check(not wheel.next_expiry());
+}
+
+auto sleeper(int id, std::chrono::milliseconds d, std::vector<int>* order)
+    -> task<void, sleep_for> {
+    co_await sleep_for{d};
+    order->push_back(id);
+    co_return {};
+}
+
+auto sleepers(std::vector<int>* order) -> task<void, spawn, join, sleep_until> {
+    auto handles = std::vector<job_handle>{};
+    for (auto id : {3, 1, 2}) {
+        handles.push_back(co_await spawn{sleeper(id, id * 5ms, order)});
+    }
+    co_await sleep_until{std::chrono::steady_clock::now() + 1ms};
+    for (auto& h : handles) co_await join{h};
+    co_return {};
+}
+
+auto main() -> int {
+    test_wheel();
+
+    auto r = reactor{};
+    auto order = std::vector<int>{};
+    auto start = std::chrono::steady_clock::now();
+    r.run(sleepers(&order));
+    check(std::chrono::steady_clock::now() - start >= 15ms);
+    check((order == std::vector{1, 2, 3}));
+    auto stats = r.timer_slack();
+    check(stats.fired == 4);
+    check(stats.max_slack >= stats.mean_slack());
+    check(stats.mean_slack() >= 0ns);
+}
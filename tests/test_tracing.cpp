@@ -0,0 +1,117 @@
+#include "corofx/check.hpp"
+#include "corofx/task.hpp"
+#include "corofx/tracing.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace corofx;
+using tracing::event_kind;
+
+struct ask {
+    using return_type = int;
+};
+
+auto do_ask() -> task<int, ask> { co_return co_await ask{} + 1; }
+
+auto events_of(std::vector<tracing::event> const& events, void const* frame)
+    -> std::vector<event_kind> {
+    auto res = std::vector<event_kind>{};
+    for (auto const& e : events) {
+        if (e.frame == frame) res.push_back(e.kind);
+    }
+    return res;
+}
+
+auto created(std::vector<tracing::event> const& events, std::string_view name) -> void const* {
+    auto res = static_cast<void const*>(nullptr);
+    for (auto const& e : events) {
+        if (e.kind == event_kind::task_create and e.name.find(name) != e.name.npos) res = e.frame;
+    }
+    return res;
+}
+
+auto main() -> int {
+    {
+        // The lifecycle of a task that performs an effect.
+        auto result = do_ask().with(handler_of<ask>([](ask&&, auto& resume) -> task<int> {
+            co_return resume(1);
+        }))();
+        check(result == 2);
+        auto events = tracing::snapshot();
+        auto frame = created(events, "task<int, ask>");
+        check(frame != nullptr);
+        auto expected = std::vector{
+            event_kind::task_create,
+            event_kind::task_resume,
+            event_kind::effect_perform,
+            event_kind::handler_enter,
+            event_kind::handler_resume,
+            event_kind::task_resume,
+            event_kind::task_complete,
+            event_kind::frame_destroy,
+        };
+        check(events_of(events, frame) == expected);
+        for (std::size_t i = 1; i < events.size(); ++i) check(events[i - 1].time <= events[i].time);
+    }
+
+    {
+        // Tail-resumptive handlers are traced without a frame.
+        auto result = do_ask().with(tail_handler_of<ask>([](ask&&) { return 2; }))();
+        check(result == 3);
+        auto events = tracing::snapshot();
+        check(events.back().kind == event_kind::frame_destroy);
+        auto entered = false;
+        for (auto const& e : events) {
+            entered = entered or (e.kind == event_kind::handler_enter and not e.frame and
+                                  e.name.find("ask") != e.name.npos);
+        }
+        check(entered);
+    }
+
+    {
+        // Each thread keeps its most recent events.
+        tracing::set_buffer_capacity(4);
+        auto t = std::thread{[] {
+            for (auto i = 0; i < 10; ++i) {
+                check(do_ask().with(tail_handler_of<ask>([](ask&&) { return 0; }))() == 1);
+            }
+        }};
+        t.join();
+        auto events = tracing::snapshot();
+        auto thread = events.back().thread;
+        check(thread != 0);
+        auto n = std::size_t{};
+        for (auto const& e : events) n += e.thread == thread ? 1 : 0;
+        check(n == 4);
+        check(events.back().kind == event_kind::frame_destroy);
+
+        // The ring of an exited thread is collected once, then reused by the next thread.
+        for (auto const& e : tracing::snapshot()) check(e.thread != thread);
+        auto u = std::thread{[] {
+            check(do_ask().with(tail_handler_of<ask>([](ask&&) { return 0; }))() == 1);
+        }};
+        u.join();
+        events = tracing::snapshot();
+        check(events.back().thread == thread + 1);
+        n = 0;
+        for (auto const& e : events) n += e.thread == thread + 1 ? 1 : 0;
+        check(n == 4);
+    }
+
+    {
+        constexpr auto path = "test_tracing.bin";
+        check(tracing::dump(path));
+        auto file = std::fopen(path, "rb");
+        check(file != nullptr);
+        char magic[16] = {};
+        check(std::fread(magic, 1, sizeof(magic), file) == sizeof(magic));
+        std::fclose(file);
+        std::remove(path);
+        check(std::strcmp(magic, "corofx-trace-v1") == 0);
+    }
+}
@@ -19,4 +19,19 @@ static_assert(std::is_same_v<type_set<int, char>::subtract<char, bool>, type_set
 static_assert(
     std::is_same_v<type_set<int, char, short>::subtract<char, bool>, type_set<int, short>>);
 
+// Repeated types are kept once, in the order they first appear.
+static_assert(std::is_same_v<type_set<>::add<type_set<int, int>, type_set<int>>, type_set<int>>);
+static_assert(std::is_same_v<type_set<>::add<type_set<char, int, char>, type_set<bool, int>>,
+                             type_set<char, int, bool>>);
+static_assert(std::is_same_v<type_set<>::add<>, type_set<>>);
+static_assert(std::is_same_v<type_set<>::subtract<int>, type_set<>>);
+static_assert(std::is_same_v<type_set<int, char>::subtract<>, type_set<int, char>>);
+static_assert(std::is_same_v<
+              type_set<int, char>::add<type_set<bool, long>, type_set<long, short>>::subtract<char>,
+              type_set<int, bool, long, short>>);
+
+// Types that cannot be returned by value are elements too.
+static_assert(std::is_same_v<type_set<void, int[]>::add<type_set<void>>, type_set<void, int[]>>);
+static_assert(std::is_same_v<type_set<void, int[]>::subtract<void>, type_set<int[]>>);
+
 auto main() -> int {}
@@ -0,0 +1,110 @@
+#include "corofx/channel.hpp"
+#include "corofx/check.hpp"
+#include "corofx/scheduler.hpp"
+#include "corofx/task.hpp"
+#include "corofx/when.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace corofx;
+
+struct get {
+    using return_type = int;
+};
+
+struct log {
+    using return_type = void;
+
+    int x{};
+};
+
+auto twice() -> task<int, get> { co_return 2 * co_await get{}; }
+
+auto record(int x) -> task<void, log> {
+    co_await log{x};
+    co_return {};
+}
+
+auto sequential(std::vector<int>* logged) -> task<void, get, log> {
+    auto values = co_await when_all(twice(), record(1), twice());
+    check(std::get<0>(values) == 10 and std::get<2>(values) == 10);
+    check(std::is_same_v<std::tuple_element_t<1, decltype(values)>, std::monostate>);
+
+    auto all = std::vector<task<int, get>>{};
+    for (auto i = 0; i < 3; ++i) all.push_back(twice());
+    check(co_await when_all(std::move(all)) == std::vector<int>(3, 10));
+
+    // Without an executor, the first task wins and the others never run.
+    auto first = co_await when_any(record(2), twice(), record(3));
+    check(first.index() == 0);
+    auto some = std::vector<task<void, log>>{};
+    for (auto i = 4; i < 7; ++i) some.push_back(record(i));
+    check((co_await when_any(std::move(some))).first == 0);
+
+    check(logged->size() == 3);
+    check((*logged)[0] == 1 and (*logged)[1] == 2 and (*logged)[2] == 4);
+    co_return {};
+}
+
+auto spin(std::atomic<int>* running, int id) -> task<int, yield_thread> {
+    running->fetch_add(1, std::memory_order_relaxed);
+    for (auto i = 0; i < 100; ++i) co_await yield_thread{};
+    co_return id;
+}
+
+auto wait_closed(channel<int>& ch) -> task<int, suspend> {
+    check(not co_await recv(ch));
+    co_return -1;
+}
+
+auto immediate(int x) -> task<int> { co_return x; }
+
+auto ready(int x) -> task<int, suspend> { co_return x; }
+
+// The channels outlive the tasks waiting on them, which may complete after this one.
+auto concurrent(std::atomic<int>* running, channel<int>& ch, channel<int>& ch2)
+    -> task<void, spawn, join, yield_thread, suspend> {
+    auto ids = co_await when_all(spin(running, 1), spin(running, 2), spin(running, 3));
+    check(ids == std::tuple{1, 2, 3});
+
+    auto all = std::vector<task<int, yield_thread>>{};
+    for (auto i = 0; i < 10; ++i) all.push_back(spin(running, i));
+    auto results = co_await when_all(std::move(all));
+    for (auto i = 0; i < 10; ++i) check(results[static_cast<std::size_t>(i)] == i);
+
+    // The losers wait until after the race, and are left to complete on their own.
+    auto winner = co_await when_any(wait_closed(ch), immediate(7), wait_closed(ch));
+    check(winner.index() == 1 and std::get<1>(winner) == 7);
+
+    auto any = std::vector<task<int, suspend>>{};
+    any.push_back(wait_closed(ch2));
+    any.push_back(ready(5));
+    check(co_await when_any(std::move(any)) == std::pair<std::size_t, int>{1, 5});
+
+    ch.close();
+    ch2.close();
+    co_return {};
+}
+
+auto main() -> int {
+    auto logged = std::vector<int>{};
+    sequential(&logged)
+        .with(
+            tail_handler_of<get>([](get&&) { return 5; }),
+            tail_handler_of<log>([&](log&& e) { logged.push_back(e.x); }))();
+
+    for (auto threads : {1, 2, 4}) {
+        auto sched = scheduler{static_cast<std::size_t>(threads)};
+        auto running = std::atomic<int>{};
+        auto ch = channel<int>{2};
+        auto ch2 = channel<int>{2};
+        sched.run(concurrent(&running, ch, ch2));
+        check(running.load() == 13);
+    }
+}
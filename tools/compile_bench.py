@@ -0,0 +1,139 @@
+import argparse
+import json
+import os
+import re
+import resource
+import subprocess
+import tempfile
+import time
+
+
+def generate_with(effects: int) -> str:
+    """A translation unit with a task performing `effects` effects, handled at `effects` sites.
+
+    Site `k` handles effect `k`, so every site computes a different effect row.
+    """
+    lines = [
+        '#include "corofx/task.hpp"',
+        "",
+        "using namespace corofx;",
+        "",
+        "template<int I>",
+        "struct eff {",
+        "    using return_type = int;",
+        "};",
+        "",
+        "template<int I>",
+        "struct answer {",
+        "    auto operator()(eff<I>&&) const noexcept -> int { return I; }",
+        "};",
+        "",
+    ]
+
+    def row(without: int) -> str:
+        return ", ".join(["int"] + [f"eff<{i}>" for i in range(effects) if i != without])
+
+    lines.append(f"auto body() -> task<{row(-1)}>;")
+    for k in range(effects):
+        lines += [
+            "",
+            f"auto site_{k}() -> task<{row(k)}> {{",
+            f"    co_return co_await body().with(tail_handler_of<eff<{k}>>(answer<{k}>{{}}));",
+            "}",
+        ]
+    return "\n".join(lines) + "\n"
+
+
+def generate_add(effects: int) -> str:
+    """A translation unit that builds `effects` rows of `effects` effects each from empty.
+
+    Row `k` starts at effect `k` and is added twice, as combinators such as `when_all` add the
+    rows of their tasks, so every row is different and every type is repeated.
+    """
+    lines = [
+        '#include "corofx/detail/type_set.hpp"',
+        "",
+        "#include <type_traits>",
+        "",
+        "using corofx::detail::type_set;",
+        "",
+        "template<int I>",
+        "struct eff {};",
+        "",
+    ]
+    for k in range(effects):
+        row = "type_set<" + ", ".join(f"eff<{(k + i) % effects}>" for i in range(effects)) + ">"
+        lines.append(f"static_assert(std::is_same_v<type_set<>::add<{row}, {row}>, {row}>);")
+    return "\n".join(lines) + "\n"
+
+
+GENERATORS = {"with": generate_with, "add": generate_add}
+
+
+def instantiations(trace_path: str) -> int:
+    with open(trace_path) as f:
+        events = json.load(f)["traceEvents"]
+    return sum(1 for e in events if e.get("name") in ("InstantiateClass", "InstantiateFunction"))
+
+
+def measure(cxx: str, include: str, flags: list[str], kind: str, effects: int,
+            workdir: str) -> dict:
+    stem = f"{kind}_{effects}"
+    source = os.path.join(workdir, f"{stem}.cpp")
+    with open(source, "w") as f:
+        f.write(GENERATORS[kind](effects))
+    command = [cxx, "-std=c++20", *flags, f"-I{include}", "-fsyntax-only", source]
+    clang = "clang" in subprocess.run(
+        [cxx, "--version"], capture_output=True, text=True, check=True).stdout
+    if clang:
+        command += ["-ftime-trace", "-ftime-trace-granularity=0",
+                    f"-ftime-trace={os.path.join(workdir, f'{stem}.json')}"]
+    else:
+        command += ["-ftime-report"]
+    before = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+    start = time.perf_counter()
+    result = subprocess.run(command, capture_output=True, text=True)
+    seconds = time.perf_counter() - start
+    if result.returncode != 0:
+        raise RuntimeError(result.stderr)
+    peak = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+    record = {
+        "name": f"compile/{kind}/effects:{effects}",
+        "seconds": round(seconds, 3),
+        # Only exact for the largest translation unit compiled so far.
+        "peak_rss_mib": round(max(peak, before) / 1024, 1),
+    }
+    if clang:
+        record["instantiations"] = instantiations(
+            os.path.join(workdir, f"{stem}.json"))
+    else:
+        # GCC reports the time spent instantiating templates instead of a count.
+        match = re.search(r"template instantiation\s*:\s*([\d.]+)", result.stderr)
+        if match:
+            record["instantiation_seconds"] = float(match.group(1))
+    return record
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description="Measures how compile time grows with the number of effects in a row.")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"))
+    parser.add_argument("--include", default=os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "..", "include"))
+    parser.add_argument("--effects", default="8,32,128",
+                        help="comma-separated effect row sizes")
+    parser.add_argument("flags", nargs="*",
+                        help="compile options of the project, after `--`")
+    args = parser.parse_args()
+
+    results = []
+    with tempfile.TemporaryDirectory() as workdir:
+        for kind in GENERATORS:
+            for effects in sorted(int(n) for n in args.effects.split(",")):
+                results.append(
+                    measure(args.cxx, args.include, args.flags, kind, effects, workdir))
+    print(json.dumps({"benchmarks": results}, indent=2))
+
+
+if __name__ == "__main__":
+    main()
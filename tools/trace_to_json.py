@@ -0,0 +1,95 @@
+import argparse
+import json
+import struct
+
+
+MAGIC = b"corofx-trace-v1\0"
+EVENT = struct.Struct("=QQIIB7x")
+KINDS = [
+    "task_create",
+    "task_resume",
+    "task_complete",
+    "effect_perform",
+    "handler_enter",
+    "handler_resume",
+    "frame_destroy",
+]
+NO_NAME = 0xFFFFFFFF
+
+
+def read_trace(data: bytes) -> tuple[list[str], list[tuple]]:
+    if not data.startswith(MAGIC):
+        raise ValueError("not a corofx trace")
+    offset = len(MAGIC)
+    (name_count,) = struct.unpack_from("=I", data, offset)
+    offset += 4
+    names = []
+    for _ in range(name_count):
+        (size,) = struct.unpack_from("=I", data, offset)
+        offset += 4
+        names.append(data[offset:offset + size].decode())
+        offset += size
+    (event_count,) = struct.unpack_from("=Q", data, offset)
+    offset += 8
+    events = [EVENT.unpack_from(data, offset + i * EVENT.size)
+              for i in range(event_count)]
+    return names, events
+
+
+def convert_to_chrome(names: list[str], events: list[tuple]) -> dict:
+    """Converts events to the Chrome trace event format.
+
+    Every event is an instant event on its thread. Task frames also get an async span
+    from creation to destruction, and effects one from being performed to the task resuming.
+    """
+    trace = []
+    open_spans = {}
+    for time, frame, thread, name_index, kind in events:
+        kind_name = KINDS[kind] if kind < len(KINDS) else f"kind_{kind}"
+        name = names[name_index] if name_index != NO_NAME else ""
+        ts = time / 1000
+        common = {"pid": 0, "tid": thread, "ts": ts}
+        trace.append({
+            **common,
+            "name": f"{kind_name} {name}".strip(),
+            "cat": "corofx",
+            "ph": "i",
+            "s": "t",
+            "args": {"frame": hex(frame)},
+        })
+        span = None
+        if kind_name in ("task_create", "frame_destroy"):
+            span = ("frame", "b" if kind_name == "task_create" else "e")
+        elif kind_name == "effect_perform" or (kind_name == "task_resume" and name):
+            span = ("effect", "b" if kind_name == "effect_perform" else "e")
+        if span and frame:
+            key = (span[0], frame)
+            if span[1] == "b":
+                open_spans[key] = name or span[0]
+            elif key not in open_spans:
+                continue
+            trace.append({
+                **common,
+                "name": open_spans[key] if span[1] == "b" else open_spans.pop(key),
+                "cat": span[0],
+                "ph": span[1],
+                "id": hex(frame),
+            })
+    return {"traceEvents": trace, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Converts a trace written by corofx::tracing::dump to Chrome trace JSON")
+    parser.add_argument("input_file", help="Binary trace file")
+    parser.add_argument("output_file", help="Output JSON file")
+    args = parser.parse_args()
+
+    with open(args.input_file, "rb") as f:
+        names, events = read_trace(f.read())
+    with open(args.output_file, "w") as f:
+        json.dump(convert_to_chrome(names, events), f)
+
+
+if __name__ == "__main__":
+    main()